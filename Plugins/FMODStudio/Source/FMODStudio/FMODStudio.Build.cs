@@ -152,6 +152,13 @@ namespace UnrealBuildTool.Rules
                 }
             }
 			
+			// Dedicated servers never load the FMOD libraries (see FFMODStudioModule::StartupModule), so
+			// on delay-loaded platforms there is no need to stage them with the server build.
+			if (Target.Type == TargetRules.TargetType.Server && bAddDelayLoad)
+			{
+				bAddRuntimeDependencies = false;
+			}
+
 			//System.Console.WriteLine("FMOD Current path: " + System.IO.Path.GetFullPath("."));
 			//System.Console.WriteLine("FMOD Base path: " + BasePath);
 
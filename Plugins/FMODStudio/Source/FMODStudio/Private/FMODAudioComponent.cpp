@@ -29,7 +29,15 @@ UFMODAudioComponent::UFMODAudioComponent(const FObjectInitializer& ObjectInitial
 	bApplyOcclusionParameter = false;
 	bHasCheckedOcclusion = false;
 
+#if UE_SERVER
+	// No listener or Studio system on dedicated servers, so there is nothing to update.
+	PrimaryComponentTick.bCanEverTick = false;
+#if ENGINE_MINOR_VERSION >= 11
+	bWantsOnUpdateTransform = false;
+#endif
+#else
 	PrimaryComponentTick.bCanEverTick = true;
+#endif
 	PrimaryComponentTick.TickGroup = TG_PrePhysics;
 
 	StudioInstance = nullptr;
@@ -561,6 +569,7 @@ void UFMODAudioComponent::SetProgrammerSound(FMOD::Sound* Sound)
 
 void UFMODAudioComponent::Play()
 {
+#if !UE_SERVER
 	Stop();
 
 	bHasCheckedOcclusion = false;
@@ -636,6 +645,7 @@ void UFMODAudioComponent::Play()
 			SetComponentTickEnabled(true);
 		}
 	}
+#endif
 }
 
 void UFMODAudioComponent::Stop()
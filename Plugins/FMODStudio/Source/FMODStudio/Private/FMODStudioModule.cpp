@@ -115,6 +115,7 @@ public:
 		bUseSound(true),
 		bListenerMoved(true),
 		bAllowLiveUpdate(true),
+		bNonRealtimeOutput(false),
 		LowLevelLibHandle(nullptr),
 		StudioLibHandle(nullptr)
 	{
@@ -250,6 +251,9 @@ public:
 	/** True if we allow live update */
 	bool bAllowLiveUpdate;
 
+	/** True if the runtime system should mix without a device, as fast as it is updated */
+	bool bNonRealtimeOutput;
+
 	/** Dynamic library */
 	FString BaseLibPath;
 	void* LowLevelLibHandle;
@@ -410,6 +414,16 @@ void FFMODStudioModule::StartupModule()
 		bAllowLiveUpdate = false;
 	}
 
+	if(FParse::Param(FCommandLine::Get(),TEXT("fmodnrt")))
+	{
+		bNonRealtimeOutput = true;
+	}
+
+#if UE_SERVER
+	// Dedicated servers never output audio, so don't load the libraries, create Studio systems, load banks
+	// or register the tick. With no Studio system every component and blueprint call becomes a no-op.
+	bUseSound = false;
+#else
 	if (LoadLibraries())
 	{
 		verifyfmod(FMOD::Debug_Initialize(FMOD_DEBUG_LEVEL_WARNING, FMOD_DEBUG_MODE_CALLBACK, FMODLogCallback));
@@ -439,6 +453,7 @@ void FFMODStudioModule::StartupModule()
 	{
 		BankUpdateNotifier.BanksUpdatedEvent.AddRaw(this, &FFMODStudioModule::HandleBanksUpdated);
 	}
+#endif
 }
 
 inline FMOD_SPEAKERMODE ConvertSpeakerMode(EFMODSpeakerMode::Type Mode)
@@ -516,6 +531,11 @@ void FFMODStudioModule::CreateStudioSystem(EFMODSystemContext::Type Type)
 		verifyfmod(lowLevelSystem->setOutput(FMOD_OUTPUTTYPE_WAVWRITER));
 		InitData = (void*)WavWriterDestUTF8.Get();
 	}
+	else if (Type == EFMODSystemContext::Runtime && bNonRealtimeOutput)
+	{
+		UE_LOG(LogFMOD, Log, TEXT("Running with non-realtime output"));
+		verifyfmod(lowLevelSystem->setOutput(FMOD_OUTPUTTYPE_NOSOUND_NRT));
+	}
 
 	int SampleRate = Settings.SampleRate;
 	if (Settings.bMatchHardwareSampleRate)
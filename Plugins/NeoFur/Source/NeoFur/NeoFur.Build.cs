@@ -39,8 +39,15 @@ public class NeoFur : ModuleRules
         if(UEBuildConfiguration.bBuildEditor) {
             PublicDependencyModuleNames.Add("FBX");
             Definitions.Add("NEOFUR_FBX=1");
+            PrivateDependencyModuleNames.Add("DerivedDataCache");
         }
         
+        // Servers keep the component classes so maps and blueprints still
+        // load, but every fur component is a no-op there.
+        if(Target.Type == TargetRules.TargetType.Server) {
+            Definitions.Add("NEOFUR_SERVER_STUB=1");
+        }
+
         // FIXME: Hide this from Pro versions.
         if (UEBuildConfiguration.bBuildEditor == true) {
             PrivateDependencyModuleNames.Add("Http");
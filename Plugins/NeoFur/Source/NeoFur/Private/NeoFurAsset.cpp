@@ -27,26 +27,46 @@ THIRD_PARTY_INCLUDES_END
 #endif
 
 #endif
-#include <fstream>
-#include <sstream>
 #endif
 
 #include "EngineModule.h"
 #include "Modules/ModuleVersion.h"
+#include "Async/ParallelFor.h"
+#include "Misc/SecureHash.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_EDITOR
+#include "DerivedDataCacheInterface.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#endif
 
 #include "NeoFurComponent.h"
 #include "NeoFurVertexFactory.h"
 #include "NeoFurAsset.h"
+#include "NeoFurProxyPrivateData.h"
 
 #if WITH_EDITOR && NEOFUR_FBX
-static void LoadFurFBXData(FString &filename, UNeoFurAsset *ret);
+static bool LoadFurFBXData(
+	const FString &FileName, const TArray<uint8> &FileData,
+	TArray<FVector> &OutPoints, TArray<int32> &OutLineLengths);
 #endif
 
 // Version history...
 //   1 - Initial version.
 //   2 - Added OriginalIndexToNewIndexMapping.
+//   3 - Added 16-bit bone IDs.
+//   4 - Added BonePalette. Bone IDs index into the palette.
+//   5 - Added MorphTargetDeltas.
+//   6 - Added DerivedDataKey.
+//   7 - Added the compact cooked layout.
+//   8 - Added the cached source spline data.
 #define FAKE_VERSION_NUMBER -1
-#define MOST_RECENT_VERSION 3
+#define MOST_RECENT_VERSION 8
+
+// Change this whenever RegenerateFromSkeletalMesh() changes what it
+// generates, to throw out everything already in the derived data cache.
+#define NEOFUR_DERIVEDDATA_VER TEXT("6B0E3C52D1A94F0B8E7A2C91F4D35E60")
 
 UNeoFurAsset::UNeoFurAsset(const FObjectInitializer &ObjectInitializer) :
 	Super(ObjectInitializer)
@@ -55,6 +75,7 @@ UNeoFurAsset::UNeoFurAsset(const FObjectInitializer &ObjectInitializer) :
 	SkeletalMesh = nullptr;
 	StaticMesh = nullptr;
 	MorphTargetName = "NeoFur_OuterLayer";
+	RenderResources = nullptr;
 }
 
 void UNeoFurAsset::Serialize(FArchive &Ar)
@@ -76,6 +97,8 @@ void UNeoFurAsset::Serialize(FArchive &Ar)
 			Ar << Indices;
 			Ar << SplineLines;
 
+			BuildBonePalette();
+
 			if(GIsEditor) {
 				// In the editor? Clobber whatever we loaded with the actual
 				// skeleton data. Replace stale data in the asset file.
@@ -116,6 +139,17 @@ void UNeoFurAsset::Serialize(FArchive &Ar)
 		UE_LOG(NeoFur, Log, TEXT("File version: %d"), Version);
 	}
 
+	// Cooked packages get their own layout, and nothing after this.
+	if(Version > 6) {
+		bool bCooked = Ar.IsCooking();
+		Ar << bCooked;
+		if(bCooked) {
+			SerializeCooked(Ar);
+			UE_LOG(NeoFur, Log, TEXT("Cooked fur asset load/save complete."));
+			return;
+		}
+	}
+
 	UE_LOG(NeoFur, Log, TEXT("Serializing verts, indices, and splines from version 1+."));
 	Ar << Vertices;
 	Ar << Indices;
@@ -150,6 +184,34 @@ void UNeoFurAsset::Serialize(FArchive &Ar)
 			Ar << BoneIDs;
 		}
 	}
+
+	if(Version > 3) {
+		UE_LOG(NeoFur, Log, TEXT("Serializing bone palette from version 4+."));
+		Ar << BonePalette;
+	} else if(Ar.IsLoading()) {
+		// Older versions stored skeleton bone indices.
+		BuildBonePalette();
+	}
+
+	if(Version > 4) {
+		UE_LOG(NeoFur, Log, TEXT("Serializing morph target deltas from version 5+."));
+		Ar << MorphTargetDeltas;
+		if(Ar.IsLoading()) {
+			BuildMorphTargetDeltaIndices();
+		}
+	}
+
+	if(Version > 5) {
+		UE_LOG(NeoFur, Log, TEXT("Serializing derived data key from version 6+."));
+		Ar << DerivedDataKey;
+	}
+
+	if(Version > 7) {
+		UE_LOG(NeoFur, Log, TEXT("Serializing source spline data from version 8+."));
+		Ar << SplineSourceHash;
+		Ar << SplineSourcePoints;
+		Ar << SplineSourceLineLengths;
+	}
 	
 	// Rebuild everything after load, if we're in the editor.
 	if(GIsEditor && Ar.IsLoading()) {
@@ -160,64 +222,244 @@ void UNeoFurAsset::Serialize(FArchive &Ar)
 	UE_LOG(NeoFur, Log, TEXT("Fur asset load complete."));
 }
 
-static void RemoveVertex(
-	int32 Index,
+void UNeoFurAsset::PostLoad()
+{
+	Super::PostLoad();
+
+	// Older versions didn't store the morph target deltas, so they have to
+	// come straight from the skeletal mesh, which is safe to read now.
+	if(Version < 5 && SkeletalMesh && !MorphTargetDeltas.Num()) {
+		SkeletalMesh->ConditionalPostLoad();
+		BuildMorphTargetDeltas();
+	}
+}
+
+void UNeoFurAsset::BeginDestroy()
+{
+	ReleaseRenderResources();
+	Super::BeginDestroy();
+}
+
+FNeoFurAssetRenderResources *UNeoFurAsset::GetRenderResources()
+{
+	check(IsInGameThread());
+
+	if(!RenderResources) {
+		RenderResources = FNeoFurAssetRenderResources::Create(this);
+	}
+
+	return RenderResources;
+}
+
+void UNeoFurAsset::ReleaseRenderResources()
+{
+	if(RenderResources) {
+		RenderResources->BeginRelease();
+		RenderResources = nullptr;
+	}
+}
+
+int32 UNeoFurAsset::FindMorphTargetDeltas(FName MorphTargetName) const
+{
+	const int32 *Index = MorphTargetDeltaIndices.Find(MorphTargetName);
+	return Index ? *Index : INDEX_NONE;
+}
+
+// Removes every vertex that isn't referenced by Indices, and fixes up
+// Indices and OriginalIndexToNewIndexMapping to match.
+//
+// This gives exactly the same result as the old approach of walking the
+// vertices and swapping each unused one with the last vertex, which is
+// what existing assets were built with. Rather than rewriting every index
+// after every swap, it just tracks which original vertex ends up in each
+// slot and remaps everything once at the end.
+static void RemoveUnusedVertices(
 	TArray<uint32> &Indices,
 	TArray<FNeoFurComponentSceneProxy::VertexType> &SoftSkinVertices,
 	TArray<int32> &OriginalIndexToNewIndexMapping)
 {
-	// Take the vertex from the end and stick it in this one's slot.
-	int32 ReplacementIndex = SoftSkinVertices.Num() - 1;
-	SoftSkinVertices[Index] = SoftSkinVertices[ReplacementIndex];
-	
-	// Fix up any indices that were pointing to the one we just moved.
+	int32 NumVertices = SoftSkinVertices.Num();
+
+	TArray<bool> Used;
+	Used.SetNumZeroed(NumVertices);
 	for(int32 k = 0; k < Indices.Num(); k++) {
-		check(Indices[k] != Index); // If this fires off, it means we're trying to delete something that's in use.
-		if(Indices[k] == ReplacementIndex) {
-			Indices[k] = Index;
+		if(Indices[k] < uint32(NumVertices)) {
+			Used[Indices[k]] = true;
 		}
 	}
 
-	for(int32 k = 0; k < OriginalIndexToNewIndexMapping.Num(); k++) {
-		if(OriginalIndexToNewIndexMapping[k] == ReplacementIndex) {
-			OriginalIndexToNewIndexMapping[k] = Index;
-		} else if(OriginalIndexToNewIndexMapping[k] == Index) {
-			OriginalIndexToNewIndexMapping[k] = -1;
+	// SlotContents[i] is the original index of whichever vertex is
+	// currently in slot i.
+	TArray<int32> SlotContents;
+	SlotContents.SetNumUninitialized(NumVertices);
+	for(int32 i = 0; i < NumVertices; i++) {
+		SlotContents[i] = i;
+	}
+
+	// Where each original vertex ended up, or -1 if it was removed.
+	TArray<int32> Remap;
+	Remap.Init(-1, NumVertices);
+
+	int32 NewNumVertices = NumVertices;
+	for(int32 i = 0; i < NewNumVertices; ) {
+
+		if(Used[SlotContents[i]]) {
+			i++;
+			continue;
+		}
+
+		// Take the vertex from the end and stick it in this one's slot,
+		// then look at this slot again.
+		int32 ReplacementIndex = NewNumVertices - 1;
+
+		// FIXME: The swap-based version left the mapping for the last
+		// vertex pointing at its old slot (now past the end) when that
+		// vertex was the one removed, instead of -1. Kept so existing
+		// assets come out the same.
+		if(ReplacementIndex == i) {
+			Remap[SlotContents[i]] = i;
 		}
+
+		SoftSkinVertices[i] = SoftSkinVertices[ReplacementIndex];
+		SlotContents[i] = SlotContents[ReplacementIndex];
+		NewNumVertices--;
 	}
 
-	// Erase the end.
-	SoftSkinVertices.SetNum(SoftSkinVertices.Num() - 1);
+	for(int32 i = 0; i < NewNumVertices; i++) {
+		Remap[SlotContents[i]] = i;
+	}
+
+	SoftSkinVertices.SetNum(NewNumVertices);
+
+	for(int32 k = 0; k < Indices.Num(); k++) {
+		if(Indices[k] < uint32(NumVertices)) {
+			Indices[k] = Remap[Indices[k]];
+		}
+	}
+
+	for(int32 k = 0; k < OriginalIndexToNewIndexMapping.Num(); k++) {
+		int32 &Mapping = OriginalIndexToNewIndexMapping[k];
+		if(Mapping >= 0 && Mapping < NumVertices) {
+			Mapping = Remap[Mapping];
+		}
+	}
 }
 
-static void RemoveUnusedVertices(
-	TArray<uint32> &Indices,
-	TArray<FNeoFurComponentSceneProxy::VertexType> &SoftSkinVertices,
-	TArray<int32> &OriginalIndexToNewIndexMapping)
+// kd-tree over the spline roots, for finding the two closest splines to
+// each vertex. The tree is implicit: every range of Order is split at
+// its middle element, alternating X, Y and Z with depth.
+class FNeoFurSplineRootTree
 {
-	for(int32 i = 0; i < SoftSkinVertices.Num(); i++) {
+public:
 
-		bool FoundThisVert = false;
-		
-		for(int32 k = 0; k < Indices.Num(); k++) {
-			if(Indices[k] == i) {
-				FoundThisVert = true;
-				break;
-			}
+	FNeoFurSplineRootTree(const TArray< TArray<FVector> > &SplineLines)
+	{
+		Roots.SetNumUninitialized(SplineLines.Num());
+		Order.SetNumUninitialized(SplineLines.Num());
+		for(int32 k = 0; k < SplineLines.Num(); k++) {
+			Roots[k] = SplineLines[k][0];
+			Order[k] = k;
+		}
+		Build(0, Order.Num(), 0);
+	}
+
+	// Finds the two splines with the closest roots to Position. Ties go to
+	// the lower spline index, which matches a straight walk through all
+	// of them. Indices are INDEX_NONE if there aren't enough splines.
+	void FindTwoClosest(
+		const FVector &Position,
+		int32 &OutClosest, float &OutClosestDistSquared,
+		int32 &OutClosest2, float &OutClosestDistSquared2) const
+	{
+		OutClosest = INDEX_NONE;
+		OutClosest2 = INDEX_NONE;
+		OutClosestDistSquared = FLT_MAX;
+		OutClosestDistSquared2 = FLT_MAX;
+		Search(Position, 0, Order.Num(), 0, OutClosest, OutClosestDistSquared, OutClosest2, OutClosestDistSquared2);
+	}
+
+private:
+
+	void Build(int32 Start, int32 End, int32 Depth)
+	{
+		if(End - Start < 2) return;
+
+		int32 Axis = Depth % 3;
+		const TArray<FVector> &RootsRef = Roots;
+		Sort(Order.GetData() + Start, End - Start, [&RootsRef, Axis](int32 A, int32 B) {
+			return RootsRef[A][Axis] < RootsRef[B][Axis] || (RootsRef[A][Axis] == RootsRef[B][Axis] && A < B);
+		});
+
+		int32 Middle = (Start + End) / 2;
+		Build(Start, Middle, Depth + 1);
+		Build(Middle + 1, End, Depth + 1);
+	}
+
+	// Same order as comparing (distance, index) pairs.
+	static bool IsCloser(float DistSquared, int32 Index, float BestDistSquared, int32 BestIndex)
+	{
+		return DistSquared < BestDistSquared ||
+			(DistSquared == BestDistSquared && BestIndex != INDEX_NONE && Index < BestIndex);
+	}
+
+	void Search(
+		const FVector &Position, int32 Start, int32 End, int32 Depth,
+		int32 &Closest, float &ClosestDistSquared,
+		int32 &Closest2, float &ClosestDistSquared2) const
+	{
+		if(Start >= End) return;
+
+		int32 Middle = (Start + End) / 2;
+		int32 Index = Order[Middle];
+		const FVector &Root = Roots[Index];
+
+		// Exactly the same math as the brute force search, so the
+		// distances (and therefore the results) come out identical.
+		float DistSquared = (Root - Position).SizeSquared();
+		if(IsCloser(DistSquared, Index, ClosestDistSquared, Closest)) {
+			Closest2 = Closest;
+			ClosestDistSquared2 = ClosestDistSquared;
+			Closest = Index;
+			ClosestDistSquared = DistSquared;
+		} else if(IsCloser(DistSquared, Index, ClosestDistSquared2, Closest2)) {
+			Closest2 = Index;
+			ClosestDistSquared2 = DistSquared;
 		}
 
-		if(!FoundThisVert) {
-			RemoveVertex(i, Indices, SoftSkinVertices, OriginalIndexToNewIndexMapping);
-			i--;
+		int32 Axis = Depth % 3;
+		float PlaneDist = Root[Axis] - Position[Axis];
+		bool bNearIsLow = PlaneDist >= 0.0f;
+
+		if(bNearIsLow) {
+			Search(Position, Start, Middle, Depth + 1, Closest, ClosestDistSquared, Closest2, ClosestDistSquared2);
+		} else {
+			Search(Position, Middle + 1, End, Depth + 1, Closest, ClosestDistSquared, Closest2, ClosestDistSquared2);
+		}
+
+		// Anything on the far side is at least PlaneDist away. It can still
+		// tie with the second closest, and ties have to be checked for the
+		// index, so only skip it if it's strictly further.
+		if(PlaneDist * PlaneDist > ClosestDistSquared2) return;
+
+		if(bNearIsLow) {
+			Search(Position, Middle + 1, End, Depth + 1, Closest, ClosestDistSquared, Closest2, ClosestDistSquared2);
+		} else {
+			Search(Position, Start, Middle, Depth + 1, Closest, ClosestDistSquared, Closest2, ClosestDistSquared2);
 		}
 	}
-}
+
+	TArray<FVector> Roots;
+	TArray<int32> Order;
+};
 
 static void SetupSplines(
 	TArray<FNeoFurComponentSceneProxy::VertexType> &Vertices,
 	const TArray< TArray<FVector> > &SplineLines)
 {
-	for(int32 i = 0; i < Vertices.Num(); i++) {
+	FNeoFurSplineRootTree Tree(SplineLines);
+
+	// Every vertex only reads the splines and writes to itself.
+	ParallelFor(Vertices.Num(), [&Vertices, &SplineLines, &Tree](int32 i) {
 	    
 		FNeoFurComponentSceneProxy::VertexType &Vert = Vertices[i];
 
@@ -228,39 +470,22 @@ static void SetupSplines(
 		// it). We should change this in the future to use at least
 		// three points.
 		
-		// This code is duplicated for skeletal mesh and static meshes
-		// separately. Might want to condense it into a common piece
-		// of code some day.
+		int32 ClosestSpline;
+		int32 ClosestSpline2;
+		float ClosestSplineDist;
+		float ClosestSplineDist2;
+		Tree.FindTwoClosest(Vert.Position, ClosestSpline, ClosestSplineDist, ClosestSpline2, ClosestSplineDist2);
 
-		float ClosestSplineDist = FLT_MAX;
 		FVector SplineDirection = Vert.CombedDirectionAndLength;
-		FVector SplineOrigin = Vert.Position;
-		
-		float ClosestSplineDist2 = FLT_MAX;
-		FVector SplineDirection2 = Vert.CombedDirectionAndLength;
-		FVector SplineOrigin2 = Vert.Position;
-
-		// Splines.
-		for(int32 k = 0; k < SplineLines.Num(); k++) {
-			float s = (SplineLines[k][0] - Vert.Position).SizeSquared();
-			if(s < ClosestSplineDist) {
-
-				// Bump current down to second place.
-				ClosestSplineDist2 = ClosestSplineDist;
-				SplineOrigin2 = SplineOrigin;
-				SplineDirection2 = SplineDirection;
-
-				ClosestSplineDist = s;
-				SplineOrigin = SplineLines[k][0];
-				SplineDirection = SplineLines[k][SplineLines[k].Num() - 1] - SplineOrigin;
-
-			} else if(s < ClosestSplineDist2) {
+		if(ClosestSpline != INDEX_NONE) {
+			const TArray<FVector> &Spline = SplineLines[ClosestSpline];
+			SplineDirection = Spline[Spline.Num() - 1] - Spline[0];
+		}
 
-				// Between first and second.
-				ClosestSplineDist2 = s;
-				SplineOrigin2 = SplineLines[k][0];
-				SplineDirection2 = SplineLines[k][SplineLines[k].Num() - 1] - SplineOrigin2;
-			}
+		FVector SplineDirection2 = Vert.CombedDirectionAndLength;
+		if(ClosestSpline2 != INDEX_NONE) {
+			const TArray<FVector> &Spline = SplineLines[ClosestSpline2];
+			SplineDirection2 = Spline[Spline.Num() - 1] - Spline[0];
 		}
 		
 		ClosestSplineDist  = sqrt(ClosestSplineDist);
@@ -273,7 +498,7 @@ static void SetupSplines(
 		SplineDirection = SplineDirection * ClosestSplineDist2 + SplineDirection2 * ClosestSplineDist;
 
 		Vert.CombedDirectionAndLength = SplineDirection;
-	}
+	});
 }
 
 void UNeoFurAsset::RegenerateFromSkeletalMesh()
@@ -296,7 +521,336 @@ void UNeoFurAsset::RegenerateFromSkeletalMesh()
 		// the data we have.
 		return;
 	}
-	
+
+#if WITH_EDITOR
+	// Nothing changed since this data was built.
+	FString NewDerivedDataKey = GetDerivedDataKey();
+	if(NewDerivedDataKey == DerivedDataKey) {
+		UE_LOG(NeoFur, Log, TEXT("Fur data is up to date."));
+		return;
+	}
+
+	TArray<uint8> DerivedData;
+	if(GetDerivedDataCacheRef().GetSynchronous(*NewDerivedDataKey, DerivedData)) {
+		UE_LOG(NeoFur, Log, TEXT("Loading fur data from the derived data cache."));
+		FMemoryReader Ar(DerivedData, true);
+		SerializeDerivedData(Ar);
+	} else {
+		UE_LOG(NeoFur, Log, TEXT("Building fur data."));
+		BuildDerivedData();
+		FMemoryWriter Ar(DerivedData, true);
+		SerializeDerivedData(Ar);
+		GetDerivedDataCacheRef().Put(*NewDerivedDataKey, DerivedData);
+	}
+
+	DerivedDataKey = NewDerivedDataKey;
+#else
+	BuildDerivedData();
+#endif
+
+	// Anything that gets drawn from now on needs the new data.
+	ReleaseRenderResources();
+}
+
+#if WITH_EDITOR
+FString UNeoFurAsset::GetDerivedDataKey() const
+{
+	FSHA1 Sha;
+
+	// Mesh paths and versions. Both meshes change their package GUID every
+	// time they're saved, which covers reimports, morph targets and
+	// material changes.
+	if(SkeletalMesh) {
+		FString Path = SkeletalMesh->GetPathName();
+		Sha.UpdateWithString(*Path, Path.Len());
+		FGuid PackageGuid = SkeletalMesh->GetOutermost()->GetGuid();
+		Sha.Update((const uint8*)&PackageGuid, sizeof(PackageGuid));
+
+		// Catches most reimports that haven't been saved yet.
+		const FStaticLODModel &Model = SkeletalMesh->GetImportedResource()->LODModels[0];
+		const FRawStaticIndexBuffer16or32Interface *IndexBuffer = Model.MultiSizeIndexContainer.GetIndexBuffer();
+		uint32 Counts[2] = { Model.NumVertices, IndexBuffer ? uint32(IndexBuffer->Num()) : 0 };
+		Sha.Update((const uint8*)Counts, sizeof(Counts));
+	}
+
+	if(StaticMesh) {
+		FString Path = StaticMesh->GetPathName();
+		Sha.UpdateWithString(*Path, Path.Len());
+		FGuid PackageGuid = StaticMesh->GetOutermost()->GetGuid();
+		Sha.Update((const uint8*)&PackageGuid, sizeof(PackageGuid));
+	  #if WITH_EDITORONLY_DATA
+		// The static mesh's own cache key already covers its contents.
+		Sha.UpdateWithString(*StaticMesh->RenderData->DerivedDataKey, StaticMesh->RenderData->DerivedDataKey.Len());
+	  #endif
+	}
+
+	// Settings.
+	Sha.Update((const uint8*)&MaterialId, sizeof(MaterialId));
+	Sha.UpdateWithString(*MorphTargetName, MorphTargetName.Len());
+
+	// Spline data. SplineTransform is already baked into this.
+	int32 NumSplines = SplineLines.Num();
+	Sha.Update((const uint8*)&NumSplines, sizeof(NumSplines));
+	for(int32 i = 0; i < SplineLines.Num(); i++) {
+		int32 NumPoints = SplineLines[i].Num();
+		Sha.Update((const uint8*)&NumPoints, sizeof(NumPoints));
+		Sha.Update((const uint8*)SplineLines[i].GetData(), NumPoints * sizeof(FVector));
+	}
+
+	Sha.Final();
+	FSHAHash Hash;
+	Sha.GetHash(Hash.Hash);
+
+	return FDerivedDataCacheInterface::BuildCacheKey(TEXT("NEOFUR"), NEOFUR_DERIVEDDATA_VER, *Hash.ToString());
+}
+
+void UNeoFurAsset::SerializeDerivedData(FArchive &Ar)
+{
+	Ar << Vertices;
+	Ar << Indices;
+	Ar << OriginalIndexToNewIndexMapping;
+
+	// The vertex serializer only keeps 8 bits of each bone index.
+	TArray<uint16> BoneIDs;
+	if(!Ar.IsLoading()) {
+		BoneIDs.SetNum(Vertices.Num() * 4);
+		for(int32 i = 0; i < Vertices.Num(); i++) {
+			for(int32 j = 0; j < 4; j++) {
+				BoneIDs[i * 4 + j] = Vertices[i].InfluenceBones[j];
+			}
+		}
+	}
+	Ar << BoneIDs;
+	if(Ar.IsLoading() && BoneIDs.Num() == Vertices.Num() * 4) {
+		for(int32 i = 0; i < Vertices.Num(); i++) {
+			for(int32 j = 0; j < 4; j++) {
+				Vertices[i].InfluenceBones[j] = BoneIDs[i * 4 + j];
+			}
+		}
+	}
+
+	Ar << BonePalette;
+	Ar << MorphTargetDeltas;
+	if(Ar.IsLoading()) {
+		BuildMorphTargetDeltaIndices();
+	}
+}
+#endif
+
+// ----------------------------------------------------------------------
+// Cooked layout
+// ----------------------------------------------------------------------
+
+// The growth mesh is stored as a run of tightly packed streams in one
+// bulk data blob, in this order:
+//
+//   FNeoFurCookedHeader
+//   Positions, uint16[3] per vertex, quantized to the mesh bounds
+//   TanX, TanZ, FFloat16[3] per vertex each
+//   CombedDirectionAndLength, FVector per vertex (full precision, since
+//     the length matters)
+//   InfluenceBones, uint16[4] per vertex
+//   InfluenceWeights, uint8[4] per vertex
+//   UVs, FFloat16[2] per vertex for each channel in use, one channel
+//     after another
+//   Indices, uint16 if every index fits, uint32 otherwise
+//
+// Spline data and OriginalIndexToNewIndexMapping are only used to build
+// the rest, so they aren't cooked at all. The only other thing that
+// reads SplineLines is UNeoFurComponent::bDrawSplines, which is
+// editor-only data and isn't in builds that load cooked assets.
+struct FNeoFurCookedHeader
+{
+	int32 NumVertices;
+	int32 NumIndices;
+	int32 NumUVChannels;
+	int32 bIndices16;
+	FVector PositionMin;
+	FVector PositionScale;
+};
+
+#if WITH_EDITOR
+static void NeoFurPackCookedData(
+	const TArray<FNeoFurComponentSceneProxy::VertexType> &Vertices,
+	const TArray<uint32> &Indices,
+	TArray<uint8> &OutData)
+{
+	int32 NumVertices = Vertices.Num();
+
+	FNeoFurCookedHeader Header;
+	Header.NumVertices = NumVertices;
+	Header.NumIndices = Indices.Num();
+	Header.bIndices16 = NumVertices <= MAX_uint16 + 1;
+
+	// Channels past the last one with anything in it are left out.
+	Header.NumUVChannels = 0;
+	FBox Bounds(ForceInit);
+	for(int32 i = 0; i < NumVertices; i++) {
+		Bounds += Vertices[i].Position;
+		for(int32 k = Header.NumUVChannels; k < MAX_TEXCOORDS; k++) {
+			if(!Vertices[i].UVs[k].IsZero()) {
+				Header.NumUVChannels = k + 1;
+			}
+		}
+	}
+
+	Header.PositionMin = Bounds.IsValid ? Bounds.Min : FVector::ZeroVector;
+	Header.PositionScale = Bounds.IsValid ? (Bounds.Max - Bounds.Min) / float(MAX_uint16) : FVector::ZeroVector;
+
+	TArray<uint16> Positions;
+	TArray<FFloat16> Tangents;
+	TArray<FVector> CombedDirections;
+	TArray<uint16> InfluenceBones;
+	TArray<uint8> InfluenceWeights;
+	TArray<FFloat16> UVs;
+	Positions.SetNumUninitialized(NumVertices * 3);
+	Tangents.SetNumUninitialized(NumVertices * 6);
+	CombedDirections.SetNumUninitialized(NumVertices);
+	InfluenceBones.SetNumUninitialized(NumVertices * 4);
+	InfluenceWeights.SetNumUninitialized(NumVertices * 4);
+	UVs.SetNumUninitialized(NumVertices * 2 * Header.NumUVChannels);
+
+	for(int32 i = 0; i < NumVertices; i++) {
+		const FNeoFurComponentSceneProxy::VertexType &Vert = Vertices[i];
+		for(int32 Axis = 0; Axis < 3; Axis++) {
+			float Scale = Header.PositionScale[Axis];
+			float Quantized = Scale > 0.0f ? (Vert.Position[Axis] - Header.PositionMin[Axis]) / Scale : 0.0f;
+			Positions[i * 3 + Axis] = uint16(FMath::Clamp(FMath::RoundToInt(Quantized), 0, int32(MAX_uint16)));
+			Tangents[i * 3 + Axis] = Vert.TanX[Axis];
+			Tangents[(NumVertices + i) * 3 + Axis] = Vert.TanZ[Axis];
+		}
+		CombedDirections[i] = Vert.CombedDirectionAndLength;
+		for(int32 k = 0; k < 4; k++) {
+			InfluenceBones[i * 4 + k] = Vert.InfluenceBones[k];
+			InfluenceWeights[i * 4 + k] = Vert.InfluenceWeights[k];
+		}
+		for(int32 k = 0; k < Header.NumUVChannels; k++) {
+			UVs[(k * NumVertices + i) * 2 + 0] = Vert.UVs[k].X;
+			UVs[(k * NumVertices + i) * 2 + 1] = Vert.UVs[k].Y;
+		}
+	}
+
+	FMemoryWriter Writer(OutData);
+	Writer.Serialize(&Header, sizeof(Header));
+	Writer.Serialize(Positions.GetData(), Positions.Num() * Positions.GetTypeSize());
+	Writer.Serialize(Tangents.GetData(), Tangents.Num() * Tangents.GetTypeSize());
+	Writer.Serialize(CombedDirections.GetData(), CombedDirections.Num() * CombedDirections.GetTypeSize());
+	Writer.Serialize(InfluenceBones.GetData(), InfluenceBones.Num() * InfluenceBones.GetTypeSize());
+	Writer.Serialize(InfluenceWeights.GetData(), InfluenceWeights.Num() * InfluenceWeights.GetTypeSize());
+	Writer.Serialize(UVs.GetData(), UVs.Num() * UVs.GetTypeSize());
+
+	if(Header.bIndices16) {
+		TArray<uint16> Indices16;
+		Indices16.SetNumUninitialized(Indices.Num());
+		for(int32 i = 0; i < Indices.Num(); i++) {
+			Indices16[i] = uint16(Indices[i]);
+		}
+		Writer.Serialize(Indices16.GetData(), Indices16.Num() * Indices16.GetTypeSize());
+	} else {
+		Writer.Serialize((void*)Indices.GetData(), Indices.Num() * Indices.GetTypeSize());
+	}
+}
+#endif
+
+// Returns false if Data is too short for what its header says is in it.
+static bool NeoFurUnpackCookedData(
+	const uint8 *Data, int64 Size,
+	TArray<FNeoFurComponentSceneProxy::VertexType> &OutVertices,
+	TArray<uint32> &OutIndices)
+{
+	if(Size < int64(sizeof(FNeoFurCookedHeader))) return false;
+
+	FNeoFurCookedHeader Header;
+	FMemory::Memcpy(&Header, Data, sizeof(Header));
+	int32 NumVertices = Header.NumVertices;
+	int32 NumUVChannels = FMath::Min(Header.NumUVChannels, int32(MAX_TEXCOORDS));
+
+	const uint16 *Positions = (const uint16*)(Data + sizeof(Header));
+	const FFloat16 *Tangents = (const FFloat16*)(Positions + NumVertices * 3);
+	const FVector *CombedDirections = (const FVector*)(Tangents + NumVertices * 6);
+	const uint16 *InfluenceBones = (const uint16*)(CombedDirections + NumVertices);
+	const uint8 *InfluenceWeights = (const uint8*)(InfluenceBones + NumVertices * 4);
+	const FFloat16 *UVs = (const FFloat16*)(InfluenceWeights + NumVertices * 4);
+	const uint8 *IndexData = (const uint8*)(UVs + NumVertices * 2 * Header.NumUVChannels);
+	int64 IndexSize = int64(Header.NumIndices) * (Header.bIndices16 ? sizeof(uint16) : sizeof(uint32));
+	if(IndexData + IndexSize > Data + Size) return false;
+
+	// The streams are only 2-byte aligned, so the full floats get copied
+	// out instead of read in place.
+	OutVertices.SetNumUninitialized(NumVertices);
+	for(int32 i = 0; i < NumVertices; i++) {
+		FNeoFurComponentSceneProxy::VertexType &Vert = OutVertices[i];
+		for(int32 Axis = 0; Axis < 3; Axis++) {
+			Vert.Position[Axis] = Header.PositionMin[Axis] + float(Positions[i * 3 + Axis]) * Header.PositionScale[Axis];
+			Vert.TanX[Axis] = Tangents[i * 3 + Axis];
+			Vert.TanZ[Axis] = Tangents[(NumVertices + i) * 3 + Axis];
+		}
+		FMemory::Memcpy(&Vert.CombedDirectionAndLength, &CombedDirections[i], sizeof(FVector));
+		for(int32 k = 0; k < 4; k++) {
+			Vert.InfluenceBones[k] = InfluenceBones[i * 4 + k];
+			Vert.InfluenceWeights[k] = InfluenceWeights[i * 4 + k];
+		}
+		for(int32 k = 0; k < NumUVChannels; k++) {
+			Vert.UVs[k].X = UVs[(k * NumVertices + i) * 2 + 0];
+			Vert.UVs[k].Y = UVs[(k * NumVertices + i) * 2 + 1];
+		}
+		for(int32 k = NumUVChannels; k < MAX_TEXCOORDS; k++) {
+			Vert.UVs[k] = FVector2D(0.0f, 0.0f);
+		}
+		Vert.Velocity = FVector(0.0f, 0.0f, 0.0f);
+	}
+
+	OutIndices.SetNumUninitialized(Header.NumIndices);
+	if(Header.bIndices16) {
+		const uint16 *Indices16 = (const uint16*)IndexData;
+		for(int32 i = 0; i < Header.NumIndices; i++) {
+			OutIndices[i] = Indices16[i];
+		}
+	} else {
+		FMemory::Memcpy(OutIndices.GetData(), IndexData, IndexSize);
+	}
+
+	return true;
+}
+
+void UNeoFurAsset::SerializeCooked(FArchive &Ar)
+{
+#if WITH_EDITOR
+	if(!Ar.IsLoading()) {
+
+		TArray<uint8> Packed;
+		NeoFurPackCookedData(Vertices, Indices, Packed);
+
+		CookedBulkData.SetBulkDataFlags(BULKDATA_ForceInlinePayload);
+		CookedBulkData.Lock(LOCK_READ_WRITE);
+		FMemory::Memcpy(CookedBulkData.Realloc(Packed.Num()), Packed.GetData(), Packed.Num());
+		CookedBulkData.Unlock();
+	}
+#endif
+
+	CookedBulkData.Serialize(Ar, this);
+	Ar << BonePalette;
+	Ar << MorphTargetDeltas;
+
+	if(Ar.IsLoading()) {
+
+		const uint8 *Data = (const uint8*)CookedBulkData.Lock(LOCK_READ_ONLY);
+		if(!NeoFurUnpackCookedData(Data, CookedBulkData.GetBulkDataSize(), Vertices, Indices)) {
+			UE_LOG(NeoFur, Error, TEXT("Cooked fur data for %s is truncated."), *GetPathName());
+			Vertices.Empty();
+			Indices.Empty();
+		}
+		CookedBulkData.Unlock();
+
+		// Nothing reads this again once it's unpacked.
+		CookedBulkData.RemoveBulkData();
+
+		BuildMorphTargetDeltaIndices();
+	}
+}
+
+void UNeoFurAsset::BuildDerivedData()
+{
 	Vertices.Empty();
 	Indices.Empty();
 	OriginalIndexToNewIndexMapping.Empty();
@@ -361,58 +915,9 @@ void UNeoFurAsset::RegenerateFromSkeletalMesh()
 			DstVert.TanX = SrcVert.TangentX;
 			DstVert.TanZ = SrcVert.TangentZ;
 
-			// FIXME: Exceptionally dumb spline setup. This just finds
-			// the closest splines to the point and uses an
-			// interpolated version of those splines' end points to
-			// replace this vertex's normal (and the spring direction
-			// that goes with it). We should use three points in th
-			// future.
-			
-			// This code is duplicated for skeletal mesh and static
-			// meshes separately. Might want to condense it into a
-			// common piece of code some day.
-
-			float ClosestSplineDist = FLT_MAX;
-			FVector SplineDirection = SrcVert.TangentZ;
-			FVector SplineOrigin = SrcVert.Position;
-			
-			float ClosestSplineDist2 = FLT_MAX;
-			FVector SplineDirection2 = SrcVert.TangentZ;
-			FVector SplineOrigin2 = SrcVert.Position;
-
-			// Splines.
-			for(int32 k = 0; k < SplineLines.Num(); k++) {
-				float s = (SplineLines[k][0] - DstVert.Position).SizeSquared();
-				if(s < ClosestSplineDist) {
-
-					// Bump current down to second place.
-					ClosestSplineDist2 = ClosestSplineDist;
-					SplineOrigin2 = SplineOrigin;
-					SplineDirection2 = SplineDirection;
-
-					ClosestSplineDist = s;
-					SplineOrigin = SplineLines[k][0];
-					SplineDirection = SplineLines[k][SplineLines[k].Num() - 1] - SplineOrigin;
-
-				} else if(s < ClosestSplineDist2) {
-
-					// Between first and second.
-					ClosestSplineDist2 = s;
-					SplineOrigin2 = SplineLines[k][0];
-					SplineDirection2 = SplineLines[k][SplineLines[k].Num() - 1] - SplineOrigin2;
-				}
-			}
-			
-			ClosestSplineDist  = sqrt(ClosestSplineDist);
-			ClosestSplineDist2 = sqrt(ClosestSplineDist2);
-
-			float TotalDist = ClosestSplineDist + ClosestSplineDist2;
-			ClosestSplineDist /= TotalDist;
-			ClosestSplineDist2 /= TotalDist;
-			
-			SplineDirection = SplineDirection * ClosestSplineDist2 + SplineDirection2 * ClosestSplineDist;
-
-			DstVert.CombedDirectionAndLength = SplineDirection;
+			// Splines get blended in by SetupSplines() once everything
+			// is copied over.
+			DstVert.CombedDirectionAndLength = SrcVert.TangentZ;
 
 			for(int32 k = 0; k < MAX_TEXCOORDS; k++) {
 				DstVert.UVs[k] = SrcVert.UVs[k];
@@ -432,7 +937,8 @@ void UNeoFurAsset::RegenerateFromSkeletalMesh()
 			}
 		}
 
-		
+		SetupSplines(Vertices, SplineLines);
+
 		UMorphTarget *MorphTarget = nullptr;
 		for(int32 i = 0; i < SkeletalMesh->MorphTargets.Num(); i++) {
 			if(FName(*MorphTargetName) == SkeletalMesh->MorphTargets[i]->GetFName()) {
@@ -546,6 +1052,121 @@ void UNeoFurAsset::RegenerateFromSkeletalMesh()
 		SetupSplines(Vertices, SplineLines);
 	}
 
+	BuildBonePalette();
+	BuildMorphTargetDeltas();
+}
+
+void UNeoFurAsset::BuildBonePalette()
+{
+	BonePalette.Empty();
+
+	// Skeleton bone index -> palette index.
+	TMap<uint16, uint16> SkeletonToPalette;
+
+	for(int32 i = 0; i < Vertices.Num(); i++) {
+		FNeoFurComponentSceneProxy::VertexType &Vert = Vertices[i];
+		for(int32 j = 0; j < 4; j++) {
+
+			// Zero-weight influences are skipped by the simulation, so they
+			// don't need a palette entry.
+			if(!Vert.InfluenceWeights[j]) {
+				Vert.InfluenceBones[j] = 0;
+				continue;
+			}
+
+			uint16 *PaletteIndex = SkeletonToPalette.Find(Vert.InfluenceBones[j]);
+			if(!PaletteIndex) {
+				PaletteIndex = &SkeletonToPalette.Add(Vert.InfluenceBones[j], BonePalette.Num());
+				BonePalette.Add(Vert.InfluenceBones[j]);
+			}
+			Vert.InfluenceBones[j] = *PaletteIndex;
+		}
+	}
+
+	UE_LOG(NeoFur, Log, TEXT("Fur uses %d bones."), BonePalette.Num());
+}
+
+void UNeoFurAsset::BuildMorphTargetDeltas()
+{
+	MorphTargetDeltas.Empty();
+
+	if(SkeletalMesh) {
+
+		for(int32 i = 0; i < SkeletalMesh->MorphTargets.Num(); i++) {
+
+			UMorphTarget *MorphTarget = SkeletalMesh->MorphTargets[i];
+			if(!MorphTarget) continue;
+
+			int32 NumDeltas = 0;
+		  #if ENGINE_MINOR_VERSION < 13
+			FVertexAnimDelta *Deltas = MorphTarget->GetDeltasAtTime(0.0f, 0, nullptr, NumDeltas);
+		  #else
+			FMorphTargetDelta *Deltas = GetDeltaFromMorphTarget(MorphTarget, 0, NumDeltas);
+		  #endif
+			if(!Deltas) continue;
+
+			FNeoFurMorphTargetDeltas Table;
+			Table.Name = MorphTarget->GetFName();
+			Table.VertexIndices.Reserve(NumDeltas);
+			Table.Deltas.Reserve(NumDeltas);
+
+			bool bBadDeltas = false;
+
+			for(int32 k = 0; k < NumDeltas; k++) {
+
+				// Assets from before OriginalIndexToNewIndexMapping was
+				// added use the mesh's vertex indices directly.
+				int32 VertexIndex = Deltas[k].SourceIdx;
+				if(OriginalIndexToNewIndexMapping.Num()) {
+					if(VertexIndex >= OriginalIndexToNewIndexMapping.Num()) {
+						bBadDeltas = true;
+						continue;
+					}
+					VertexIndex = OriginalIndexToNewIndexMapping[VertexIndex];
+					if(VertexIndex == -1) {
+						// Vertex was filtered out of the fur.
+						continue;
+					}
+				}
+
+				if(VertexIndex >= Vertices.Num()) {
+					bBadDeltas = true;
+					continue;
+				}
+
+				FNeoFurComponentSceneProxy::MorphDataVertexType Delta;
+				Delta.Offset = Deltas[k].PositionDelta;
+				Delta.Normal = Deltas[k].TangentZDelta;
+
+				Table.VertexIndices.Add(VertexIndex);
+				Table.Deltas.Add(Delta);
+			}
+
+			if(bBadDeltas) {
+				UE_LOG(NeoFur, Error,
+					TEXT("Bad morph data detected! Morph target %s on growth mesh %s is invalid!"),
+					*MorphTarget->GetName(),
+					*SkeletalMesh->GetName());
+			}
+
+			// Morph targets that don't touch the fur don't need a table.
+			if(Table.VertexIndices.Num()) {
+				MorphTargetDeltas.Add(MoveTemp(Table));
+			}
+		}
+	}
+
+	BuildMorphTargetDeltaIndices();
+
+	UE_LOG(NeoFur, Log, TEXT("Fur uses %d morph targets."), MorphTargetDeltas.Num());
+}
+
+void UNeoFurAsset::BuildMorphTargetDeltaIndices()
+{
+	MorphTargetDeltaIndices.Empty(MorphTargetDeltas.Num());
+	for(int32 i = 0; i < MorphTargetDeltas.Num(); i++) {
+		MorphTargetDeltaIndices.Add(MorphTargetDeltas[i].Name, i);
+	}
 }
 
 #if WITH_EDITOR
@@ -564,6 +1185,9 @@ void UNeoFurAsset::PostEditChangeProperty(FPropertyChangedEvent &PropertyChanged
 	if(SplineDataFbxFilePath.FilePath.Len() == 0) {
 
 		FbxSourceFilePathRelative = TEXT("");
+		SplineSourceHash.Empty();
+		SplineSourcePoints.Empty();
+		SplineSourceLineLengths.Empty();
 		SplineLines.Empty();
 		
 	} else {
@@ -576,18 +1200,75 @@ void UNeoFurAsset::PostEditChangeProperty(FPropertyChangedEvent &PropertyChanged
 				FPlatformProcess::BaseDir(), FbxSourceFilePathRelative);
 		}
 
-		SplineLines.Empty();
-		#if NEOFUR_FBX
-		LoadFurFBXData(FbxSourceFilePathRelative, this);
-		#endif
+		if(UpdateSplineSource(FbxSourceFilePathRelative)) {
+			BuildSplineLinesFromSource();
+		}
 		
 		FPaths::MakePathRelativeTo(FbxSourceFilePathRelative, *FPaths::GameDir());
 	}
 
 	RegenerateFromSkeletalMesh();
 }
+
+bool UNeoFurAsset::UpdateSplineSource(const FString &FullPath)
+{
+	TArray<uint8> FileData;
+	if(!FFileHelper::LoadFileToArray(FileData, *FullPath, FILEREAD_Silent) || FileData.Num() == 0) {
+		// Keep whatever we had, so people without the source file don't
+		// lose the splines just by editing the asset.
+		UE_LOG(NeoFur, Warning, TEXT("Couldn't read spline data file %s. Keeping %d cached splines."),
+			*FullPath, SplineSourceLineLengths.Num());
+		return !SplineSourceHash.IsEmpty();
+	}
+
+	FSHAHash Hash;
+	FSHA1::HashBuffer(FileData.GetData(), FileData.Num(), Hash.Hash);
+	FString NewHash = Hash.ToString();
+
+	if(NewHash == SplineSourceHash) {
+		return true;
+	}
+
+  #if NEOFUR_FBX
+	SplineSourceHash.Empty();
+	SplineSourcePoints.Empty();
+	SplineSourceLineLengths.Empty();
+
+	if(LoadFurFBXData(FullPath, FileData, SplineSourcePoints, SplineSourceLineLengths)) {
+		SplineSourceHash = NewHash;
+		UE_LOG(NeoFur, Log, TEXT("Loaded %d splines (%d points) from %s."),
+			SplineSourceLineLengths.Num(), SplineSourcePoints.Num(), *FullPath);
+	}
+  #else
+	UE_LOG(NeoFur, Error, TEXT("Spline data file %s changed, but FBX support isn't available to reimport it."), *FullPath);
+	return !SplineSourceHash.IsEmpty();
+  #endif
+
+	return true;
+}
 #endif
 
+void UNeoFurAsset::BuildSplineLinesFromSource()
+{
+	SplineLines.Empty(SplineSourceLineLengths.Num());
+
+	int32 PointIndex = 0;
+	for(int32 i = 0; i < SplineSourceLineLengths.Num(); i++) {
+		int32 NumPoints = SplineSourceLineLengths[i];
+		if(NumPoints < 0 || PointIndex + NumPoints > SplineSourcePoints.Num()) {
+			UE_LOG(NeoFur, Error, TEXT("Cached spline data is corrupt. Clear and set the spline data file again."));
+			SplineLines.Empty();
+			return;
+		}
+
+		TArray<FVector> &NewLine = SplineLines[SplineLines.AddDefaulted()];
+		NewLine.SetNumUninitialized(NumPoints);
+		for(int32 j = 0; j < NumPoints; j++) {
+			NewLine[j] = SplineTransform.TransformPosition(SplineSourcePoints[PointIndex++]);
+		}
+	}
+}
+
 
 #if WITH_EDITOR
 
@@ -716,7 +1397,10 @@ private:
 };
 
 
-static void ExtractSplines(FbxNode *Node, int RecursionCount, UNeoFurAsset *asset)
+// Appends every line in the scene to OutPoints, with the number of
+// points in each one in OutLineLengths. SplineTransform isn't applied
+// here, so the result can be cached independently of it.
+static void ExtractSplines(FbxNode *Node, int RecursionCount, TArray<FVector> &OutPoints, TArray<int32> &OutLineLengths)
 {
 	// FIXME: A bunch of this assumes that the FBX file coming in is valid.
 
@@ -750,7 +1434,7 @@ static void ExtractSplines(FbxNode *Node, int RecursionCount, UNeoFurAsset *asse
 		int pointCounter = 0;
 		while(endPointCounter < PointArray->GetCount()) {
 
-			TArray<FVector> NewLine;
+			int32 NumPoints = 0;
 
 			while(pointCounter <= PointArray->GetAt(endPointCounter)) {
 
@@ -758,16 +1442,14 @@ static void ExtractSplines(FbxNode *Node, int RecursionCount, UNeoFurAsset *asse
 					ControlPoints[pointCounter].mData[0],
 					-ControlPoints[pointCounter].mData[1], // FIXME: Why is this inverted?
 					ControlPoints[pointCounter].mData[2]);
-					
-				FTransform &Fixup = asset->SplineTransform;
-				InputVec = Fixup.TransformPosition(InputVec);
 
-				NewLine.Add(InputVec);
+				OutPoints.Add(InputVec);
+				NumPoints++;
 
 				pointCounter++;
 			}
 			
-			asset->SplineLines.Add(NewLine);
+			OutLineLengths.Add(NumPoints);
 
 			pointCounter++;
 			endPointCounter++;
@@ -781,7 +1463,7 @@ static void ExtractSplines(FbxNode *Node, int RecursionCount, UNeoFurAsset *asse
 	
 	for(int i = 0; i < Node->GetChildCount(); i++) {
 		// FIXME: Pass parent transform data down?
-		ExtractSplines(Node->GetChild(i), RecursionCount + 1, asset);
+		ExtractSplines(Node->GetChild(i), RecursionCount + 1, OutPoints, OutLineLengths);
 	}
 }
 
@@ -789,39 +1471,20 @@ static void ExtractSplines(FbxNode *Node, int RecursionCount, UNeoFurAsset *asse
 
 
 
-static void LoadFurFBXData(FString &FileName , UNeoFurAsset *Asset)
+// FileData is the whole file, already read in by the caller.
+static bool LoadFurFBXData(
+	const FString &FileName, const TArray<uint8> &FileData,
+	TArray<FVector> &OutPoints, TArray<int32> &OutLineLengths)
 {
-	// FIXME: I don't know if we should be using C++ standard IO here. Maybe
-	// UE4 has something built in. Maybe it doesn't matter.
-
-	std::ifstream inFile(TCHAR_TO_ANSI(*FileName), std::ios::binary);
-	if(!inFile.good()) {
-		// TODO: Loud error message.
-		return;
-	}
-	
-	// Open file. Find length. Make buffer. Fill buffer. Close file.
-	inFile.seekg(0, inFile.end);
-	size_t fileSize = inFile.tellg();
-
-	if(fileSize == 0) {
-		// TODO: REALLY loud error message. Zero length file is bad.
-		return;
-	}
-
-	inFile.seekg(0, inFile.beg);
-	char *Buffer = new char[fileSize + 1];
-	Buffer[fileSize] = 0; // I'm just going to terminate this as a string in case we're loading some ASCII FBX and want easy debugging.
-	inFile.read(Buffer, fileSize);
-	inFile.close();
+	bool bSuccess = false;
 
 	FbxManager *Manager = FbxManager::Create();
 	FbxScene *Scene = FbxScene::Create(Manager, "Scene");
 	FbxImporter *Importer = FbxImporter::Create(Manager, "Importer");
 	
 	FMemReaderFileInfo Info;
-	Info.Data = (void*)Buffer;
-	Info.Length = fileSize;
+	Info.Data = (void*)FileData.GetData();
+	Info.Length = FileData.Num();
 
 	FMemReaderFbx Stream(Manager);
 	Stream.Open((void*)&Info);
@@ -837,7 +1500,8 @@ static void LoadFurFBXData(FString &FileName , UNeoFurAsset *Asset)
 	
 	if(isFbx) {
 		if(Importer->Import(Scene)) {
-			ExtractSplines(Scene->GetRootNode(), 0, Asset);
+			ExtractSplines(Scene->GetRootNode(), 0, OutPoints, OutLineLengths);
+			bSuccess = true;
 		} else {
 			// Complain loudly.
 			UE_LOG(NeoFur, Error, TEXT("FBX error at scene import: %s"), ANSI_TO_TCHAR(Importer->GetStatus().GetErrorString()));
@@ -851,16 +1515,317 @@ static void LoadFurFBXData(FString &FileName , UNeoFurAsset *Asset)
 	
 	Manager->Destroy();
 
-	delete[] Buffer;
-
+	return bSuccess;
 }
 
 #endif // NEOFUR_FBX
 
 #endif // WITH_EDITOR
 
+#if WITH_DEV_AUTOMATION_TESTS
 
+// ----------------------------------------------------------------------
+// Tests
+// ----------------------------------------------------------------------
 
+// The swap-one-vertex-at-a-time compaction that existing assets were
+// built with. RemoveUnusedVertices() has to match it exactly.
+static void NeoFurReferenceRemoveUnusedVertices(
+	TArray<uint32> &Indices,
+	TArray<FNeoFurComponentSceneProxy::VertexType> &SoftSkinVertices,
+	TArray<int32> &OriginalIndexToNewIndexMapping)
+{
+	for(int32 i = 0; i < SoftSkinVertices.Num(); i++) {
+
+		bool FoundThisVert = false;
+		for(int32 k = 0; k < Indices.Num(); k++) {
+			if(Indices[k] == uint32(i)) {
+				FoundThisVert = true;
+				break;
+			}
+		}
+
+		if(FoundThisVert) continue;
+
+		int32 ReplacementIndex = SoftSkinVertices.Num() - 1;
+		SoftSkinVertices[i] = SoftSkinVertices[ReplacementIndex];
+
+		for(int32 k = 0; k < Indices.Num(); k++) {
+			if(Indices[k] == uint32(ReplacementIndex)) {
+				Indices[k] = i;
+			}
+		}
+
+		for(int32 k = 0; k < OriginalIndexToNewIndexMapping.Num(); k++) {
+			if(OriginalIndexToNewIndexMapping[k] == ReplacementIndex) {
+				OriginalIndexToNewIndexMapping[k] = i;
+			} else if(OriginalIndexToNewIndexMapping[k] == i) {
+				OriginalIndexToNewIndexMapping[k] = -1;
+			}
+		}
+
+		SoftSkinVertices.SetNum(SoftSkinVertices.Num() - 1);
+		i--;
+	}
+}
+
+// The brute force walk over every spline for every vertex. SetupSplines()
+// has to match it exactly, ties included.
+static void NeoFurReferenceSetupSplines(
+	TArray<FNeoFurComponentSceneProxy::VertexType> &Vertices,
+	const TArray< TArray<FVector> > &SplineLines)
+{
+	for(int32 i = 0; i < Vertices.Num(); i++) {
+
+		FNeoFurComponentSceneProxy::VertexType &Vert = Vertices[i];
+
+		float ClosestSplineDist = FLT_MAX;
+		FVector SplineDirection = Vert.CombedDirectionAndLength;
+		float ClosestSplineDist2 = FLT_MAX;
+		FVector SplineDirection2 = Vert.CombedDirectionAndLength;
+
+		for(int32 k = 0; k < SplineLines.Num(); k++) {
+			float s = (SplineLines[k][0] - Vert.Position).SizeSquared();
+			if(s < ClosestSplineDist) {
+				ClosestSplineDist2 = ClosestSplineDist;
+				SplineDirection2 = SplineDirection;
+				ClosestSplineDist = s;
+				SplineDirection = SplineLines[k][SplineLines[k].Num() - 1] - SplineLines[k][0];
+			} else if(s < ClosestSplineDist2) {
+				ClosestSplineDist2 = s;
+				SplineDirection2 = SplineLines[k][SplineLines[k].Num() - 1] - SplineLines[k][0];
+			}
+		}
+
+		ClosestSplineDist  = sqrt(ClosestSplineDist);
+		ClosestSplineDist2 = sqrt(ClosestSplineDist2);
+
+		float TotalDist = ClosestSplineDist + ClosestSplineDist2;
+		ClosestSplineDist /= TotalDist;
+		ClosestSplineDist2 /= TotalDist;
+
+		Vert.CombedDirectionAndLength = SplineDirection * ClosestSplineDist2 + SplineDirection2 * ClosestSplineDist;
+	}
+}
 
+// Bit-for-bit, field by field, so padding doesn't matter.
+static bool NeoFurVerticesIdentical(
+	const FNeoFurComponentSceneProxy::VertexType &A,
+	const FNeoFurComponentSceneProxy::VertexType &B)
+{
+	return
+		!FMemory::Memcmp(&A.Position, &B.Position, sizeof(A.Position)) &&
+		!FMemory::Memcmp(&A.TanX, &B.TanX, sizeof(A.TanX)) &&
+		!FMemory::Memcmp(&A.TanZ, &B.TanZ, sizeof(A.TanZ)) &&
+		!FMemory::Memcmp(A.UVs, B.UVs, sizeof(A.UVs)) &&
+		!FMemory::Memcmp(A.InfluenceBones, B.InfluenceBones, sizeof(A.InfluenceBones)) &&
+		!FMemory::Memcmp(A.InfluenceWeights, B.InfluenceWeights, sizeof(A.InfluenceWeights)) &&
+		!FMemory::Memcmp(&A.CombedDirectionAndLength, &B.CombedDirectionAndLength, sizeof(A.CombedDirectionAndLength)) &&
+		!FMemory::Memcmp(&A.Velocity, &B.Velocity, sizeof(A.Velocity));
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(
+	FNeoFurAssetGenerationMatchesReferenceTest,
+	"NeoFur.Asset.GenerationMatchesReference",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FNeoFurAssetGenerationMatchesReferenceTest::RunTest(const FString &Parameters)
+{
+	FRandomStream Random(0x4E656F46);
+
+	// Includes runs with no splines and with only one, where the second
+	// closest falls back to the vertex's own direction.
+	const int32 NumSplinesPerRun[] = { 0, 1, 2, 7, 64, 300 };
+
+	for(int32 Run = 0; Run < ARRAY_COUNT(NumSplinesPerRun); Run++) {
+
+		// Everything sits on a coarse grid, so there are plenty of
+		// duplicate vertex positions, duplicate spline roots, and vertices
+		// exactly the same distance from several roots.
+		const int32 NumVertices = 400;
+		TArray<FNeoFurComponentSceneProxy::VertexType> Vertices;
+		Vertices.SetNumZeroed(NumVertices);
+		for(int32 i = 0; i < NumVertices; i++) {
+			FNeoFurComponentSceneProxy::VertexType &Vert = Vertices[i];
+			Vert.Position = FVector(Random.RandRange(-4, 4), Random.RandRange(-4, 4), Random.RandRange(-4, 4)) * 2.0f;
+			Vert.TanZ = FVector(0.0f, 0.0f, 1.0f);
+			Vert.CombedDirectionAndLength = Random.GetUnitVector();
+			Vert.UVs[0] = FVector2D(float(i), float(Run));
+			Vert.InfluenceBones[0] = uint16(i);
+			Vert.InfluenceWeights[0] = 255;
+		}
+
+		// Only some vertices get used. Alternate runs leave the last
+		// vertex out, which is the one case where the old mapping didn't
+		// go to -1.
+		TArray<uint32> Indices;
+		for(int32 i = 0; i < NumVertices * 2; i++) {
+			int32 Index = Random.RandRange(0, NumVertices - 1);
+			if(Index % 3 == 1 || ((Run & 1) && Index == NumVertices - 1)) continue;
+			Indices.Add(Index);
+		}
+		while(Indices.Num() % 3) {
+			Indices.Add(Indices[0]);
+		}
+
+		TArray<int32> Mapping;
+		Mapping.SetNumUninitialized(NumVertices + 16);
+		for(int32 i = 0; i < Mapping.Num(); i++) {
+			Mapping[i] = i < NumVertices ? i : -1;
+		}
+
+		TArray< TArray<FVector> > SplineLines;
+		for(int32 k = 0; k < NumSplinesPerRun[Run]; k++) {
+			TArray<FVector> &Spline = SplineLines[SplineLines.AddDefaulted()];
+			Spline.Add(FVector(Random.RandRange(-4, 4), Random.RandRange(-4, 4), Random.RandRange(-4, 4)) * 2.0f);
+			if(k > 0 && Random.RandRange(0, 3) == 0) {
+				Spline[0] = SplineLines[Random.RandRange(0, k - 1)][0];
+			}
+			Spline.Add(Spline[0] + Random.GetUnitVector() * 3.0f);
+			Spline.Add(Spline[0] + Random.GetUnitVector() * 6.0f);
+		}
+
+		TArray<FNeoFurComponentSceneProxy::VertexType> ExpectedVertices = Vertices;
+		TArray<uint32> ExpectedIndices = Indices;
+		TArray<int32> ExpectedMapping = Mapping;
+		NeoFurReferenceRemoveUnusedVertices(ExpectedIndices, ExpectedVertices, ExpectedMapping);
+		NeoFurReferenceSetupSplines(ExpectedVertices, SplineLines);
+
+		RemoveUnusedVertices(Indices, Vertices, Mapping);
+		SetupSplines(Vertices, SplineLines);
+
+		TestEqual(TEXT("Vertex count"), Vertices.Num(), ExpectedVertices.Num());
+		TestTrue(TEXT("Indices"), Indices == ExpectedIndices);
+		TestTrue(TEXT("OriginalIndexToNewIndexMapping"), Mapping == ExpectedMapping);
+
+		int32 NumMismatched = 0;
+		for(int32 i = 0; i < FMath::Min(Vertices.Num(), ExpectedVertices.Num()); i++) {
+			if(!NeoFurVerticesIdentical(Vertices[i], ExpectedVertices[i])) {
+				NumMismatched++;
+			}
+		}
+		if(NumMismatched) {
+			AddError(FString::Printf(TEXT("%d of %d vertices differ with %d splines."),
+				NumMismatched, Vertices.Num(), SplineLines.Num()));
+		}
+	}
+
+	return true;
+}
+
+#if WITH_EDITOR
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(
+	FNeoFurCookedDataRoundTripTest,
+	"NeoFur.Asset.CookedDataRoundTrip",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
 
+bool FNeoFurCookedDataRoundTripTest::RunTest(const FString &Parameters)
+{
+	FRandomStream Random(0x436F6F6B);
+
+	// The last mesh is too big for 16-bit indices.
+	const int32 NumVerticesPerRun[] = { 0, 1, 500, MAX_uint16 + 100 };
+	const int32 NumUVChannelsPerRun[] = { 0, 1, 2, MAX_TEXCOORDS };
+
+	for(int32 Run = 0; Run < ARRAY_COUNT(NumVerticesPerRun); Run++) {
+
+		int32 NumVertices = NumVerticesPerRun[Run];
+		int32 NumUVChannels = FMath::Min(NumUVChannelsPerRun[Run], int32(MAX_TEXCOORDS));
+		float Extent = 10.0f + 200.0f * Run;
+
+		TArray<FNeoFurComponentSceneProxy::VertexType> Vertices;
+		Vertices.SetNumZeroed(NumVertices);
+		for(int32 i = 0; i < NumVertices; i++) {
+			FNeoFurComponentSceneProxy::VertexType &Vert = Vertices[i];
+			Vert.Position = FVector(
+				Random.FRandRange(-Extent, Extent),
+				Random.FRandRange(-Extent, Extent),
+				Random.FRandRange(0.0f, Extent));
+			Vert.TanX = Random.GetUnitVector();
+			Vert.TanZ = Random.GetUnitVector();
+			Vert.CombedDirectionAndLength = Random.GetUnitVector() * Random.FRandRange(0.0f, 5.0f);
+			for(int32 k = 0; k < NumUVChannels; k++) {
+				Vert.UVs[k] = FVector2D(Random.FRandRange(-2.0f, 2.0f), Random.FRandRange(0.0f, 1.0f));
+			}
+			for(int32 k = 0; k < 4; k++) {
+				Vert.InfluenceBones[k] = uint16(Random.RandRange(0, 300));
+				Vert.InfluenceWeights[k] = uint8(Random.RandRange(0, 255));
+			}
+		}
+
+		TArray<uint32> Indices;
+		for(int32 i = 0; NumVertices && i < NumVertices * 3; i++) {
+			Indices.Add(uint32(Random.RandRange(0, NumVertices - 1)));
+		}
+
+		TArray<uint8> Packed;
+		NeoFurPackCookedData(Vertices, Indices, Packed);
+
+		TArray<FNeoFurComponentSceneProxy::VertexType> Unpacked;
+		TArray<uint32> UnpackedIndices;
+		if(!NeoFurUnpackCookedData(Packed.GetData(), Packed.Num(), Unpacked, UnpackedIndices)) {
+			AddError(FString::Printf(TEXT("Couldn't unpack %d vertices."), NumVertices));
+			continue;
+		}
+
+		// Truncated data has to be refused, not read past the end.
+		if(Packed.Num()) {
+			TArray<FNeoFurComponentSceneProxy::VertexType> TruncatedVertices;
+			TArray<uint32> TruncatedIndices;
+			TestFalse(TEXT("Unpack truncated"), NeoFurUnpackCookedData(Packed.GetData(), Packed.Num() - 1, TruncatedVertices, TruncatedIndices));
+		}
+
+		TestTrue(TEXT("Indices"), UnpackedIndices == Indices);
+		if(Unpacked.Num() != NumVertices) {
+			AddError(FString::Printf(TEXT("Packed %d vertices, unpacked %d."), NumVertices, Unpacked.Num()));
+			continue;
+		}
+
+		// Positions are rounded to the nearest of 65536 steps across the
+		// bounds. Everything in half precision is within one unit in the
+		// last place, which is 1/1024 for anything under 1 and 1/512 for
+		// anything under 2.
+		FBox Bounds(ForceInit);
+		for(int32 i = 0; i < NumVertices; i++) {
+			Bounds += Vertices[i].Position;
+		}
+		FVector PositionTolerance = Bounds.IsValid ? (Bounds.Max - Bounds.Min) / float(MAX_uint16) * 0.5f + FVector(KINDA_SMALL_NUMBER) : FVector::ZeroVector;
+		const float HalfTolerance = 1.0f / 1024.0f;
+
+		float MaxPositionError = 0.0f;
+		int32 NumMismatched = 0;
+		for(int32 i = 0; i < NumVertices; i++) {
+			const FNeoFurComponentSceneProxy::VertexType &A = Vertices[i];
+			const FNeoFurComponentSceneProxy::VertexType &B = Unpacked[i];
+			FVector PositionError = (A.Position - B.Position).GetAbs();
+			MaxPositionError = FMath::Max(MaxPositionError, PositionError.GetMax());
+
+			bool bMatch =
+				PositionError.X <= PositionTolerance.X &&
+				PositionError.Y <= PositionTolerance.Y &&
+				PositionError.Z <= PositionTolerance.Z &&
+				A.TanX.Equals(B.TanX, HalfTolerance) &&
+				A.TanZ.Equals(B.TanZ, HalfTolerance) &&
+				!FMemory::Memcmp(&A.CombedDirectionAndLength, &B.CombedDirectionAndLength, sizeof(FVector)) &&
+				!FMemory::Memcmp(A.InfluenceBones, B.InfluenceBones, sizeof(A.InfluenceBones)) &&
+				!FMemory::Memcmp(A.InfluenceWeights, B.InfluenceWeights, sizeof(A.InfluenceWeights));
+			for(int32 k = 0; k < MAX_TEXCOORDS; k++) {
+				bMatch = bMatch && A.UVs[k].Equals(B.UVs[k], HalfTolerance * 2.0f);
+			}
+
+			if(!bMatch) {
+				NumMismatched++;
+			}
+		}
+
+		if(NumMismatched) {
+			AddError(FString::Printf(TEXT("%d of %d vertices are outside the expected error. Max position error: %f"),
+				NumMismatched, NumVertices, MaxPositionError));
+		}
+	}
+
+	return true;
+}
+#endif // WITH_EDITOR
 
+#endif // WITH_DEV_AUTOMATION_TESTS
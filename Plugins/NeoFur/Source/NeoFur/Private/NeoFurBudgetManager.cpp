@@ -0,0 +1,243 @@
+// ---------------------------------------------------------------------------
+//
+// Copyright (c) 2016 Neoglyphic Entertainment, Inc. All rights reserved.
+//
+// This is part of the NeoFur fur and hair rendering and simulation
+// plugin for Unreal Engine.
+//
+// Do not redistribute NeoFur without the express permission of
+// Neoglyphic Entertainment. See your license for specific details.
+//
+// -------------------------- END HEADER -------------------------------------
+
+#include "NeoFur.h"
+
+#include "NeoFurAsset.h"
+#include "NeoFurComponent.h"
+#include "NeoFurBudgetManager.h"
+#include "NeoFurProfiling.h"
+
+// Screen sizes (see FEntry::Significance) below which the simulation
+// steps at half and quarter rate.
+static const float NeoFurHalfRateSignificance = 0.1f;
+static const float NeoFurQuarterRateSignificance = 0.04f;
+
+static TMap<TWeakObjectPtr<UWorld>, TSharedPtr<FNeoFurBudgetManager>> NeoFurBudgetManagers;
+static FDelegateHandle NeoFurBudgetPreActorTickHandle;
+static FDelegateHandle NeoFurBudgetWorldCleanupHandle;
+
+FNeoFurBudgetManager *FNeoFurBudgetManager::Get(UWorld *World)
+{
+	if(!World) return nullptr;
+
+	if(!NeoFurBudgetPreActorTickHandle.IsValid()) {
+		NeoFurBudgetPreActorTickHandle = FWorldDelegates::OnWorldPreActorTick.AddStatic(&FNeoFurBudgetManager::OnWorldPreActorTick);
+		NeoFurBudgetWorldCleanupHandle = FWorldDelegates::OnWorldCleanup.AddStatic(&FNeoFurBudgetManager::OnWorldCleanup);
+	}
+
+	TSharedPtr<FNeoFurBudgetManager> &Manager = NeoFurBudgetManagers.FindOrAdd(World);
+	if(!Manager.IsValid()) {
+		Manager = MakeShareable(new FNeoFurBudgetManager);
+	}
+
+	return Manager.Get();
+}
+
+FNeoFurBudgetManager *FNeoFurBudgetManager::Find(UWorld *World)
+{
+	const TSharedPtr<FNeoFurBudgetManager> *Manager = NeoFurBudgetManagers.Find(World);
+	return Manager ? Manager->Get() : nullptr;
+}
+
+FNeoFurBudgetManager::FNeoFurBudgetManager()
+{
+	MaxShells = NEOFUR_DEFAULT_SHELL_BUDGET;
+	MaxControlPoints = NEOFUR_DEFAULT_CONTROL_POINT_BUDGET;
+	TotalActiveShells = 0;
+	TotalSimulatedControlPoints = 0;
+}
+
+void FNeoFurBudgetManager::OnWorldPreActorTick(UWorld *World, ELevelTick TickType, float DeltaSeconds)
+{
+	// Fur ticks in the editor too, so this runs for every tick type.
+	FNeoFurBudgetManager *Manager = Find(World);
+	if(Manager) {
+		Manager->Tick(DeltaSeconds);
+	}
+}
+
+void FNeoFurBudgetManager::OnWorldCleanup(UWorld *World, bool bSessionEnded, bool bCleanupResources)
+{
+	NeoFurBudgetManagers.Remove(World);
+}
+
+void FNeoFurBudgetManager::RegisterComponent(UNeoFurComponent *Component)
+{
+	Components.AddUnique(Component);
+}
+
+void FNeoFurBudgetManager::UnregisterComponent(UNeoFurComponent *Component)
+{
+	Components.RemoveSwap(Component);
+}
+
+void FNeoFurBudgetManager::SetBudget(int32 InMaxShells, int32 InMaxControlPoints)
+{
+	MaxShells = FMath::Max(InMaxShells, 0);
+	MaxControlPoints = FMath::Max(InMaxControlPoints, 0);
+}
+
+void FNeoFurBudgetManager::Tick(float DeltaSeconds)
+{
+	NEOFUR_PROFILE_SCOPE("FNeoFurBudgetManager::Tick");
+
+	Components.RemoveAllSwap(
+		[](const TWeakObjectPtr<UNeoFurComponent> &Component) { return !Component.IsValid(); });
+
+	UWorld *World = Components.Num() ? Components[0]->GetWorld() : nullptr;
+	if(!World) return;
+
+	// FIXME: This is probably a terrible way to find views for LOD stuff.
+	const TArray<FVector> &ViewLocations = World->ViewLocationsRenderedLastFrame;
+
+	// Nothing has been rendered yet, so there's nothing to base LOD on.
+	// Leave everything where it was.
+	if(!ViewLocations.Num()) return;
+
+	int32 NumComponents = Components.Num();
+	Entries.SetNumUninitialized(NumComponents, false);
+
+	// LastRenderTime only moves when the renderer finds the bounds inside
+	// a view frustum and not occluded. Always allow at least a couple of
+	// frames, so a low framerate doesn't make everything flicker off.
+	float WorldTime = World->GetTimeSeconds();
+	float OffscreenTime = FMath::Max(NEOFUR_OFFSCREEN_SIMULATION_TIME, DeltaSeconds * 2.0f);
+
+	// Gather.
+	for(int32 i = 0; i < NumComponents; i++) {
+		const UNeoFurComponent *Component = Components[i].Get();
+		FEntry &Entry = Entries[i];
+		Entry.Location                  = Component->GetComponentLocation();
+		Entry.BoundsRadius              = Component->Bounds.SphereRadius;
+		Entry.LODStartDistance          = Component->LODStartDistance;
+		Entry.LODEndDistance            = Component->LODEndDistance;
+		Entry.MaximumDistanceFromCamera = Component->MaximumDistanceFromCamera;
+		Entry.ShellCount                = Component->ShellCount;
+		Entry.MinimumShellCount         = FMath::Clamp(Component->LODMinimumShellCount, 1, FMath::Max(Component->ShellCount, 1));
+		Entry.ControlPointCount         = Component->FurAsset ? Component->FurAsset->Vertices.Num() : 0;
+		Entry.bOnScreen                 = WorldTime - Component->LastRenderTime <= OffscreenTime;
+	}
+
+	// Work out what everyone wants, and how much they matter. This is the
+	// same distance curve the components used to run on their own.
+	for(int32 i = 0; i < NumComponents; i++) {
+		FEntry &Entry = Entries[i];
+
+		float MinDist = FLT_MAX;
+		for(int32 ViewIndex = 0; ViewIndex < ViewLocations.Num(); ViewIndex++) {
+			float Dist = (ViewLocations[ViewIndex] - Entry.Location).SizeSquared();
+			if(Dist < MinDist) {
+				MinDist = Dist;
+			}
+		}
+		MinDist = FMath::Sqrt(MinDist);
+
+		Entry.ShellFade = 1.0f;
+		Entry.RateDivisor = 1;
+		Entry.GrantedShells = 0;
+
+		if(MinDist > Entry.MaximumDistanceFromCamera || !Entry.ControlPointCount || Entry.ShellCount <= 0) {
+			Entry.DesiredShells = 0;
+			Entry.Significance = 0.0f;
+			continue;
+		}
+
+		float LODVal = (MinDist - Entry.LODStartDistance) / (Entry.LODEndDistance - Entry.LODStartDistance);
+		LODVal = 1.0f - FMath::Clamp(LODVal, 0.0f, 1.0f);
+		float LODCurve = 100.0f; // FIXME: Make adjustable!
+		LODVal = pow(LODCurve, LODVal) / LODCurve;
+		Entry.DesiredShells = Entry.MinimumShellCount + LODVal * (Entry.ShellCount - Entry.MinimumShellCount);
+		Entry.DesiredShells = FMath::Clamp(Entry.DesiredShells, Entry.MinimumShellCount, Entry.ShellCount);
+
+		if(MinDist > Entry.LODEndDistance) {
+			Entry.ShellFade = 1.0f - (MinDist - Entry.LODEndDistance) / (Entry.MaximumDistanceFromCamera - Entry.LODEndDistance);
+		}
+
+		// Rough screen size. The field of view is the same for every
+		// component, so it doesn't change the order.
+		Entry.Significance = Entry.BoundsRadius / FMath::Max(MinDist, 1.0f);
+
+		if(Entry.Significance < NeoFurQuarterRateSignificance) {
+			Entry.RateDivisor = 4;
+		} else if(Entry.Significance < NeoFurHalfRateSignificance) {
+			Entry.RateDivisor = 2;
+		}
+	}
+
+	// Biggest on screen first.
+	SortedEntries.SetNumUninitialized(NumComponents, false);
+	for(int32 i = 0; i < NumComponents; i++) {
+		SortedEntries[i] = i;
+	}
+	const TArray<FEntry> &SortEntries = Entries;
+	SortedEntries.Sort(
+		[&SortEntries](int32 A, int32 B) { return SortEntries[A].Significance > SortEntries[B].Significance; });
+
+	// Everything visible gets its minimum shell count, as long as there's
+	// room for it. This is also the only place control points get spent,
+	// since a component either simulates all of them or isn't drawn.
+	int32 RemainingShells = MaxShells ? MaxShells : MAX_int32;
+	int32 RemainingControlPoints = MaxControlPoints ? MaxControlPoints : MAX_int32;
+	int32 TotalExtraShells = 0;
+	TotalSimulatedControlPoints = 0;
+
+	for(int32 i = 0; i < NumComponents; i++) {
+		FEntry &Entry = Entries[SortedEntries[i]];
+		if(!Entry.DesiredShells) continue;
+
+		if(!Entry.bOnScreen) {
+			Entry.GrantedShells = Entry.MinimumShellCount;
+			continue;
+		}
+
+		if(Entry.MinimumShellCount > RemainingShells || Entry.ControlPointCount > RemainingControlPoints) {
+			continue;
+		}
+
+		Entry.GrantedShells = Entry.MinimumShellCount;
+		RemainingShells -= Entry.MinimumShellCount;
+		RemainingControlPoints -= Entry.ControlPointCount;
+		TotalSimulatedControlPoints += Entry.ControlPointCount;
+		TotalExtraShells += Entry.DesiredShells - Entry.MinimumShellCount;
+	}
+
+	// Spread the rest over the extra shells. If it doesn't all fit, every
+	// component gets the same fraction of what it asked for, and the
+	// distance curve already gives the closer ones more.
+	float ExtraScale = 1.0f;
+	if(TotalExtraShells > RemainingShells) {
+		ExtraScale = float(RemainingShells) / float(TotalExtraShells);
+	}
+
+	TotalActiveShells = 0;
+	for(int32 i = 0; i < NumComponents; i++) {
+		FEntry &Entry = Entries[i];
+		if(Entry.GrantedShells && Entry.bOnScreen) {
+			Entry.GrantedShells += int32(float(Entry.DesiredShells - Entry.MinimumShellCount) * ExtraScale);
+			TotalActiveShells += Entry.GrantedShells;
+		}
+	}
+
+	// Hand the results back. Fur that's on screen but didn't fit keeps its
+	// proxy and just isn't drawn or simulated. Tearing the proxy down would
+	// stop LastRenderTime, and it'd come back as off screen next time
+	// around, only to be rebuilt and then dropped again.
+	for(int32 i = 0; i < NumComponents; i++) {
+		UNeoFurComponent *Component = Components[i].Get();
+		const FEntry &Entry = Entries[i];
+		Component->ApplyBudgetedLOD(
+			Entry.GrantedShells, Entry.ShellFade, Entry.RateDivisor,
+			Entry.bOnScreen && Entry.GrantedShells > 0, Entry.DesiredShells > 0);
+	}
+}
+
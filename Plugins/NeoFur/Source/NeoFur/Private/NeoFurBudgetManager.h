@@ -0,0 +1,100 @@
+// ---------------------------------------------------------------------------
+//
+// Copyright (c) 2016 Neoglyphic Entertainment, Inc. All rights reserved.
+//
+// This is part of the NeoFur fur and hair rendering and simulation
+// plugin for Unreal Engine.
+//
+// Do not redistribute NeoFur without the express permission of
+// Neoglyphic Entertainment. See your license for specific details.
+//
+// -------------------------- END HEADER -------------------------------------
+
+#pragma once
+
+#include "NeoFur.h"
+
+class UNeoFurComponent;
+
+// Per-world fur LOD and budget. Once per frame, before any actors tick,
+// this works out the shell count LOD of every registered fur component
+// in one pass, then trims the result down to fit the world's shell and
+// simulated control point budgets. The components just pick up the
+// result in their own tick.
+//
+// How big a component is on screen also picks how often its simulation
+// steps. See NEOFUR_SIMULATION_STEP_RATE. Components that weren't
+// rendered recently don't simulate at all. They keep their minimum shell
+// count, so the renderer can tell us when they're back on screen, but
+// that doesn't count against the budget since culled fur costs nothing.
+//
+// Budget goes to the components that are biggest on screen first. Every
+// visible component needs at least its minimum shell count to be drawn
+// at all, so the smallest ones get dropped when there isn't enough to
+// go around. Whatever is left over after that is spread over the extra
+// shells everyone wanted.
+class FNeoFurBudgetManager
+{
+public:
+
+	// Returns the manager for World, creating it if needed.
+	static FNeoFurBudgetManager *Get(UWorld *World);
+
+	// Returns the manager for World, or nullptr if nothing has registered
+	// with it yet.
+	static FNeoFurBudgetManager *Find(UWorld *World);
+
+	void RegisterComponent(UNeoFurComponent *Component);
+	void UnregisterComponent(UNeoFurComponent *Component);
+
+	void SetBudget(int32 InMaxShells, int32 InMaxControlPoints);
+
+	// Totals after last frame's budgeting.
+	int32 GetTotalActiveShellCount() const { return TotalActiveShells; }
+	int32 GetTotalSimulatedControlPointCount() const { return TotalSimulatedControlPoints; }
+
+private:
+
+	FNeoFurBudgetManager();
+
+	void Tick(float DeltaSeconds);
+
+	static void OnWorldPreActorTick(UWorld *World, ELevelTick TickType, float DeltaSeconds);
+	static void OnWorldCleanup(UWorld *World, bool bSessionEnded, bool bCleanupResources);
+
+	// Everything the LOD pass needs about one component, gathered up
+	// front so the pass itself only touches this array.
+	struct FEntry
+	{
+		FVector Location;
+		float BoundsRadius;
+		float LODStartDistance;
+		float LODEndDistance;
+		float MaximumDistanceFromCamera;
+		int32 ShellCount;
+		int32 MinimumShellCount;
+		int32 ControlPointCount;
+		bool bOnScreen;
+
+		// Results.
+		float Significance;
+		float ShellFade;
+		int32 RateDivisor;
+		int32 DesiredShells;
+		int32 GrantedShells;
+	};
+
+	TArray<TWeakObjectPtr<UNeoFurComponent>> Components;
+
+	// Per-frame working data. Kept around so it doesn't get reallocated
+	// every frame.
+	TArray<FEntry> Entries;
+	TArray<int32> SortedEntries;
+
+	int32 MaxShells;
+	int32 MaxControlPoints;
+
+	int32 TotalActiveShells;
+	int32 TotalSimulatedControlPoints;
+};
+
@@ -14,11 +14,15 @@
 
 #include "SkeletalRenderPublic.h"
 #include "PhysicsEngine/BodySetup.h"
+#include "PhysicsEngine/PhysicsAsset.h"
 
 #include "NeoFurAsset.h"
 #include "NeoFurComponentSceneProxy.h"
+#include "NeoFurProxyPrivateData.h"
 #include "NeoFurComponent.h"
 #include "NeoFurVertexFactory.h"
+#include "NeoFurBudgetManager.h"
+#include "NeoFurForceFieldRegistry.h"
 
 
 #include "EngineModule.h"
@@ -41,9 +45,14 @@ UNeoFurComponent::UNeoFurComponent(const FObjectInitializer &ObjectInitializer)
 	ShellCount = 30;
 	ShellDistance = 4.0f;
 
+#if NEOFUR_SERVER_STUB
+	// Nothing to simulate or draw on a dedicated server.
+	PrimaryComponentTick.bCanEverTick = false;
+#else
 	PrimaryComponentTick.bCanEverTick = true;
 	SetComponentTickEnabled(true);
 	bTickInEditor = true;
+#endif
 
 	// We need to have a pretty late update here because of how late
 	// the physical animation system runs. This is in case anyone
@@ -56,7 +65,10 @@ UNeoFurComponent::UNeoFurComponent(const FObjectInitializer &ObjectInitializer)
 	FurAsset = nullptr;
 	
 	bForceCPUSimulation = false;
+#if WITH_EDITORONLY_DATA
 	bDrawSplines = false;
+#endif
+	bCollideWithPhysicsAsset = true;
 
 	BodySetup = nullptr;
 	
@@ -71,6 +83,12 @@ UNeoFurComponent::UNeoFurComponent(const FObjectInitializer &ObjectInitializer)
 	MaximumDistanceFromCamera = 4000.0f; // 100 meters default render distance. Too much or too little?
 
 	ActiveShellCount = 0;
+	bHasBudgetedLOD = false;
+	bBudgetedInRange = false;
+	BudgetedShellFade = 1.0f;
+	SimulationRateDivisor = 1;
+	bSimulationCulled = false;
+	bSimulationNeedsWarmUp = false;
 
     VisibleLengthScale = 1.0f;
     ActiveShellCountScale = 1.0f;
@@ -117,8 +135,21 @@ UStaticMeshComponent *UNeoFurComponent::FindStaticMeshParent() const
 	return ParentStaticComponent;
 }
 
+float UNeoFurComponent::GetMaxStretchDistance() const
+{
+	// Nothing holds the fur in with the distance clamp off, but the springs
+	// keep it from going much past the default.
+	float Multiplier = FurPhysicsParameters.MaxStretchDistanceMultiplier > 0.0f ?
+		FurPhysicsParameters.MaxStretchDistanceMultiplier :
+		NeoFurPhysicsParameters_Default_MaxStretchDistanceMultiplier;
+	return Multiplier * ShellDistance;
+}
+
 FPrimitiveSceneProxy *UNeoFurComponent::CreateSceneProxy()
 {
+#if NEOFUR_SERVER_STUB
+	return nullptr;
+#else
 	// Find a skinned mesh component to pull data from.
 	/*
 	USkinnedMeshComponent *ParentSkinnedComponent = FindSkinnedMeshParent();
@@ -148,7 +179,7 @@ FPrimitiveSceneProxy *UNeoFurComponent::CreateSceneProxy()
 		return nullptr;
 	}
 
-	if(!ActiveShellCount) {
+	if(!bBudgetedInRange) {
 		return nullptr;
 	}
 
@@ -197,6 +228,7 @@ FPrimitiveSceneProxy *UNeoFurComponent::CreateSceneProxy()
 	UpdateLastFrameTransform();
 	
 	return Proxy;
+#endif
 }
 
 void UNeoFurComponent::UpdateLastFrameTransform()
@@ -218,10 +250,10 @@ FBoxSphereBounds UNeoFurComponent::CalcBounds(const FTransform& LocalToWorld) co
 	UStaticMeshComponent *StaticParent = FindStaticMeshParent();
 	if (Parent) {
 		MyBounds = Parent->CalcBounds(LocalToWorld);
-		MyBounds.ExpandBy(FurPhysicsParameters.MaxStretchDistanceMultiplier * ShellDistance);
+		MyBounds.ExpandBy(GetMaxStretchDistance());
 	} else if(StaticParent) {
 		MyBounds = StaticParent->CalcBounds(LocalToWorld);
-		MyBounds.ExpandBy(FurPhysicsParameters.MaxStretchDistanceMultiplier * ShellDistance);
+		MyBounds.ExpandBy(GetMaxStretchDistance());
 	} else {
 		// FIXME: Get the size of the source mesh, whatever it is.
 		MyBounds = Bounds.TransformBy(LocalToWorld);
@@ -283,6 +315,7 @@ void UNeoFurComponent::TickComponent(
 {
 	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
 
+#if !NEOFUR_SERVER_STUB
 	// Wind
 	const FSceneInterface *Scene = GetScene();
 	FVector WindDirection(0.0f, 0.0f, 0.0f);
@@ -301,46 +334,11 @@ void UNeoFurComponent::TickComponent(
 	
 	AccumulatedForces.WindVector = GetComponentTransform().Inverse().TransformVector(AccumulatedForces.WindVector);
 
-	// FIXME: This is probably a terrible way to find views for LOD stuff.
-	// FIXME: Only bother with stuff in each camera's field of view.
-	float MinDist = FLT_MAX;
-	bool FoundCamera = false;
-	FVector MyLocation = GetComponentLocation();
-	UWorld *World = GetWorld();
-	if(World) {
-		for(int32 ViewIndex = 0; ViewIndex < World->ViewLocationsRenderedLastFrame.Num(); ViewIndex++) {
-			float Dist = (World->ViewLocationsRenderedLastFrame[ViewIndex] - MyLocation).SizeSquared();
-			if(Dist < MinDist) {
-				MinDist = Dist;
-			}
-		}
-	}
-	if(MinDist != FLT_MAX) {
-		MinDist = sqrt(MinDist);
-	}
-	
-	float ShellFadeoutAlpha = 1.0f;
-	if(MinDist != FLT_MAX) {
-		int32 OldShellCount = ActiveShellCount;
-		if(MinDist > MaximumDistanceFromCamera) {
-			ActiveShellCount = 0;
-		} else {
-			float LODVal = (MinDist - LODStartDistance) / (LODEndDistance - LODStartDistance);
-			LODVal = 1.0f - FMath::Clamp(LODVal, 0.0f, 1.0f);
-			float LODCurve = 100.0f; // FIXME: Make adjustable!
-			LODVal = pow(LODCurve, LODVal) / LODCurve;
-			ActiveShellCount = LODMinimumShellCount + LODVal * (ShellCount - LODMinimumShellCount);
-			ActiveShellCount = FMath::Clamp(ActiveShellCount, LODMinimumShellCount, ShellCount);
-		}
-		if((ActiveShellCount == 0 && OldShellCount != 0) || (OldShellCount == 0 && ActiveShellCount != 0)) {
-			MarkRenderStateDirty();
-		}
-		if(MinDist > LODEndDistance) {
-			ShellFadeoutAlpha = 1.0f - (MinDist - LODEndDistance) / (MaximumDistanceFromCamera - LODEndDistance);
-		}
-	}
+	// ActiveShellCount and BudgetedShellFade were already set up for this
+	// frame by the world's FNeoFurBudgetManager.
 
 	// Debug spline drawing.
+#if WITH_EDITORONLY_DATA
 	if(FurAsset && GetWorld() && bDrawSplines) {
 		for(int32 i = 0; i < FurAsset->SplineLines.Num(); i++) {
 			FTransform Transform = GetComponentTransform();
@@ -359,15 +357,28 @@ void UNeoFurComponent::TickComponent(
 				FColor(0, 255, 0));
 		}
 	}
+#endif
 
 	UpdatePhysicsParametersInProxy();
 	memset(&AccumulatedForces, 0, sizeof(AccumulatedForces));
 
+	bool bKeepComponentForces = false;
 
 	if (SceneProxy) {
 
-		FNeoFurComponentSceneProxy::MorphDataVertexType *MorphData = nullptr;
-		
+		// The proxy keeps a few of these around and recycles them, so none of
+		// the per-frame data below needs a fresh allocation. If the render
+		// thread is still holding all of them, it's running behind and we just
+		// don't simulate this frame. Fur that's off screen doesn't simulate
+		// either, and skips gathering bones and morphs for it.
+		FNeoFurComponentSceneProxy::SimulationParamsType *SimParams = bSimulationCulled ? nullptr :
+			((FNeoFurComponentSceneProxy*)SceneProxy)->GetNextSimulationParams();
+		if(SimParams) {
+			SimParams->Reset();
+		} else if(!bSimulationCulled) {
+			bKeepComponentForces = true;
+		}
+
 		// This should convert from OLD component space to world space, and
 		// then back to NEW component space.
 		FTransform InvertedComponentTransform = GetComponentTransform().Inverse();
@@ -376,11 +387,9 @@ void UNeoFurComponent::TickComponent(
 		FVector GravityVector(0.0f, 0.0f, GetWorld() ? GetWorld()->GetGravityZ() : 0.0f);
 		GravityVector = InvertedComponentTransform.TransformVector(GravityVector);
 		
-		// Grab bones.
-		FMatrix *BoneMats = nullptr;
+		// Grab bones. Only the ones in the asset's bone palette are needed.
 		USkinnedMeshComponent *Parent = FindSkinnedMeshParent();
-		int32 NumBones = 1;
-		if (Parent) {
+		if (Parent && SimParams) {
 
 			const TArray<FTransform> *SpaceBases = &(Parent->GetSpaceBases());
 			if(Parent->MasterPoseComponent.IsValid()) {
@@ -388,30 +397,38 @@ void UNeoFurComponent::TickComponent(
 			}
 
 			USkeletalMesh *Mesh = Parent->SkeletalMesh;
-			NumBones = SpaceBases->Num();
+			int32 NumBones = SpaceBases->Num();
 
 			// Make sure this is the same skeleton that the asset was based on.
 			if (Mesh && FurAsset) {
 
-				// Raw pointer and manual allocation because we're going to
-				// give ownership of this to the render thread and want to
-				// avoid ref counting magic.
-
 				if(NumBones != Mesh->RefBasesInvMatrix.Num()) {
 					// TODO: Complain loudly! Bones were added/removed after the
 					// asset was created.
 					return;
 				}
-				BoneMats = new FMatrix[NumBones];
-				for (int32 i = 0; i < NumBones; i++) {
-					BoneMats[i] = Mesh->RefBasesInvMatrix[i] * (*SpaceBases)[i].ToMatrixWithScale();
-				}
+
+				SimParams->SetBoneMats(FurAsset->BonePalette, Mesh->RefBasesInvMatrix, *SpaceBases);
 			}
 			
 			// Morph targets
-			if(Mesh && FurAsset && FurAsset->SkeletalMesh) {
+			if(Mesh && FurAsset && FurAsset->MorphTargetDeltas.Num()) {
+
+				int32 NumVertices = FurAsset->Vertices.Num();
+				if(MorphDeltaBuffer.Num() != NumVertices) {
+					MorphDeltaBuffer.SetNumZeroed(NumVertices);
+					MorphDeltaDirtyVertices.Reset();
+				}
+
+				// Only the vertices last frame's morph targets touched need
+				// to be cleared.
+				for(int32 i = 0; i < MorphDeltaDirtyVertices.Num(); i++) {
+					FNeoFurComponentSceneProxy::MorphDataVertexType &Delta = MorphDeltaBuffer[MorphDeltaDirtyVertices[i]];
+					Delta.Offset = FVector::ZeroVector;
+					Delta.Normal = FVector::ZeroVector;
+				}
+				MorphDeltaDirtyVertices.Reset();
 
-				// FIXME: This is a horribly inefficient loop.
 				for(int32 i = 0; i <
 					  #if ENGINE_MINOR_VERSION < 13
 						Parent->ActiveVertexAnims.Num()
@@ -441,68 +458,47 @@ void UNeoFurComponent::TickComponent(
 					UMorphTarget *MorphTarget = Anim.MorphTarget;
 				  #endif
 
-					if(MorphTarget && AnimWeight) {
-					    
-						UMorphTarget *FurMorphTarget = FurAsset->SkeletalMesh->FindMorphTarget(FName(*MorphTarget->GetName()));
-
-						if (FurMorphTarget) {
-						    
-							// Found a matching morph target on our side.
-
-							if (!MorphData) {
-								MorphData = new FNeoFurComponentSceneProxy::MorphDataVertexType[FurAsset->Vertices.Num()];
-								memset(MorphData, 0, sizeof(FNeoFurComponentSceneProxy::MorphDataVertexType) * FurAsset->Vertices.Num());
-							}
-
-							int32 NumDeltas = 0;
-						  #if ENGINE_MINOR_VERSION < 13
-							FVertexAnimDelta *Deltas = FurMorphTarget->GetDeltasAtTime(0.0f, 0, nullptr, NumDeltas);
-						  #else
-							FMorphTargetDelta *Deltas = GetDeltaFromMorphTarget(FurMorphTarget, 0, NumDeltas);
-						  #endif
-
-							for (int32 k = 0; k < NumDeltas; k++) {
-							    
-							  #if ENGINE_MINOR_VERSION < 13
-								FVertexAnimDelta &Delta = Deltas[k];
-							  #else
-								FMorphTargetDelta &Delta = Deltas[k];
-							  #endif
-
-								if(FurAsset->OriginalIndexToNewIndexMapping.Num()) {
-								    
-									if((int32)Delta.SourceIdx < FurAsset->OriginalIndexToNewIndexMapping.Num()
-										&& FurAsset->OriginalIndexToNewIndexMapping[Delta.SourceIdx] < FurAsset->Vertices.Num())
-									{
-										if(FurAsset->OriginalIndexToNewIndexMapping[Delta.SourceIdx] != -1) {
-											MorphData[FurAsset->OriginalIndexToNewIndexMapping[Delta.SourceIdx]].Offset += Delta.PositionDelta * AnimWeight;
-											MorphData[FurAsset->OriginalIndexToNewIndexMapping[Delta.SourceIdx]].Normal += Delta.TangentZDelta * AnimWeight;
-										}
-									} else {
-										UE_LOG(NeoFur, Error,
-											TEXT("Bad morph data detected! Morph target %s on growth mesh %s is invalid!"),
-											*MorphTarget->GetName(),
-											*FurAsset->SkeletalMesh->GetName());
-									}
-
-								} else {
-								    
-									// FIXME: Old version. Should probably be removed.
-									MorphData[Delta.SourceIdx].Offset += Delta.PositionDelta * AnimWeight;
-									MorphData[Delta.SourceIdx].Normal += Delta.TangentZDelta * AnimWeight;
-								}
-							}
-						}
+					if(!MorphTarget || !AnimWeight) continue;
+
+					// Morph targets are matched up with our growth mesh's by
+					// name, same as the engine does for master pose
+					// components.
+					int32 TableIndex = FurAsset->FindMorphTargetDeltas(MorphTarget->GetFName());
+					if(TableIndex == INDEX_NONE) continue;
+
+					const FNeoFurMorphTargetDeltas &Table = FurAsset->MorphTargetDeltas[TableIndex];
+					const int32 *VertexIndices = Table.VertexIndices.GetData();
+					const FNeoFurComponentSceneProxy::MorphDataVertexType *Deltas = Table.Deltas.GetData();
+					for(int32 k = 0; k < Table.VertexIndices.Num(); k++) {
+						FNeoFurComponentSceneProxy::MorphDataVertexType &Delta = MorphDeltaBuffer[VertexIndices[k]];
+						Delta.Offset += Deltas[k].Offset * AnimWeight;
+						Delta.Normal += Deltas[k].Normal * AnimWeight;
 					}
+					MorphDeltaDirtyVertices.Append(Table.VertexIndices);
 				}
 
+				if(MorphDeltaDirtyVertices.Num()) {
+					SimParams->SetMorphData(MorphDeltaBuffer);
+				}
+			}
+
+			// Collision bodies. Each one gets moved into our space once here,
+			// so the simulation doesn't have to know about bones.
+			if(bCollideWithPhysicsAsset) {
+				UpdateCollisionBodies(Parent);
+				FTransform ParentToLocal = Parent->GetComponentTransform() * InvertedComponentTransform;
+				for(int32 i = 0; i < CollisionBodies.Num(); i++) {
+					const FCollisionBody &Body = CollisionBodies[i];
+					if(Body.BoneIndex >= NumBones) continue;
+					SimParams->AddCollisionShape(Body.Shape, (*SpaceBases)[Body.BoneIndex] * ParentToLocal);
+				}
 			}
 		}
 		
-		if(MinDist != FLT_MAX) {
-			((FNeoFurComponentSceneProxy*)SceneProxy)->SetActiveShellCount(
-				int32(float(ActiveShellCount) * FMath::Clamp(ActiveShellCountScale, 0.0f, 1.0f)),
-                ShellFadeoutAlpha);
+		if(bHasBudgetedLOD) {
+			int32 ScaledShellCount = ActiveShellCount ?
+				FMath::Max(int32(float(ActiveShellCount) * FMath::Clamp(ActiveShellCountScale, 0.0f, 1.0f)), 1) : 0;
+			((FNeoFurComponentSceneProxy*)SceneProxy)->SetActiveShellCount(ScaledShellCount, BudgetedShellFade);
 		}
 
         if(Material) {
@@ -510,20 +506,133 @@ void UNeoFurComponent::TickComponent(
                 Material->GetRenderProxy(IsSelected()));
         }
 
+		// Forces sent straight to us, and anything in the world that
+		// reaches our bounds.
+		if(SimParams) {
+			SimParams->AddForces(
+				ComponentForces, FNeoFurForceFieldRegistry::Find(GetWorld()),
+				Bounds.GetBox(), InvertedComponentTransform);
+		}
+
 		// Queue up the simulation.
-		((FNeoFurComponentSceneProxy*)SceneProxy)->RunSimulation(
-			RelativeTransform,
-			DeltaTime,
-			GravityVector,
-			BoneMats, NumBones,
-			MorphData);
+		if(SimParams) {
+			SimParams->RelativeTransformSinceLastFrame = RelativeTransform;
+			SimParams->DeltaTime = DeltaTime;
+			SimParams->LocalSpaceGravity = GravityVector;
+			SimParams->RateDivisor = SimulationRateDivisor;
+			SimParams->WarmUpSteps = bSimulationNeedsWarmUp ? NEOFUR_SIMULATION_WARM_UP_STEPS : 0;
+			bSimulationNeedsWarmUp = false;
+			((FNeoFurComponentSceneProxy*)SceneProxy)->RunSimulation(SimParams);
+		}
 	}
 
 	UpdateLastFrameTransform();
 
-	// Reset forces inputs.
-	AccumulatedForces.NumForcesThisFrame = 0;
-	memset(AccumulatedForces.LocalForces, 0, sizeof(AccumulatedForces.LocalForces));
+	// Reset forces inputs. If the render thread was too far behind to take
+	// this frame's simulation, they go with the next one instead.
+	if(!bKeepComponentForces) {
+		ComponentForces.Reset();
+	}
+#endif
+}
+
+void UNeoFurComponent::UpdateCollisionBodies(USkinnedMeshComponent *Parent)
+{
+	UPhysicsAsset *PhysicsAsset = Parent->GetPhysicsAsset();
+	USkeletalMesh *Mesh = Parent->SkeletalMesh;
+	if(PhysicsAsset == CollisionBodiesPhysicsAsset.Get() && Mesh == CollisionBodiesMesh.Get()) return;
+
+	CollisionBodiesPhysicsAsset = PhysicsAsset;
+	CollisionBodiesMesh = Mesh;
+	CollisionBodies.Reset();
+	if(!PhysicsAsset || !Mesh) return;
+
+  #if ENGINE_MINOR_VERSION < 13
+	const TArray<UBodySetup*> &BodySetups = PhysicsAsset->BodySetup;
+  #else
+	const TArray<USkeletalBodySetup*> &BodySetups = PhysicsAsset->SkeletalBodySetups;
+  #endif
+
+	for(int32 i = 0; i < BodySetups.Num(); i++) {
+		const UBodySetup *Setup = BodySetups[i];
+		if(!Setup) continue;
+
+		int32 BoneIndex = Mesh->RefSkeleton.FindBoneIndex(Setup->BoneName);
+		if(BoneIndex == INDEX_NONE) continue;
+
+		// Capsules run along their local Z.
+		for(int32 k = 0; k < Setup->AggGeom.SphylElems.Num(); k++) {
+			const FKSphylElem &Sphyl = Setup->AggGeom.SphylElems[k];
+			FTransform SphylTransform = Sphyl.GetTransform();
+			FVector HalfLength(0.0f, 0.0f, Sphyl.Length * 0.5f);
+			FCollisionBody Body;
+			Body.BoneIndex = BoneIndex;
+			Body.Shape.Start = SphylTransform.TransformPosition(-HalfLength);
+			Body.Shape.End = SphylTransform.TransformPosition(HalfLength);
+			Body.Shape.Radius = Sphyl.Radius;
+			CollisionBodies.Add(Body);
+		}
+
+		for(int32 k = 0; k < Setup->AggGeom.SphereElems.Num(); k++) {
+			const FKSphereElem &Sphere = Setup->AggGeom.SphereElems[k];
+			FCollisionBody Body;
+			Body.BoneIndex = BoneIndex;
+			Body.Shape.Start = Sphere.Center;
+			Body.Shape.End = Sphere.Center;
+			Body.Shape.Radius = Sphere.Radius;
+			CollisionBodies.Add(Body);
+		}
+	}
+
+	// FIXME: Just keeps whichever ones come first. Should probably prefer
+	// the bodies closest to the fur.
+	if(CollisionBodies.Num() > NEOFUR_MAX_COLLISION_SHAPES) {
+		CollisionBodies.SetNum(NEOFUR_MAX_COLLISION_SHAPES);
+	}
+}
+
+void UNeoFurComponent::OnRegister()
+{
+	Super::OnRegister();
+
+#if !NEOFUR_SERVER_STUB
+	FNeoFurBudgetManager *Manager = FNeoFurBudgetManager::Get(GetWorld());
+	if(Manager) {
+		Manager->RegisterComponent(this);
+	}
+#endif
+}
+
+void UNeoFurComponent::OnUnregister()
+{
+	FNeoFurBudgetManager *Manager = FNeoFurBudgetManager::Find(GetWorld());
+	if(Manager) {
+		Manager->UnregisterComponent(this);
+	}
+
+	Super::OnUnregister();
+}
+
+void UNeoFurComponent::ApplyBudgetedLOD(int32 NewActiveShellCount, float NewShellFade, int32 NewRateDivisor, bool bNewSimulate, bool bNewInRange)
+{
+	ActiveShellCount = NewActiveShellCount;
+	BudgetedShellFade = NewShellFade;
+	SimulationRateDivisor = NewRateDivisor;
+	bHasBudgetedLOD = true;
+
+	// Coming back on screen. The fur has been standing still while the
+	// mesh under it moved on, so it needs a few steps to catch up.
+	if(bSimulationCulled && bNewSimulate) {
+		bSimulationNeedsWarmUp = true;
+	}
+	bSimulationCulled = !bNewSimulate;
+
+	// The proxy only exists while the fur is close enough to draw. Running
+	// out of budget just draws zero shells.
+	if(bBudgetedInRange != bNewInRange) {
+		bBudgetedInRange = bNewInRange;
+		MarkRenderStateDirty();
+	}
 }
 
 const FNeoFurPhysicsParameters UNeoFurComponent::GetFurPhysicsParameters() const
@@ -555,26 +664,16 @@ void UNeoFurComponent::AddRadialForce(FVector Origin, float Radius, float Streng
 {
 	Super::AddRadialForce(Origin, Radius, Strength, Falloff, bAccelChange);
 
-	// FIXME: Find a better way to accumulate forces.
-	if(AccumulatedForces.NumForcesThisFrame < NeoFurFramePhysicsInputsNumLocalForces) {
-		AccumulatedForces.LocalForces[AccumulatedForces.NumForcesThisFrame].Origin = GetComponentTransform().Inverse().TransformPosition(Origin);
-		AccumulatedForces.LocalForces[AccumulatedForces.NumForcesThisFrame].Radius = Radius;
-		AccumulatedForces.LocalForces[AccumulatedForces.NumForcesThisFrame].Strength = Strength;
-		AccumulatedForces.NumForcesThisFrame++;
-	}
+	ComponentForces.Add(FNeoFurForceField::Radial(
+		GetComponentTransform().Inverse().TransformPosition(Origin), Radius, Strength));
 }
 
 void UNeoFurComponent::AddRadialImpulse(FVector Origin, float Radius, float Strength, enum ERadialImpulseFalloff Falloff, bool bAccelChange)
 {
 	Super::AddRadialImpulse(Origin, Radius, Strength, Falloff, bAccelChange);
-	
-	// FIXME: Find a better way to accumulate forces.
-	if(AccumulatedForces.NumForcesThisFrame < NeoFurFramePhysicsInputsNumLocalForces) {
-		AccumulatedForces.LocalForces[AccumulatedForces.NumForcesThisFrame].Origin = GetComponentTransform().Inverse().TransformPosition(Origin);
-		AccumulatedForces.LocalForces[AccumulatedForces.NumForcesThisFrame].Radius = Radius;
-		AccumulatedForces.LocalForces[AccumulatedForces.NumForcesThisFrame].Strength = Strength;
-		AccumulatedForces.NumForcesThisFrame++;
-	}
+
+	ComponentForces.Add(FNeoFurForceField::Radial(
+		GetComponentTransform().Inverse().TransformPosition(Origin), Radius, Strength));
 }
 
 class UBodySetup* UNeoFurComponent::GetBodySetup()
@@ -586,7 +685,7 @@ class UBodySetup* UNeoFurComponent::GetBodySetup()
 		BodySetup->CollisionTraceFlag = CTF_UseSimpleAsComplex;
 		FKSphereElem* se = BodySetup->AggGeom.SphereElems.GetData();
 		se->Center = FVector::ZeroVector;
-		se->Radius = FurPhysicsParameters.MaxStretchDistanceMultiplier * ShellDistance + 100.0;
+		se->Radius = GetMaxStretchDistance() + 100.0;
 	}
 
 	return BodySetup;
@@ -594,14 +693,45 @@ class UBodySetup* UNeoFurComponent::GetBodySetup()
 
 int32 UNeoFurComponent::GetTotalActiveShellCount(UObject *WorldContextObject)
 {
-	UWorld *World = WorldContextObject->GetWorld();
-	int32 Total = 0;
-	for(TObjectIterator<UNeoFurComponent> i; i; ++i) {
-		if(i->GetWorld() == World) {
-			Total += i->ActiveShellCount;
-		}
+	FNeoFurBudgetManager *Manager = FNeoFurBudgetManager::Find(WorldContextObject->GetWorld());
+	return Manager ? Manager->GetTotalActiveShellCount() : 0;
+}
+
+double UNeoFurComponent::GetTotalSimulationSeconds()
+{
+	return double(GNeoFurSimulationCycles.GetValue()) * FPlatformTime::GetSecondsPerCycle();
+}
+
+void UNeoFurComponent::SetFurBudget(UObject *WorldContextObject, int32 MaxShells, int32 MaxSimulatedControlPoints)
+{
+	FNeoFurBudgetManager *Manager = FNeoFurBudgetManager::Get(WorldContextObject->GetWorld());
+	if(Manager) {
+		Manager->SetBudget(MaxShells, MaxSimulatedControlPoints);
+	}
+}
+
+void UNeoFurComponent::AddFurRadialForce(UObject *WorldContextObject, FVector Origin, float Radius, float Strength)
+{
+	FNeoFurForceFieldRegistry *Registry = FNeoFurForceFieldRegistry::Get(WorldContextObject->GetWorld());
+	if(Registry) {
+		Registry->AddForce(FNeoFurForceField::Radial(Origin, Radius, Strength));
+	}
+}
+
+void UNeoFurComponent::AddFurDirectionalForce(UObject *WorldContextObject, FVector Origin, float Radius, FVector Direction, float Strength)
+{
+	FNeoFurForceFieldRegistry *Registry = FNeoFurForceFieldRegistry::Get(WorldContextObject->GetWorld());
+	if(Registry) {
+		Registry->AddForce(FNeoFurForceField::Directional(Origin, Radius, Direction, Strength));
+	}
+}
+
+void UNeoFurComponent::AddFurVortexForce(UObject *WorldContextObject, FVector Origin, float Radius, FVector Axis, float Strength)
+{
+	FNeoFurForceFieldRegistry *Registry = FNeoFurForceFieldRegistry::Get(WorldContextObject->GetWorld());
+	if(Registry) {
+		Registry->AddForce(FNeoFurForceField::Vortex(Origin, Radius, Axis, Strength));
 	}
-	return Total;
 }
 
 void UNeoFurComponent::SetShellDistance(float NewDistance)
@@ -18,6 +18,7 @@
 #include "EngineModule.h"
 #include "RHICommandList.h"
 #include "ShaderParameterUtils.h"
+#include "Misc/AutomationTest.h"
 
 #include "NeoFurComponent.h"
 #include "NeoFurComponentSceneProxy.h"
@@ -25,6 +26,7 @@
 #include "NeoFurShaderInstallCheck.h"
 #include "NeoFurVertexFactory.h"
 #include "NeoFurProxyPrivateData.h"
+#include "NeoFurForceFieldRegistry.h"
 
 #include "NeoFurProfiling.h"
 
@@ -52,10 +54,7 @@ FNeoFurComponentSceneProxy::FNeoFurComponentSceneProxy(
 {
 	ReadyToRender = false;
 	
-	for(int32 i = 0; i < NeoFurFrameTimeSmoothingFrames; i++) {
-		PreviousFrameTimes[i] = -1.0f;
-	}
-	FrameTimeIndex = 0;
+	SimulationParamsRingIndex = 0;
 
 	bAlwaysHasVelocity = true;
 
@@ -70,31 +69,30 @@ FNeoFurComponentSceneProxy::FNeoFurComponentSceneProxy(
     PrivateData->bSkipSimulation     = bSkipSim;
     PrivateData->ShellCount          = InShellCount;
     PrivateData->ActiveShellCount    = InShellCount;
-	PrivateData->LastSimulatedActiveShellCount[0] = InShellCount;
-	PrivateData->LastSimulatedActiveShellCount[1] = InShellCount;
     PrivateData->ShellDistance       = InShellDistance;
+
+	PrivateData->ShellBatchData.SetNum(InShellCount);
+	for(int32 i = 0; i < InShellCount; i++) {
+		PrivateData->ShellBatchData[i].PrivateData = PrivateData;
+		PrivateData->ShellBatchData[i].ShellOffset = i;
+	}
     
 	PrivateData->MaterialRenderProxy = InMaterialRenderProxy;
 
 	// We need to copy over skinned mesh data immediately (from the data passed
 	// into THIS function, which might not be available later), so we're not
 	// going to wait for the CreateRenderThreadResources() call.
-	BeginInitResource(&PrivateData->SkeletalMeshVertexBufferCopy_GPU);
-	BeginInitResource(&PrivateData->SkeletalMeshIndexBufferCopy);
-	
 	BeginInitResource(&PrivateData->ControlPointVertexBuffers_GPU[0]);
 	BeginInitResource(&PrivateData->ControlPointVertexBuffers_GPU[1]);
 
-	BeginInitResource(&PrivateData->PostAnimationVertexBuffer);
-	BeginInitResource(&PrivateData->PostAnimationIndexBuffer);
-
 	BeginInitResource(&PrivateData->BoneMatsVertexBuffer);
 	BeginInitResource(&PrivateData->MorphDataVertexBuffer);
 
-	BeginInitResource(&PrivateData->StaticVertexData_GPU);
-
 	PrivateData->ControlPointVertexBufferFrame = 0;
-	PrivateData->LastDeltaTime = 0.0167f;
+	PrivateData->SimulationAlpha = 1.0f;
+	PrivateData->PreviousSimulationAlpha = 1.0f;
+	PrivateData->NumBoneMats = 1;
+	PrivateData->bBuffersReady = false;
 
     PrivateData->ControlPointsUAV[0]         = nullptr;
     PrivateData->ControlPointsUAV[1]         = nullptr;
@@ -104,7 +102,6 @@ FNeoFurComponentSceneProxy::FNeoFurComponentSceneProxy(
     PrivateData->PhysicsPropertiesSRV        = nullptr;
     PrivateData->MorphDataSRV                = nullptr;
     PrivateData->PhysicsPropertiesVertBuffer = nullptr;
-    PrivateData->PostAnimVertexBufferUAV     = nullptr;
     PrivateData->BoneMatsSRV                 = nullptr;
     PrivateData->PerFrameDataVertBuffer      = nullptr;
     PrivateData->PerFrameDataVertBufferSRV   = nullptr;
@@ -120,56 +117,64 @@ FNeoFurComponentSceneProxy::FNeoFurComponentSceneProxy(
 FNeoFurComponentSceneProxy::~FNeoFurComponentSceneProxy()
 {
 	check(IsInRenderingThread());
-	
-	PrivateData->SkeletalMeshVertexBufferCopy_GPU.ReleaseResource();
-	PrivateData->SkeletalMeshIndexBufferCopy.ReleaseResource();
 
+	// CPU simulation jobs and the initial control point build might still
+	// be writing into PrivateData.
+	FinishSimulation_Renderthread_CPU();
+	if(PrivateData->BuildTask.GetReference() && !PrivateData->BuildTask->IsComplete()) {
+		FTaskGraphInterface::Get().WaitUntilTaskCompletes(PrivateData->BuildTask, ENamedThreads::RenderThread_Local);
+	}
+	
 	PrivateData->ControlPointVertexBuffers_GPU[0].ReleaseResource();
 	PrivateData->ControlPointVertexBuffers_GPU[1].ReleaseResource();
 
 	PrivateData->VertexFactories[0].ReleaseResource();
 	PrivateData->VertexFactories[1].ReleaseResource();
-	PrivateData->PostAnimationIndexBuffer.ReleaseResource();
-	PrivateData->PostAnimationVertexBuffer.ReleaseResource();
 	
 	PrivateData->BoneMatsVertexBuffer.ReleaseResource();
 	PrivateData->MorphDataVertexBuffer.ReleaseResource();
 
-	PrivateData->StaticVertexData_GPU.ReleaseResource();
-	
+	// This drops our reference to the shared asset resources too, which
+	// releases them if we were the last one using them.
     delete PrivateData;
 }
 
-struct FNeoFurComponentSceneProxyGenerateCommand
-{
-	TArray<FNeoFurComponentSceneProxy::VertexType> AssetVertices;
-	TArray<uint32> AssetIndices;
-};
-
 void FNeoFurComponentSceneProxy::GenerateBuffers(UNeoFurAsset *FurAsset)
 {
 	check(IsInGameThread());
 
-	// We're copying all the bits of data we need here from the other
-	// component, because we aren't allowed to access and of it from
-	// the render thread except for the things handled through the RHI
-	// refs.
-	FNeoFurComponentSceneProxyGenerateCommand *NewCommand = new FNeoFurComponentSceneProxyGenerateCommand;
-	NewCommand->AssetVertices = FurAsset->Vertices;
-	NewCommand->AssetIndices  = FurAsset->Indices;
+	// Everything that only depends on the asset is shared between all the
+	// proxies using it, and only gets built the first time around.
+	PrivateData->AssetResources = FurAsset->GetRenderResources();
+	PrivateData->NumBoneMats = FMath::Min(FMath::Max(FurAsset->BonePalette.Num(), 1), NEOFUR_MAX_BONE_COUNT);
 
-	check(FurAsset->Vertices.Num());
-	check(FurAsset->Indices.Num());
+	// The initial control points come from the shared static vertex data,
+	// so they have to wait for that to be built. The shell distance can
+	// change on the render thread while the task is running, so it gets
+	// passed in by value.
+	FNeoFurProxyPrivateData *Data = PrivateData;
+	float ShellDistance = PrivateData->ShellDistance;
 
-	ENQUEUE_UNIQUE_RENDER_COMMAND_TWOPARAMETER(
-		FurComponentSetupSkin,
-		FNeoFurComponentSceneProxyGenerateCommand *, Command, NewCommand,
-		FNeoFurComponentSceneProxy *,                Proxy,   this,
+	FGraphEventArray Prerequisites;
+	Prerequisites.Add(PrivateData->AssetResources->BuildTask);
+
+	PrivateData->BuildTask = FFunctionGraphTask::CreateAndDispatchWhenReady(
+		[Data, ShellDistance]()
 		{
-			Proxy->GenerateBuffers_Renderthread_CPU(RHICmdList, Command);
-			delete Command;
-		}
-	);
+			const TArray<VertexType_Static> &StaticVerts = Data->AssetResources->StaticVertexData_CPU;
+			int32 NumSourceVerts = StaticVerts.Num();
+
+			for (int32 j = 0; j < 2; j++) {
+				Data->ControlPointVertexBuffers_CPU[j].SetNumZeroed(NumSourceVerts);
+				for (int32 i = 0; i < NumSourceVerts; i++) {
+					ControlPointVertexType *ControlPoint = &(Data->ControlPointVertexBuffers_CPU[j][i]);
+					ControlPoint->Position     = StaticVerts[i].Position + StaticVerts[i].TanZ * ShellDistance;
+					ControlPoint->RootPosition = StaticVerts[i].Position;
+					ControlPoint->Velocity     = FVector(0.0f, 0.0f, 0.0f);
+				}
+			}
+		},
+		TStatId(), &Prerequisites, ENamedThreads::AnyThread);
 }
 
 template<typename T>
@@ -241,253 +246,290 @@ FVertexBufferRHIRef NeoFurVertexBufferFromArray(
 	return ret;
 }
 
-void FNeoFurComponentSceneProxy::GenerateBuffers_Renderthread_CPU(
-	FRHICommandListImmediate &RHICmdList,
-	FNeoFurComponentSceneProxyGenerateCommand *Command)
+template<typename T>
+FIndexBufferRHIRef NeoFurIndexBufferFromArray(const TArray<T> &SourceIndices)
 {
-	double startTime = FPlatformTime::Seconds();
-	UE_LOG(NeoFur, Log, TEXT("Generating buffers start"));
-	
-	{
-		NEOFUR_PROFILE_SCOPE("GenerateBuffers_Renderthread_CPU");
+	NEOFUR_PROFILE_SCOPE("NeoFurIndexBufferFromArray");
 
-		check(IsInRenderingThread());
-		int32 NumSourceVerts = Command->AssetVertices.Num();
-		FRHIResourceCreateInfo CreateInfo;
-		
-		// Memory usage for static mesh copy.
-		PrivateData->MemoryUsage += NumSourceVerts * sizeof(VertexType);
+	FIndexBufferRHIRef ret;
+	FRHIResourceCreateInfo CreateInfo;
+
+	ret = RHICreateIndexBuffer(
+		sizeof(T), SourceIndices.Num() * sizeof(T),
+		BUF_Static, CreateInfo);
 
-		// Memory usage for control points.
-		PrivateData->MemoryUsage += NumSourceVerts * sizeof(ControlPointVertexType);
+	void *RawIndices = RHILockIndexBuffer(ret, 0, ret->GetSize(), RLM_WriteOnly);
+	memcpy(RawIndices, SourceIndices.GetData(), SourceIndices.Num() * sizeof(T));
+	RHIUnlockIndexBuffer(ret);
+
+	return ret;
+}
 
-		// Memory usage for renderable shell mesh.
-		PrivateData->MemoryUsage += NumSourceVerts * sizeof(VertexType) * PrivateData->ShellCount;
+// ---------------------------------------------------------------------------
+// Shared asset resources
+// ---------------------------------------------------------------------------
 
-		// Copy vertices over.
+FNeoFurAssetRenderResources *FNeoFurAssetRenderResources::Create(const UNeoFurAsset *FurAsset)
+{
+	check(IsInGameThread());
+	check(FurAsset->Vertices.Num());
+	check(FurAsset->Indices.Num());
+
+	FNeoFurAssetRenderResources *Resources = new FNeoFurAssetRenderResources;
+	Resources->AddRef();
+
+	// We're copying all the bits of data we need here from the asset,
+	// because we aren't allowed to access any of it from other threads.
+	Resources->PendingVertices = FurAsset->Vertices;
+	Resources->PendingIndices  = FurAsset->Indices;
+
+	Resources->BuildTask = FFunctionGraphTask::CreateAndDispatchWhenReady(
+		[Resources]()
 		{
-			NEOFUR_PROFILE_SCOPE("Copy vertices");
+			Resources->Build_Worker();
+		},
+		TStatId(), nullptr, ENamedThreads::AnyThread);
 
-			PrivateData->SkeletalMeshVertexBufferCopy_CPU.SetNumZeroed(NumSourceVerts);
-			PrivateData->ControlPointVertexBuffers_CPU[0].SetNumZeroed(NumSourceVerts);
-			PrivateData->ControlPointVertexBuffers_CPU[1].SetNumZeroed(NumSourceVerts);
-			PrivateData->StaticVertexData_CPU.SetNumZeroed(NumSourceVerts);
+	return Resources;
+}
 
-			{
-				NEOFUR_PROFILE_SCOPE("Iterate through source verts");
-				
-				for (int32 i = 0; i < NumSourceVerts; i++) {
+void FNeoFurAssetRenderResources::BeginRelease()
+{
+	check(IsInGameThread());
 
-					// Mesh
-					VertexType *CopiedVert = &PrivateData->SkeletalMeshVertexBufferCopy_CPU[i];
-					*CopiedVert = Command->AssetVertices[i];
-
-					// Static verts
-					VertexType_Static *StaticVert = &PrivateData->StaticVertexData_CPU[i];
-					StaticVert->Position = Command->AssetVertices[i].Position;
-					StaticVert->TanZ = Command->AssetVertices[i].TanZ;
-					StaticVert->TanX = Command->AssetVertices[i].TanX;
-					StaticVert->CombedDirectionAndLength = Command->AssetVertices[i].CombedDirectionAndLength;
-					for(int32 k = 0; k < 4; k++) {
-						StaticVert->InfluenceBones[k] = Command->AssetVertices[i].InfluenceBones[k];
-						StaticVert->InfluenceWeights[k] = Command->AssetVertices[i].InfluenceWeights[k];
-					}
-					for(int32 k = 0; k < MAX_TEXCOORDS; k++) {
-						StaticVert->UVs[k] = Command->AssetVertices[i].UVs[k];
-					}
-					
-					// Control points
-					for (int32 j = 0; j < 2; j++) {
-						ControlPointVertexType *ControlPoint = nullptr;
-						ControlPoint = &(PrivateData->ControlPointVertexBuffers_CPU[j][i]);
-						ControlPoint->Position     = CopiedVert->Position + FVector(CopiedVert->TanZ) * PrivateData->ShellDistance;
-						ControlPoint->RootPosition = CopiedVert->Position;
-						ControlPoint->Velocity     = FVector(0.0f, 0.0f, 0.0f);
-					}
+	ENQUEUE_UNIQUE_RENDER_COMMAND_ONEPARAMETER(
+		NeoFurReleaseAssetRenderResources,
+		FNeoFurAssetRenderResources *, Resources, this,
+		{
+			Resources->Release();
+		}
+	);
+}
 
-				}
-			}
+uint32 FNeoFurAssetRenderResources::AddRef() const
+{
+	return uint32(NumRefs.Increment());
+}
 
-			// Copy the static data buffer to the GPU, because we'll need
-			// it in the place that the simulation happens in, and also
-			// for the vertex factory to read from. We need to expand this
-			// out to the entire mesh, including shells, so it's not
-			// actually a mirror of the CPU-side vertex buffer!
-			{
-				NEOFUR_PROFILE_SCOPE("Static buffer to GPU");
-				
-				void *RawVerts = nullptr;
-
-				// Generate vertex buffer.
-				PrivateData->StaticVertexData_GPU.VertexBufferRHI =
-					NeoFurVertexBufferFromArray(
-						PrivateData->StaticVertexData_CPU,
-						0,
-						PrivateData->ShellCount,
-						true,
-						&RawVerts);
-						
-
-				// Touch up Vertex IDs now that everthing is in place.
-				FNeoFurComponentSceneProxy::VertexType_Static *BufferVerts =
-					(FNeoFurComponentSceneProxy::VertexType_Static *)RawVerts;
-				check(BufferVerts);
-				int32 TotalVertCount = PrivateData->StaticVertexData_CPU.Num() * PrivateData->ShellCount;
-				for(int32 i = 0; i < TotalVertCount; i++) {
-					BufferVerts[i].VertexID = float(i);
-				}
+uint32 FNeoFurAssetRenderResources::Release() const
+{
+	uint32 Refs = uint32(NumRefs.Decrement());
+	if(Refs == 0) {
+		check(IsInRenderingThread());
+		delete this;
+	}
+	return Refs;
+}
 
-				RHIUnlockVertexBuffer(PrivateData->StaticVertexData_GPU.VertexBufferRHI);
-			}
+uint32 FNeoFurAssetRenderResources::GetRefCount() const
+{
+	return uint32(NumRefs.GetValue());
+}
 
-			{
-				NEOFUR_PROFILE_SCOPE("Create control point buffers");
-				
-				// Control points.
-				for (int32 i = 0; i < 2; i++) {
-					PrivateData->ControlPointVertexBuffers_GPU[i].VertexBufferRHI = NeoFurVertexBufferFromArray(
-						PrivateData->ControlPointVertexBuffers_CPU[i],
-						BUF_UnorderedAccess,
-						PrivateData->ShellCount);
-				}
-			}
+FNeoFurAssetRenderResources::FNeoFurAssetRenderResources()
+	: MemoryUsage(sizeof(*this))
+	, bRHIReady(false)
+{
+}
 
-			// Move everything over to Vertex buffers if we're using the
-			// GPU simulation. Clear out CPU-side buffers we don't need.
-			if(ShouldUseGPUShader()) {
-			    
-				NEOFUR_PROFILE_SCOPE("Copy skeletal mesh VBO copy to GPU and clear CPU buffers");
-
-				// Source skeletal mesh.
-				PrivateData->SkeletalMeshVertexBufferCopy_GPU.VertexBufferRHI = NeoFurVertexBufferFromArray(
-					PrivateData->SkeletalMeshVertexBufferCopy_CPU);
-					
-				// We don't need the static vertex data on the CPU side.
-				PrivateData->StaticVertexData_CPU.SetNum(0, true);
-
-				// We don't need the CPU-side control point array for the
-				// GPU shader.
-				PrivateData->ControlPointVertexBuffers_CPU[0].SetNum(0, true);
-				PrivateData->ControlPointVertexBuffers_CPU[1].SetNum(0, true);
-			}
-			
-			{
-				NEOFUR_PROFILE_SCOPE("Generate initial shells");
-
-				// Generate shells in our post animation vertex buffer.
-				// Animated, renderable thing. (Changes every frame.)
-				PrivateData->PostAnimationVertexBuffer.VertexBufferRHI = RHICreateVertexBuffer(
-					NumSourceVerts * sizeof(VertexType) * PrivateData->ShellCount,
-					BUF_Static | BUF_UnorderedAccess | BUF_ShaderResource, CreateInfo); // FIXME: Use BUF_Dynamic on ES2?
-				void *RawPostAnimVerts = RHILockVertexBuffer(
-					PrivateData->PostAnimationVertexBuffer.VertexBufferRHI, 0,
-					PrivateData->PostAnimationVertexBuffer.VertexBufferRHI->GetSize(), RLM_WriteOnly);
-				{
-					for (int32 i = 0; i < NumSourceVerts; i++) {
-
-						for (int32 j = 0; j < PrivateData->ShellCount; j++) {
-
-							// FIXME: Fix these variable names.
-							VertexType *SourceVertex = &(Command->AssetVertices[i]);
-							VertexType *ShellVert = (VertexType*)RawPostAnimVerts + i + (j * NumSourceVerts);
-
-							// FIXME: Squish this down to a direct copy, then
-							// alter the position. Then make sure it's still
-							// performant.
-
-							ShellVert->Position = SourceVertex->Position;
-							ShellVert->Position += FVector(SourceVertex->TanZ) * (float(j) / float(PrivateData->ShellCount)) * PrivateData->ShellDistance;
-							
-							ShellVert->TanX     = SourceVertex->TanX;
-							ShellVert->TanZ     = SourceVertex->TanZ;
-							for (int32 k = 0; k < MAX_TEXCOORDS - 1; k++) {
-								ShellVert->UVs[k] = SourceVertex->UVs[k];
-							}
-
-							// FIXME: Do we even care about bones for the rendered verts?
-							// FIXME: Support 4 or 8 bones!
-							for (int32 k = 0; k < 4; k++) {
-								ShellVert->InfluenceBones[k]   = SourceVertex->InfluenceBones[k];
-								ShellVert->InfluenceWeights[k] = SourceVertex->InfluenceWeights[k];
-							}
-							
-						}
-					}
-				}
-				RHIUnlockVertexBuffer(PrivateData->PostAnimationVertexBuffer.VertexBufferRHI);
-			}
+FNeoFurAssetRenderResources::~FNeoFurAssetRenderResources()
+{
+	check(IsInRenderingThread());
+
+	// The build task writes straight into us.
+	if(BuildTask.GetReference() && !BuildTask->IsComplete()) {
+		FTaskGraphInterface::Get().WaitUntilTaskCompletes(BuildTask, ENamedThreads::RenderThread_Local);
+	}
+
+	StaticVertexData_GPU.ReleaseResource();
+	SkeletalMeshVertexBufferCopy_GPU.ReleaseResource();
+	SkeletalMeshIndexBufferCopy.ReleaseResource();
+	PostAnimationIndexBuffer.ReleaseResource();
+}
+
+void FNeoFurAssetRenderResources::Build_Worker()
+{
+	int32 NumSourceVerts = PendingVertices.Num();
+
+	// Copy vertices over.
+	StaticVertexData_CPU.SetNumZeroed(NumSourceVerts);
+
+	for (int32 i = 0; i < NumSourceVerts; i++) {
+		FNeoFurComponentSceneProxy::VertexType_Static *StaticVert = &StaticVertexData_CPU[i];
+		StaticVert->Position = PendingVertices[i].Position;
+		StaticVert->TanZ = PendingVertices[i].TanZ;
+		StaticVert->TanX = PendingVertices[i].TanX;
+		StaticVert->CombedDirectionAndLength = PendingVertices[i].CombedDirectionAndLength;
+		for(int32 k = 0; k < 4; k++) {
+			StaticVert->InfluenceBones[k] = PendingVertices[i].InfluenceBones[k];
+			StaticVert->InfluenceWeights[k] = PendingVertices[i].InfluenceWeights[k];
+		}
+		for(int32 k = 0; k < MAX_TEXCOORDS; k++) {
+			StaticVert->UVs[k] = PendingVertices[i].UVs[k];
 		}
+	}
 
-		{
-			NEOFUR_PROFILE_SCOPE("Make bone mats VBO and morph data VBO");
-			// ---
+	// The rendering copy of the indices is just one shell's worth, since
+	// every shell is drawn from the same indices, so it can use 16-bit
+	// indices whenever the growth mesh is small enough.
+	if(NumSourceVerts <= MAX_uint16 + 1) {
+		PendingShellIndices16.SetNumUninitialized(PendingIndices.Num());
+		for (int32 i = 0; i < PendingIndices.Num(); i++) {
+			PendingShellIndices16[i] = (uint16)PendingIndices[i];
+		}
+	}
+
+	// The original vertices are only needed again for the compute
+	// shader's copy of the skeletal mesh.
+	bool bKeepVertices = false;
+  #if !NEOFUR_NO_COMPUTE_SHADERS
+	bKeepVertices = GMaxRHIFeatureLevel >= ERHIFeatureLevel::SM5;
+  #endif
+	if(!bKeepVertices) {
+		PendingVertices.Empty();
+	}
+}
 
-			// FIXME: Get actual number of bones instead of just the max (256).
-			PrivateData->BoneMatsVertexBuffer.VertexBufferRHI = RHICreateVertexBuffer(
-				sizeof(FMatrix) * NEOFUR_MAX_BONE_COUNT, BUF_Dynamic | BUF_ShaderResource, CreateInfo);
-			PrivateData->MemoryUsage += sizeof(FMatrix) * NEOFUR_MAX_BONE_COUNT;
+bool FNeoFurAssetRenderResources::IsReady_Renderthread()
+{
+	check(IsInRenderingThread());
 
-			// ---
+	if(bRHIReady) return true;
+	if(!BuildTask->IsComplete()) return false;
 
-			PrivateData->MorphDataVertexBuffer.VertexBufferRHI = RHICreateVertexBuffer(
-				NumSourceVerts * sizeof(MorphDataVertexType),
-				BUF_Dynamic | BUF_ShaderResource, CreateInfo);
-			PrivateData->MemoryUsage += sizeof(MorphDataVertexType) * NumSourceVerts;
+	InitRHI_Renderthread();
+	bRHIReady = true;
+	return true;
+}
+
+void FNeoFurAssetRenderResources::InitRHI_Renderthread()
+{
+	double startTime = FPlatformTime::Seconds();
+
+	{
+		NEOFUR_PROFILE_SCOPE("FNeoFurAssetRenderResources::InitRHI_Renderthread");
+
+		int32 NumSourceVerts = StaticVertexData_CPU.Num();
+		int32 NumSourceIndices = PendingIndices.Num();
+
+		StaticVertexData_GPU.InitResource();
+		SkeletalMeshVertexBufferCopy_GPU.InitResource();
+		SkeletalMeshIndexBufferCopy.InitResource();
+		PostAnimationIndexBuffer.InitResource();
+
+		// The CPU simulation reads this, so it stays around. It's only one
+		// copy per asset.
+		MemoryUsage += NumSourceVerts * sizeof(FNeoFurComponentSceneProxy::VertexType_Static);
+
+		// Copy the static data buffer to the GPU for the vertex factory
+		// to read from. Every shell is drawn from the same vertices, so
+		// this is just a mirror of the CPU-side buffer.
+		StaticVertexData_GPU.VertexBufferRHI = NeoFurVertexBufferFromArray(StaticVertexData_CPU);
+		MemoryUsage += NumSourceVerts * sizeof(FNeoFurComponentSceneProxy::VertexType_Static);
+
+		// Source skeletal mesh for the compute shader. Whether a given
+		// proxy actually uses the GPU simulation is up to the proxy, so
+		// this gets made whenever it's possible.
+		if(PendingVertices.Num()) {
+			SkeletalMeshVertexBufferCopy_GPU.VertexBufferRHI = NeoFurVertexBufferFromArray(PendingVertices);
+			MemoryUsage += NumSourceVerts * sizeof(FNeoFurComponentSceneProxy::VertexType);
 		}
 
-		// ---
-		
-		{
-			NEOFUR_PROFILE_SCOPE("Copy indices");
+		// Skinned mesh copy of the indices.
+		SkeletalMeshIndexBufferCopy.IndexBufferRHI = NeoFurIndexBufferFromArray(PendingIndices);
+		MemoryUsage += sizeof(uint32) * NumSourceIndices;
 
-			// Copy indices over.
-			int32 NumSourceIndices = Command->AssetIndices.Num();
+		// Rendering copy of the indices.
+		if(PendingShellIndices16.Num()) {
+			PostAnimationIndexBuffer.IndexBufferRHI = NeoFurIndexBufferFromArray(PendingShellIndices16);
+			MemoryUsage += sizeof(uint16) * NumSourceIndices;
+		} else {
+			PostAnimationIndexBuffer.IndexBufferRHI = NeoFurIndexBufferFromArray(PendingIndices);
+			MemoryUsage += sizeof(uint32) * NumSourceIndices;
+		}
 
-			// Make our two buffers for the skinned mesh copy and rendering copy with shells.
-			PrivateData->SkeletalMeshIndexBufferCopy.IndexBufferRHI = RHICreateIndexBuffer(
-				sizeof(uint32), sizeof(uint32) * NumSourceIndices, BUF_Static, CreateInfo);
-			PrivateData->MemoryUsage += sizeof(uint32) * NumSourceIndices;
-			
-			PrivateData->PostAnimationIndexBuffer.IndexBufferRHI = RHICreateIndexBuffer(
-				sizeof(uint32), sizeof(uint32) * NumSourceIndices * PrivateData->ShellCount, BUF_Static, CreateInfo);
-			PrivateData->MemoryUsage += sizeof(uint32) * NumSourceIndices * PrivateData->ShellCount;
-
-			// Lock skeletal mesh copy index buffer (for skinned anim copying).
-			void *RawIndicies = RHILockIndexBuffer(
-				PrivateData->SkeletalMeshIndexBufferCopy.IndexBufferRHI,
-				0, NumSourceIndices * sizeof(uint32),
-				RLM_WriteOnly);
+		// Everything's on the GPU now.
+		PendingVertices.Empty();
+		PendingIndices.Empty();
+		PendingShellIndices16.Empty();
+	}
 
-			// Lock post-animation index buffer (for rendering).
-			void *RawPostAnimIndicies = RHILockIndexBuffer(
-				PrivateData->PostAnimationIndexBuffer.IndexBufferRHI,
-				0, NumSourceIndices * sizeof(uint32) * PrivateData->ShellCount,
-				RLM_WriteOnly);
-				
-			for (int32 i = 0; i < NumSourceIndices; i++) {
+	double endTime = FPlatformTime::Seconds();
+	UE_LOG(NeoFur, Log, TEXT("Creating shared asset buffers complete: %f ms"), float(endTime - startTime) * 1000.0f);
+}
 
-				uint32 OriginalIndex = 0;
-				
-				OriginalIndex = Command->AssetIndices[i];
+// ---------------------------------------------------------------------------
+// Per-proxy resources
+// ---------------------------------------------------------------------------
 
-				// Write our skeletal mesh copy vert.
-				uint32 *WriteIndexOriginal = &(((uint32*)RawIndicies)[i]);
-				*WriteIndexOriginal = OriginalIndex;
+// Control points. The simulation switches between two buffers every
+// step, and each holds only one copy, since every shell reads from the
+// same control points. Returns the memory used by both.
+static uint32 NeoFurCreateControlPointBuffers(
+	const TArray<FNeoFurComponentSceneProxy::ControlPointVertexType> ControlPoints_CPU[2],
+	FVertexBuffer ControlPoints_GPU[2])
+{
+	check(IsInRenderingThread());
 
-				// Write our shell verts.
-				for (int32 k = 0; k < PrivateData->ShellCount; k++) {
-					uint32 *WriteIndexShells = &(((uint32*)RawPostAnimIndicies)[i + k * NumSourceIndices]);
-					*WriteIndexShells = OriginalIndex + (k * NumSourceVerts);
-				}
-			}
+	uint32 MemoryUsage = 0;
+	for(int32 i = 0; i < 2; i++) {
+		ControlPoints_GPU[i].VertexBufferRHI = NeoFurVertexBufferFromArray(
+			ControlPoints_CPU[i],
+			BUF_UnorderedAccess);
+		MemoryUsage += ControlPoints_CPU[i].Num() * sizeof(FNeoFurComponentSceneProxy::ControlPointVertexType);
+	}
+	return MemoryUsage;
+}
+
+bool FNeoFurComponentSceneProxy::FinishGenerateBuffers_Renderthread()
+{
+	check(IsInRenderingThread());
+
+	if(PrivateData->bBuffersReady) return true;
 
-			RHIUnlockIndexBuffer(PrivateData->SkeletalMeshIndexBufferCopy.IndexBufferRHI);
-			RHIUnlockIndexBuffer(PrivateData->PostAnimationIndexBuffer.IndexBufferRHI);
+	// Both the shared data and our own control points get built off the
+	// render thread. Until they're done, there's nothing to simulate or
+	// draw.
+	if(!PrivateData->AssetResources->IsReady_Renderthread()) return false;
+	if(!PrivateData->BuildTask->IsComplete()) return false;
+	PrivateData->BuildTask = nullptr;
+
+	double startTime = FPlatformTime::Seconds();
+
+	{
+		NEOFUR_PROFILE_SCOPE("FinishGenerateBuffers_Renderthread");
+
+		int32 NumSourceVerts = PrivateData->ControlPointVertexBuffers_CPU[0].Num();
+		FRHIResourceCreateInfo CreateInfo;
+
+		PrivateData->MemoryUsage += NeoFurCreateControlPointBuffers(
+			PrivateData->ControlPointVertexBuffers_CPU,
+			PrivateData->ControlPointVertexBuffers_GPU);
+
+		// We don't need the CPU-side control point array for the GPU
+		// shader.
+		if(ShouldUseGPUShader()) {
+			PrivateData->ControlPointVertexBuffers_CPU[0].SetNum(0, true);
+			PrivateData->ControlPointVertexBuffers_CPU[1].SetNum(0, true);
 		}
+
+		// Only the bones in the asset's palette get uploaded.
+		PrivateData->BoneMatsVertexBuffer.VertexBufferRHI = RHICreateVertexBuffer(
+			sizeof(BoneMatrixType) * PrivateData->NumBoneMats, BUF_Dynamic | BUF_ShaderResource, CreateInfo);
+		PrivateData->MemoryUsage += sizeof(BoneMatrixType) * PrivateData->NumBoneMats;
+
+		PrivateData->MorphDataVertexBuffer.VertexBufferRHI = RHICreateVertexBuffer(
+			NumSourceVerts * sizeof(MorphDataVertexType),
+			BUF_Dynamic | BUF_ShaderResource, CreateInfo);
+		PrivateData->MemoryUsage += sizeof(MorphDataVertexType) * NumSourceVerts;
 	}
-	
+
+	PrivateData->bBuffersReady = true;
+
 	double endTime = FPlatformTime::Seconds();
-	UE_LOG(NeoFur, Log, TEXT("Generating buffers complete: %f ms"), float(endTime - startTime) * 1000.0f);
+	UE_LOG(NeoFur, Log, TEXT("Creating buffers complete: %f ms"), float(endTime - startTime) * 1000.0f);
+
+	return true;
 }
 
 void FNeoFurComponentSceneProxy::CreateRenderThreadResources()
@@ -495,14 +537,14 @@ void FNeoFurComponentSceneProxy::CreateRenderThreadResources()
 	check(IsInRenderingThread());
 
     PrivateData->VertexFactories[0].SetFurVertexBuffer(
-		&PrivateData->StaticVertexData_GPU,
+		&PrivateData->AssetResources->StaticVertexData_GPU,
 		&PrivateData->ControlPointVertexBuffers_GPU[0],
 		&PrivateData->ControlPointVertexBuffers_GPU[1]);
 		
     PrivateData->VertexFactories[0].InitResource();
 
 	PrivateData->VertexFactories[1].SetFurVertexBuffer(
-		&PrivateData->StaticVertexData_GPU,
+		&PrivateData->AssetResources->StaticVertexData_GPU,
 		&PrivateData->ControlPointVertexBuffers_GPU[1],
 		&PrivateData->ControlPointVertexBuffers_GPU[0]);
 		
@@ -513,77 +555,152 @@ void FNeoFurComponentSceneProxy::CreateRenderThreadResources()
 // Simulation
 // ---------------------------------------------------------------------------
 
-struct FurComponentRunSimParams
+FThreadSafeCounter64 GNeoFurSimulationCycles;
+
+void FNeoFurComponentSceneProxy::SimulationParamsType::Reset()
 {
-	FNeoFurComponentSceneProxy * Proxy;
-	FTransform RelativeTransformSinceLastFrame;
-	float DeltaTime;
-	FVector LocalSpaceGravity;
-	FMatrix *BoneMats;
-	int32 NumBoneMats;
-	FNeoFurComponentSceneProxy::MorphDataVertexType *IncomingMorphData;
-};
-
-void FNeoFurComponentSceneProxy::RunSimulation(
-	const FTransform &RelativeTransformSinceLastFrame,
-	float DeltaTime,
-	const FVector &LocalSpaceGravity,
-	FMatrix *BoneMats, int32 NumBoneMats,
-	MorphDataVertexType *IncomingMorphData)
+	BoneMats.Reset();
+	MorphData.Reset();
+	Forces.Reset();
+	CollisionShapes.Reset();
+}
+
+void FNeoFurComponentSceneProxy::SimulationParamsType::SetBoneMats(
+	const TArray<uint16> &BonePalette,
+	const TArray<FMatrix> &RefBasesInvMatrix,
+	const TArray<FTransform> &SpaceBases)
+{
+	check(RefBasesInvMatrix.Num() == SpaceBases.Num());
+
+	int32 NumBones = SpaceBases.Num();
+	int32 NumBoneMats = BonePalette.Num();
+	BoneMats.SetNumUninitialized(NumBoneMats, false);
+	for(int32 i = 0; i < NumBoneMats; i++) {
+		int32 BoneIndex = BonePalette[i];
+		if(BoneIndex < NumBones) {
+			BoneMats[i].SetMatrix(RefBasesInvMatrix[BoneIndex] * SpaceBases[BoneIndex].ToMatrixWithScale());
+		} else {
+			BoneMats[i].SetMatrix(FMatrix::Identity);
+		}
+	}
+}
+
+void FNeoFurComponentSceneProxy::SimulationParamsType::SetMorphData(const TArray<MorphDataVertexType> &MorphDeltas)
+{
+	MorphData.SetNumUninitialized(MorphDeltas.Num(), false);
+	FMemory::Memcpy(MorphData.GetData(), MorphDeltas.GetData(), sizeof(MorphDataVertexType) * MorphDeltas.Num());
+}
+
+void FNeoFurComponentSceneProxy::SimulationParamsType::AddCollisionShape(
+	const FNeoFurCollisionShape &Shape,
+	const FTransform &ToComponent)
+{
+	FNeoFurCollisionShape NewShape;
+	NewShape.Start = ToComponent.TransformPosition(Shape.Start);
+	NewShape.End = ToComponent.TransformPosition(Shape.End);
+	NewShape.Radius = Shape.Radius * ToComponent.GetMaximumAxisScale();
+	CollisionShapes.Add(NewShape);
+}
+
+void FNeoFurComponentSceneProxy::SimulationParamsType::AddForces(
+	const TArray<FNeoFurForceField> &ComponentForces,
+	FNeoFurForceFieldRegistry *ForceFields,
+	const FBox &Bounds,
+	const FTransform &WorldToComponent)
+{
+	Forces.Append(ComponentForces);
+	if(ForceFields) {
+		ForceFields->GatherForces(Bounds, WorldToComponent, Forces);
+	}
+}
+
+int32 FNeoFurSimulationStepper::Advance(FNeoFurComponentSceneProxy::SimulationParamsType &Params, bool bMustStep)
+{
+	// The simulation only ever steps by a fixed amount of time, so it
+	// behaves the same at any framerate. Small fur steps less often, with
+	// longer steps. Time that doesn't add up to a whole step carries over
+	// to the next frame.
+	int32 RateDivisor = FMath::Max(Params.RateDivisor, 1);
+	float StepTime = float(RateDivisor) / float(NEOFUR_SIMULATION_STEP_RATE);
+
+	TimeAccumulator = FMath::Min(TimeAccumulator + Params.DeltaTime, StepTime * NEOFUR_SIMULATION_MAX_STEPS_PER_FRAME);
+	if(bMustStep) {
+		TimeAccumulator = FMath::Max(TimeAccumulator, StepTime);
+	}
+
+	int32 NumSteps = 0;
+	while(TimeAccumulator >= StepTime) {
+		TimeAccumulator -= StepTime;
+		NumSteps++;
+	}
+
+	// Warm-up steps fill in whatever room is left under the per-frame
+	// limit, so fur coming back on screen settles over a few frames
+	// instead of stalling this one.
+	PendingWarmUpSteps = FMath::Max(PendingWarmUpSteps, Params.WarmUpSteps);
+	int32 NumWarmUpSteps = FMath::Clamp(NEOFUR_SIMULATION_MAX_STEPS_PER_FRAME - NumSteps, 0, PendingWarmUpSteps);
+	PendingWarmUpSteps -= NumWarmUpSteps;
+	NumSteps += NumWarmUpSteps;
+
+	// Component movement piles up over frames that don't step, and all of
+	// it goes to the next step.
+	PendingRelativeTransform = PendingRelativeTransform * Params.RelativeTransformSinceLastFrame;
+
+	// Same for forces, so a one-off impulse on a frame that doesn't step
+	// still lands. Only the first step gets them, so it doesn't land
+	// more than once either.
+	if(!NumSteps) {
+		PendingForces.Append(Params.Forces);
+	} else {
+		if(PendingForces.Num()) {
+			Params.Forces.Append(PendingForces);
+			PendingForces.Reset();
+		}
+		Params.RelativeTransformSinceLastFrame = PendingRelativeTransform;
+		PendingRelativeTransform = FTransform::Identity;
+	}
+
+	Params.DeltaTime = StepTime;
+	return NumSteps;
+}
+
+FNeoFurComponentSceneProxy::SimulationParamsType *FNeoFurComponentSceneProxy::GetNextSimulationParams()
+{
+	check(IsInGameThread());
+
+	SimulationParamsType *Params = &SimulationParamsRing[SimulationParamsRingIndex];
+	if(Params->bInUse) {
+		return nullptr;
+	}
+	return Params;
+}
+
+void FNeoFurComponentSceneProxy::RunSimulation(SimulationParamsType *Params)
 {
 	check(IsInGameThread());
+	check(Params == &SimulationParamsRing[SimulationParamsRingIndex]);
+	check(!Params->bInUse);
 
-	if(NumBoneMats > NEOFUR_MAX_BONE_COUNT) {
+	if(Params->BoneMats.Num() > NEOFUR_MAX_BONE_COUNT) {
 		// FIXME: Maybe find a better way to deliver this error message. This
 		// will probably just result in horrifying levels of log spam.
 		UE_LOG(NeoFur, Error, TEXT(
 			"Cannot simulate fur with more than %d bones. Clamping bone count. This will probably look horribly wrong."), NEOFUR_MAX_BONE_COUNT);
-		NumBoneMats = NEOFUR_MAX_BONE_COUNT;
+		Params->BoneMats.SetNum(NEOFUR_MAX_BONE_COUNT, false);
 	}
 	
-	// Frame time spikes make the simulation "twitch" erratically, so
-	// we need to smooth out the incoming delta times by averaging it
-	// with the last several frames.
-	PreviousFrameTimes[FrameTimeIndex] = DeltaTime;
-	float DeltaTimeToUse = 0.0f;
-	int32 FramesCounted = 0;
-	for(int32 i = 0; i < NeoFurFrameTimeSmoothingFrames; i++) {
-		if(PreviousFrameTimes[i] != -1.0f) {
-			FramesCounted++;
-			DeltaTimeToUse += PreviousFrameTimes[i];
-		}
-	}
-	if(FramesCounted) {
-		DeltaTimeToUse /= float(FramesCounted);
-	} else {
-		DeltaTimeToUse = DeltaTime;
-	}
-	FrameTimeIndex++;
-	FrameTimeIndex %= NeoFurFrameTimeSmoothingFrames;
+	// Hand the block over to the render thread. It gets released from
+	// there when the simulation is done reading it.
+	Params->bInUse = true;
+	SimulationParamsRingIndex++;
+	SimulationParamsRingIndex %= NEOFUR_SIMULATION_PARAMS_RING_SIZE;
 
-
-	FurComponentRunSimParams *params = new FurComponentRunSimParams;
-	params->Proxy = this;
-	params->RelativeTransformSinceLastFrame = RelativeTransformSinceLastFrame;
-	params->DeltaTime = DeltaTimeToUse;
-	params->LocalSpaceGravity = LocalSpaceGravity;
-	params->BoneMats = BoneMats;
-	params->NumBoneMats = NumBoneMats;
-	params->IncomingMorphData = IncomingMorphData;
-
-	ENQUEUE_UNIQUE_RENDER_COMMAND_ONEPARAMETER(
+	ENQUEUE_UNIQUE_RENDER_COMMAND_TWOPARAMETER(
 		FurComponentRunSimulation,
-		FurComponentRunSimParams *, params, params,
+		FNeoFurComponentSceneProxy *, Proxy, this,
+		SimulationParamsType *, Params, Params,
 		{
-			params->Proxy->RunSimulation_Renderthread(
-				RHICmdList,
-				params->RelativeTransformSinceLastFrame,
-				params->DeltaTime,
-				params->LocalSpaceGravity,
-				params->BoneMats,
-				params->NumBoneMats,
-				params->IncomingMorphData);
-			delete params;
+			Proxy->RunSimulation_Renderthread(RHICmdList, Params);
 		}
 	);
 }
@@ -599,86 +716,76 @@ bool FNeoFurComponentSceneProxy::ShouldUseGPUShader() const
 
 void FNeoFurComponentSceneProxy::RunSimulation_Renderthread(
 	FRHICommandListImmediate &RHICmdList,
-	const FTransform &RelativeTransformSinceLastFrame,
-	float DeltaTime,
-	const FVector &LocalSpaceGravity,
-	FMatrix *BoneMats, int32 NumBoneMats,
-	MorphDataVertexType *IncomingMorphData)
+	SimulationParamsType *Params)
 {
-	// Bail out immediately if paused. Otherwise our sliding delta will make it
-	// lerp into paused even though the rest of the world stops.
-	if (DeltaTime == 0.0f) {
+	// Nothing to simulate until the buffers have been built. The proxy
+	// won't draw either, since it hasn't simulated yet.
+	if(!FinishGenerateBuffers_Renderthread()) {
+		Params->bInUse = false;
 		return;
 	}
 
-	// FIXME: This is an ugly hack to work around some issues with
-	// mismatched bone counts. We're just going to use the maximum
-	// bone count for now, which is inefficient.
-	FMatrix *BoneMatsTmp = new FMatrix[NEOFUR_MAX_BONE_COUNT];
-	for(int32 i = 0; i < NEOFUR_MAX_BONE_COUNT; i++) {
-		if(i < NumBoneMats && BoneMats) {
-			BoneMatsTmp[i] = BoneMats[i];
-		} else {
-			BoneMatsTmp[i].SetIdentity();
-		}
+	// Bail out immediately if paused.
+	if (Params->DeltaTime == 0.0f) {
+		Params->bInUse = false;
+		return;
 	}
 
-	// Slide the time delta slowly towards what the actual framerate is.
-	const float MaxTimeDeltaDelta = 0.005f;
-	float DeltaTimeDelta = PrivateData->LastDeltaTime - DeltaTime;
-	if(fabs(DeltaTimeDelta) > MaxTimeDeltaDelta) {
-		DeltaTime = DeltaTime + MaxTimeDeltaDelta * (DeltaTimeDelta < 0.0f ? -1.0f : 1.0f);
-	}
-	
-	// Clamp our update time. If we're under 30 fps, we're already in bad
-	// shape. At least we can keep the simulation stable.
-	const float DeltaTimeMax = (16.667f * 2.0f) / 1000.0f;
-	if (DeltaTime > DeltaTimeMax) {
-		DeltaTime = DeltaTimeMax;
-	}
-	PrivateData->LastDeltaTime = DeltaTime;
+	// Always step the first time around, so there's something skinned
+	// to draw. After this, Params->DeltaTime is the step time.
+	int32 NumSteps = PrivateData->Stepper.Advance(*Params, !ReadyToRender);
+	bool bUseGPU = ShouldUseGPUShader();
 
-#if !NEOFUR_NO_COMPUTE_SHADERS
-	if(!ShouldUseGPUShader()) {
-		RunSimulation_Renderthread_CPU(
-			RelativeTransformSinceLastFrame,
-			DeltaTime,
-			LocalSpaceGravity,
-			BoneMatsTmp,
-			IncomingMorphData);
-	} else {
-		RunSimulation_Renderthread_GPU(
-			RelativeTransformSinceLastFrame,
-			DeltaTime,
-			LocalSpaceGravity,
-			BoneMatsTmp, NEOFUR_MAX_BONE_COUNT, // NumBoneMats,
-			IncomingMorphData,
-			RHICmdList);
+	for(int32 Step = 0; Step < NumSteps; Step++) {
+
+		// All the movement since the last step goes to the first one.
+		if(Step > 0) {
+			Params->RelativeTransformSinceLastFrame = FTransform::Identity;
+		}
+
+	  #if !NEOFUR_NO_COMPUTE_SHADERS
+		if(bUseGPU) {
+			// The palette size was fixed when the buffers were generated.
+			// Anything past what the component sent us gets filled in with
+			// identity.
+			int32 NumBoneMats = FMath::Min(Params->BoneMats.Num(), PrivateData->NumBoneMats);
+			RunSimulation_Renderthread_GPU(
+				Params->RelativeTransformSinceLastFrame,
+				Params->DeltaTime,
+				Params->LocalSpaceGravity,
+				Params->BoneMats.GetData(), NumBoneMats,
+				Params->MorphData.Num() ? Params->MorphData.GetData() : nullptr,
+				Params->Forces.GetData(), Step == 0 ? Params->Forces.Num() : 0,
+				Params->CollisionShapes.GetData(), Params->CollisionShapes.Num(),
+				RHICmdList);
+			continue;
+		}
+	  #endif
+
+		RunSimulation_Renderthread_CPU(Params, Step == 0);
 	}
-#else
-	RunSimulation_Renderthread_CPU(
-		RelativeTransformSinceLastFrame,
-		DeltaTime,
-		LocalSpaceGravity,
-		BoneMatsTmp,
-		IncomingMorphData);
-#endif
 
-	if (BoneMats) {
-		delete[] BoneMats;
+	if(NumSteps) {
+		ReadyToRender = true;
 	}
-	delete[] BoneMatsTmp;
-	
-	if(IncomingMorphData) {
-		delete[] IncomingMorphData;
+
+	// The CPU simulation hangs on to the parameters until its jobs are
+	// done. Otherwise everything has been copied into GPU buffers by now.
+	if(bUseGPU || !NumSteps) {
+		Params->bInUse = false;
 	}
 
-	ReadyToRender = true;
+	// Draw the leftover time's worth of the way between the last two
+	// steps. Motion blur wants wherever we drew last frame, which is only
+	// still around if we didn't step. Otherwise the old step is close
+	// enough.
+	PrivateData->PreviousSimulationAlpha = NumSteps ? 0.0f : PrivateData->SimulationAlpha;
+	PrivateData->SimulationAlpha = PrivateData->Stepper.GetAlpha(Params->DeltaTime);
 }
 
 uint32 FNeoFurComponentSceneProxy::GetControlPointCount() const
 {
-	return (PrivateData->ControlPointVertexBuffers_GPU->VertexBufferRHI->GetSize() / sizeof(ControlPointVertexType)) / PrivateData->ShellCount;
+	return PrivateData->ControlPointVertexBuffers_GPU->VertexBufferRHI->GetSize() / sizeof(ControlPointVertexType);
 }
 
 #if !NEOFUR_NO_COMPUTE_SHADERS
@@ -686,12 +793,16 @@ void FNeoFurComponentSceneProxy::RunSimulation_Renderthread_GPU(
 	const FTransform &RelativeTransformSinceLastFrame,
 	float DeltaTime,
 	const FVector &LocalSpaceGravity,
-	FMatrix *BoneMats, int32 NumBoneMats,
-	MorphDataVertexType *IncomingMorphData,
+	const BoneMatrixType *BoneMats, int32 NumBoneMats,
+	const MorphDataVertexType *IncomingMorphData,
+	const FNeoFurForceField *Forces, int32 NumForces,
+	const FNeoFurCollisionShape *CollisionShapes, int32 NumCollisionShapes,
 	FRHICommandListImmediate &RHICmdList)
 {
 	if(PrivateData->bSkipSimulation) return;
 
+	FNeoFurSimulationTimeScope SimulationTime;
+
 	// FIXME: Any assets created in here should probably be created at init
 	// time and NOT every frame. This includes "views" of resources.
 
@@ -719,7 +830,7 @@ void FNeoFurComponentSceneProxy::RunSimulation_Renderthread_GPU(
 		// FIXME: Create this earlier instead of lazy init.
 		if(!PrivateData->SkeletalMeshSRV) {
 			PrivateData->SkeletalMeshSRV = RHICmdList.CreateShaderResourceView(
-				PrivateData->SkeletalMeshVertexBufferCopy_GPU.VertexBufferRHI, sizeof(float), PF_R32_FLOAT);
+				PrivateData->AssetResources->SkeletalMeshVertexBufferCopy_GPU.VertexBufferRHI, sizeof(float), PF_R32_FLOAT);
 		}
 		RHICmdList.SetShaderResourceViewParameter(
 			FComputeShaderRHIParamRef(PrivateData->ComputeShader->GetComputeShader()),
@@ -729,17 +840,16 @@ void FNeoFurComponentSceneProxy::RunSimulation_Renderthread_GPU(
 
 	if(PrivateData->ComputeShader->In_BoneMatrices.IsBound()) {
 
-		FMatrix *BoneMatBuf = nullptr;
-		BoneMatBuf = (FMatrix *)RHILockVertexBuffer(
+		BoneMatrixType *BoneMatBuf = nullptr;
+		BoneMatBuf = (BoneMatrixType *)RHILockVertexBuffer(
 			PrivateData->BoneMatsVertexBuffer.VertexBufferRHI, 0,
 			PrivateData->BoneMatsVertexBuffer.VertexBufferRHI->GetSize(), RLM_WriteOnly);
 			
-		if(BoneMats) {
-			memcpy(BoneMatBuf, BoneMats, sizeof(FMatrix) * NumBoneMats);
-		} else {
-			for(int32 i = 0; i < NumBoneMats; i++) {
-				BoneMatBuf[i] = FMatrix::Identity;
-			}
+		if(NumBoneMats) {
+			memcpy(BoneMatBuf, BoneMats, sizeof(BoneMatrixType) * NumBoneMats);
+		}
+		for(int32 i = NumBoneMats; i < PrivateData->NumBoneMats; i++) {
+			BoneMatBuf[i].SetMatrix(FMatrix::Identity);
 		}
 
 		RHIUnlockVertexBuffer(PrivateData->BoneMatsVertexBuffer.VertexBufferRHI);
@@ -758,25 +868,45 @@ void FNeoFurComponentSceneProxy::RunSimulation_Renderthread_GPU(
 
 	if(PrivateData->ComputeShader->In_PhysicsProperties.IsBound()) {
 
-		FNeoFurPhysicsParameters *PhysicsPropertiesBuf = nullptr;
-		
+		// Layout is the physics parameters, the frame inputs, the number
+		// of forces, the forces, the number of collision shapes, then the
+		// collision shapes. See PHYSICSPARAMETERS_* in
+		// NeoFurComputeShader.usf.
+		uint32 ForcesOffset = sizeof(FNeoFurPhysicsParameters) + sizeof(FNeoFurFramePhysicsInputs) + sizeof(uint32);
+		uint32 CollisionShapesOffset = ForcesOffset + sizeof(FNeoFurForceField) * NumForces + sizeof(uint32);
+		uint32 PhysicsPropertiesSize = CollisionShapesOffset + sizeof(FNeoFurCollisionShape) * NumCollisionShapes;
+
+		// The number of forces can change every frame. The buffer only
+		// ever grows, so this settles down after the busiest frame.
 		// FIXME: Create this once with BUF_Dynamic and rip out the lazy init.
-		if(!PrivateData->PhysicsPropertiesVertBuffer) {
+		if(!PrivateData->PhysicsPropertiesVertBuffer || PrivateData->PhysicsPropertiesVertBuffer->GetSize() < PhysicsPropertiesSize) {
 			FRHIResourceCreateInfo CreateInfo;
-			PrivateData->PhysicsPropertiesVertBuffer = RHICreateVertexBuffer(sizeof(FNeoFurPhysicsParameters) + sizeof(FNeoFurFramePhysicsInputs), BUF_Static | BUF_ShaderResource, CreateInfo);
+			uint32 NewSize =
+				ForcesOffset + sizeof(FNeoFurForceField) * FMath::RoundUpToPowerOfTwo(FMath::Max(NumForces, 4)) +
+				sizeof(uint32) + sizeof(FNeoFurCollisionShape) * NEOFUR_MAX_COLLISION_SHAPES;
+			NewSize = FMath::Max(NewSize, PhysicsPropertiesSize);
+			PrivateData->PhysicsPropertiesVertBuffer = RHICreateVertexBuffer(NewSize, BUF_Static | BUF_ShaderResource, CreateInfo);
+			PrivateData->PhysicsPropertiesSRV = nullptr;
 		}
 
-		PhysicsPropertiesBuf = (FNeoFurPhysicsParameters *)RHILockVertexBuffer(
+		uint8 *PhysicsPropertiesBuf = (uint8 *)RHILockVertexBuffer(
 			PrivateData->PhysicsPropertiesVertBuffer, 0,
-			sizeof(FNeoFurPhysicsParameters) + sizeof(FNeoFurFramePhysicsInputs),
+			PhysicsPropertiesSize,
 			RLM_WriteOnly);
 		memcpy(PhysicsPropertiesBuf, &PrivateData->PhysicsParameters, sizeof(FNeoFurPhysicsParameters));
-		
-		FNeoFurFramePhysicsInputs FrameInputs;
-		memset(&FrameInputs, 0, sizeof(FrameInputs));
-		memcpy(&FrameInputs, &PrivateData->PhysicsFrameInputs, sizeof(FrameInputs));
+		memcpy(PhysicsPropertiesBuf + sizeof(FNeoFurPhysicsParameters), &PrivateData->PhysicsFrameInputs, sizeof(FNeoFurFramePhysicsInputs));
+
+		uint32 ForceCount = NumForces;
+		memcpy(PhysicsPropertiesBuf + ForcesOffset - sizeof(uint32), &ForceCount, sizeof(uint32));
+		if(NumForces) {
+			memcpy(PhysicsPropertiesBuf + ForcesOffset, Forces, sizeof(FNeoFurForceField) * NumForces);
+		}
 
-		memcpy((char*)PhysicsPropertiesBuf + sizeof(FNeoFurPhysicsParameters), &FrameInputs, sizeof(FNeoFurFramePhysicsInputs));
+		uint32 CollisionShapeCount = NumCollisionShapes;
+		memcpy(PhysicsPropertiesBuf + CollisionShapesOffset - sizeof(uint32), &CollisionShapeCount, sizeof(uint32));
+		if(NumCollisionShapes) {
+			memcpy(PhysicsPropertiesBuf + CollisionShapesOffset, CollisionShapes, sizeof(FNeoFurCollisionShape) * NumCollisionShapes);
+		}
 		RHIUnlockVertexBuffer(PrivateData->PhysicsPropertiesVertBuffer);
 		
 		// FIXME: Remove lazy init.
@@ -903,8 +1033,6 @@ void FNeoFurComponentSceneProxy::RunSimulation_Renderthread_GPU(
 		FComputeShaderRHIParamRef(PrivateData->ComputeShader->GetComputeShader()),
 		PrivateData->ComputeShader->In_PerFrameData.GetBaseIndex(),
 		nullptr);
-		
-	PrivateData->LastSimulatedActiveShellCount[PrivateData->ControlPointVertexBufferFrame] = PrivateData->ActiveShellCount;
 
   #if ENGINE_MINOR_VERSION >= 13
 	RHICmdList.TransitionResource(
@@ -956,6 +1084,10 @@ void FNeoFurComponentSceneProxy::GetDynamicMeshElements(
 	if(PrivateData->ActiveShellCount <= 0) return;
 
 	if(!ReadyToRender) return;
+
+	// Pick up this frame's CPU simulation results before we decide which
+	// control point buffer to draw from.
+	FinishSimulation_Renderthread_CPU();
 	
 	for (int32 ViewIndex = 0; ViewIndex < Views.Num(); ViewIndex++) {
 		if ((1 << ViewIndex) & VisibilityMap) {
@@ -969,20 +1101,30 @@ void FNeoFurComponentSceneProxy::GetDynamicMeshElements(
 
             FMeshBatchElement &Element = Batch.Elements[0];
             
-            Element.IndexBuffer = &PrivateData->PostAnimationIndexBuffer;
-            int32 NumPrimitivesTotal = (PrivateData->PostAnimationIndexBuffer.IndexBufferRHI->GetSize() / PrivateData->PostAnimationIndexBuffer.IndexBufferRHI->GetStride()) / 3;
-            int32 TrianglesPerShell = NumPrimitivesTotal / PrivateData->ShellCount;
-            Element.NumPrimitives = TrianglesPerShell * FMath::Min3(
-				PrivateData->ActiveShellCount,
-				PrivateData->LastSimulatedActiveShellCount[0],
-				PrivateData->LastSimulatedActiveShellCount[1]);
+            // Every shell is drawn from the same indices. The vertex
+            // factory works out which shell it's on from the instance ID
+            // plus the element's shell offset.
+            const FIndexBuffer &IndexBuffer = PrivateData->AssetResources->PostAnimationIndexBuffer;
+            Element.IndexBuffer = &IndexBuffer;
+            Element.NumPrimitives = (IndexBuffer.IndexBufferRHI->GetSize() / IndexBuffer.IndexBufferRHI->GetStride()) / 3;
 
             Element.MinVertexIndex = 0;
-            Element.MaxVertexIndex = PrivateData->PostAnimationVertexBuffer.VertexBufferRHI->GetSize() / sizeof(VertexType);
+            Element.MaxVertexIndex = GetControlPointCount() - 1;
             Element.FirstIndex = 0;
             Element.PrimitiveUniformBuffer = CreatePrimitiveUniformBufferImmediate(GetLocalToWorld(), GetBounds(), GetLocalBounds(), true, UseEditorDepthTest());
             
-            Element.UserData = PrivateData;
+            Element.UserData = &PrivateData->ShellBatchData[0];
+
+            if(View.GetFeatureLevel() >= ERHIFeatureLevel::ES3_1) {
+                Element.NumInstances = PrivateData->ActiveShellCount;
+            } else {
+                // No instancing on ES2, so it's one element per shell.
+                for(int32 i = 1; i < PrivateData->ActiveShellCount; i++) {
+                    FMeshBatchElement ShellElement = Batch.Elements[0];
+                    ShellElement.UserData = &PrivateData->ShellBatchData[i];
+                    Batch.Elements.Add(ShellElement);
+                }
+            }
 
             Collector.AddMesh(ViewIndex, Batch);
 		}
@@ -1017,7 +1159,7 @@ void FNeoFurComponentSceneProxy::SetActiveShellCount(int32 NewActiveShellCount,
 		int32, NewActiveShellCount, NewActiveShellCount,
 		float, InShellFade, InShellFade,
 		{
-			if(NewActiveShellCount < 1) NewActiveShellCount = 1;
+			if(NewActiveShellCount < 0) NewActiveShellCount = 0;
 			if(NewActiveShellCount > Proxy->PrivateData->ShellCount) NewActiveShellCount = Proxy->PrivateData->ShellCount;
 			Proxy->PrivateData->ActiveShellCount = NewActiveShellCount;
 			Proxy->PrivateData->ShellFade = InShellFade;
@@ -1072,6 +1214,72 @@ void FNeoFurComponentSceneProxy::SetMaterialProxy(FMaterialRenderProxy *Material
 	);
 }
 
+#if WITH_DEV_AUTOMATION_TESTS
+
+// ---------------------------------------------------------------------------
+// Tests
+// ---------------------------------------------------------------------------
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(
+	FNeoFurControlPointBufferSizeTest,
+	"NeoFur.SceneProxy.ControlPointBufferSize",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FNeoFurControlPointBufferSizeTest::RunTest(const FString &Parameters)
+{
+	typedef FNeoFurComponentSceneProxy::ControlPointVertexType ControlPointVertexType;
+
+	struct FResults
+	{
+		int32 NumControlPoints;
+		uint32 BufferSizes[2];
+		uint32 MemoryUsage;
+	};
+
+	// Sizes as the RHI was asked for them. Under the null RHI, that's all
+	// that happens.
+	const int32 NumControlPointsPerRun[] = { 1, 1000, 4321 };
+	FResults Results[ARRAY_COUNT(NumControlPointsPerRun)];
+	for(int32 Run = 0; Run < ARRAY_COUNT(NumControlPointsPerRun); Run++) {
+		Results[Run].NumControlPoints = NumControlPointsPerRun[Run];
+		ENQUEUE_UNIQUE_RENDER_COMMAND_ONEPARAMETER(
+			NeoFurControlPointBufferSizeTest,
+			FResults *, Result, &Results[Run],
+			{
+				TArray<ControlPointVertexType> ControlPoints_CPU[2];
+				ControlPoints_CPU[0].SetNumZeroed(Result->NumControlPoints);
+				ControlPoints_CPU[1].SetNumZeroed(Result->NumControlPoints);
+
+				FVertexBuffer ControlPoints_GPU[2];
+				Result->MemoryUsage = NeoFurCreateControlPointBuffers(ControlPoints_CPU, ControlPoints_GPU);
+				for(int32 i = 0; i < 2; i++) {
+					Result->BufferSizes[i] = ControlPoints_GPU[i].VertexBufferRHI->GetSize();
+					ControlPoints_GPU[i].VertexBufferRHI.SafeRelease();
+				}
+			}
+		);
+	}
+	FlushRenderingCommands();
+
+	// One control point per source vertex, no matter how many shells get
+	// drawn from them.
+	for(int32 Run = 0; Run < ARRAY_COUNT(NumControlPointsPerRun); Run++) {
+		uint32 ExpectedSize = Results[Run].NumControlPoints * sizeof(ControlPointVertexType);
+		for(int32 i = 0; i < 2; i++) {
+			TestEqual(
+				FString::Printf(TEXT("Control point buffer %d size for %d control points"), i, Results[Run].NumControlPoints),
+				int32(Results[Run].BufferSizes[i]), int32(ExpectedSize));
+		}
+		TestEqual(
+			FString::Printf(TEXT("Control point memory usage for %d control points"), Results[Run].NumControlPoints),
+			int32(Results[Run].MemoryUsage), int32(ExpectedSize * 2));
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
+
 
 
 
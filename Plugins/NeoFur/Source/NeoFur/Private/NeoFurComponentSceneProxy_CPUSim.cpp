@@ -15,8 +15,7 @@
 // FNeoFurComponentSceneProxy, so for organization we'll have it in
 // its own file.
 
-// FNeoFurComponentSceneProxy::RunSimulation_Renderthread_CPU() should
-// operate very similarly to NeoFurComputeShader_Main() in
+// NeoFurSimulateControlPoints() should operate very similarly to NeoFurComputeShader_Main() in
 // NeoFurComputeShader.usf. If this is altered to have different
 // behavior, NeoFurComputeShader_Main() must be updated to maintain
 // parity between the two versions.
@@ -29,6 +28,7 @@
 #include "EngineModule.h"
 #include "RHICommandList.h"
 #include "ShaderParameterUtils.h"
+#include "Misc/AutomationTest.h"
 
 #include "NeoFurComponent.h"
 #include "NeoFurComponentSceneProxy.h"
@@ -66,216 +66,404 @@ inline FVector GetPositionForShell(
 	return NewPoint_Position;
 }
 
-void FNeoFurComponentSceneProxy::RunSimulation_Renderthread_CPU(
-	const FTransform &RelativeTransformSinceLastFrame,
-	float DeltaTime,
-	const FVector &LocalSpaceGravity,
-	FMatrix *BoneMats,
-	MorphDataVertexType *IncomingMorphData)
+// ---------------------------------------------------------------------------
+// SIMD helpers
+// ---------------------------------------------------------------------------
+
+static_assert(NEOFUR_CPU_SIM_CHUNK_SIZE % 4 == 0, "NEOFUR_CPU_SIM_CHUNK_SIZE must be a multiple of the SIMD width.");
+
+static FORCEINLINE VectorRegister NeoFurVectorDot3(
+	const VectorRegister &AX, const VectorRegister &AY, const VectorRegister &AZ,
+	const VectorRegister &BX, const VectorRegister &BY, const VectorRegister &BZ)
 {
-	check(IsInRenderingThread());
-	check(!ShouldUseGPUShader());
+	return VectorMultiplyAdd(AX, BX, VectorMultiplyAdd(AY, BY, VectorMultiply(AZ, BZ)));
+}
 
-	if(PrivateData->bSkipSimulation) return;
+// Reciprocal square root estimate plus one Newton-Raphson step, which gets
+// us close enough to full float precision for everything in here.
+static FORCEINLINE VectorRegister NeoFurVectorReciprocalSqrt(const VectorRegister &X)
+{
+	const VectorRegister OneHalf = VectorSetFloat1(0.5f);
+	const VectorRegister ThreeHalves = VectorSetFloat1(1.5f);
+	VectorRegister Estimate = VectorReciprocalSqrt(X);
+	VectorRegister HalfXEstimateSquared = VectorMultiply(VectorMultiply(OneHalf, X), VectorMultiply(Estimate, Estimate));
+	return VectorMultiply(Estimate, VectorSubtract(ThreeHalves, HalfXEstimateSquared));
+}
 
-	// We need to compute the skinned position of the simulated vertices. To do
-	// this, we'll add up influences of...
-	//   gravity,
-	//   existing particle velocity,
-	//   spring force with the original skinned vert,
-	//   velocity from the relative transform,
-	//   and compute a new control point position.
-
-	TArray<ControlPointVertexType> &NewControlPoints = PrivateData->ControlPointVertexBuffers_CPU[!PrivateData->ControlPointVertexBufferFrame];
-	const TArray<ControlPointVertexType> &OldControlPoints = PrivateData->ControlPointVertexBuffers_CPU[PrivateData->ControlPointVertexBufferFrame];
-	int32 NumControlPoints = OldControlPoints.Num();
-
-	// Names to match globals in the compute shader.
-	int32 In_ShellCount = PrivateData->ActiveShellCount;
-	int32 In_TotalShellCount = PrivateData->ShellCount;
-	float In_ShellDistance = PrivateData->ShellDistance;
-	
-	for (int32 i = 0; i < NumControlPoints; i++) {
-
-		NewControlPoints[i] = OldControlPoints[i];
-		
-		// Compute skinned vertex location and normal/tangent.
-		// --------------------------------------------------------------------
+// Square root that returns zero (instead of NaN) for zero-length inputs.
+static FORCEINLINE VectorRegister NeoFurVectorSqrt(const VectorRegister &X)
+{
+	VectorRegister Positive = VectorCompareGT(X, VectorZero());
+	return VectorSelect(Positive, VectorMultiply(X, NeoFurVectorReciprocalSqrt(X)), VectorZero());
+}
 
-		VertexType SkinnedRenderPoint;
-		VertexType_Static &StaticVert = PrivateData->StaticVertexData_CPU[i];
+// acos() approximation (Abramowitz and Stegun 4.4.45). Max error is
+// around 7e-5 radians, which is way below anything you can see in the
+// torsion spring.
+static FORCEINLINE VectorRegister NeoFurVectorACos(const VectorRegister &X)
+{
+	VectorRegister AbsX = VectorMin(VectorAbs(X), VectorOne());
+	VectorRegister Poly = VectorSetFloat1(-0.0187293f);
+	Poly = VectorMultiplyAdd(Poly, AbsX, VectorSetFloat1(0.0742610f));
+	Poly = VectorMultiplyAdd(Poly, AbsX, VectorSetFloat1(-0.2121144f));
+	Poly = VectorMultiplyAdd(Poly, AbsX, VectorSetFloat1(1.5707288f));
+	VectorRegister Result = VectorMultiply(Poly, NeoFurVectorSqrt(VectorSubtract(VectorOne(), AbsX)));
+	VectorRegister Negative = VectorCompareGT(VectorZero(), X);
+	return VectorSelect(Negative, VectorSubtract(VectorSetFloat1(PI), Result), Result);
+}
 
-		SkinnedRenderPoint.Position = StaticVert.Position;
-		SkinnedRenderPoint.TanZ = StaticVert.TanZ;
-		SkinnedRenderPoint.TanX = StaticVert.TanX;
-		for(int32 k = 0; k < MAX_TEXCOORDS; k++) {
-			SkinnedRenderPoint.UVs[k] = StaticVert.UVs[k];
-		}
-		SkinnedRenderPoint.CombedDirectionAndLength = StaticVert.CombedDirectionAndLength;
+// ---------------------------------------------------------------------------
+// Simulation kernel
+// ---------------------------------------------------------------------------
+
+// Seed the SoA working set from the AoS control points that
+// GenerateBuffers() set up.
+static void NeoFurInitCPUSimState(
+	FNeoFurCPUSimState &State,
+	const TArray<FNeoFurComponentSceneProxy::ControlPointVertexType> &ControlPoints)
+{
+	State.NumControlPoints = ControlPoints.Num();
+	State.bRestPoseRoots = false;
+	State.SettledSteps = 0;
+	int32 PaddedCount = Align(State.NumControlPoints, 4);
+
+	FNeoFurCPUSimState::FFloatArray *Arrays[] = {
+		&State.PositionX, &State.PositionY, &State.PositionZ,
+		&State.VelocityX, &State.VelocityY, &State.VelocityZ,
+		&State.RootX,     &State.RootY,     &State.RootZ,
+		&State.SplineX,   &State.SplineY,   &State.SplineZ,
+		&State.NormalX,   &State.NormalY,   &State.NormalZ,
+	};
+	for(int32 i = 0; i < ARRAY_COUNT(Arrays); i++) {
+		Arrays[i]->Reset(PaddedCount);
+		Arrays[i]->SetNumZeroed(PaddedCount);
+	}
+
+	// No bounds yet, so every force reaches every chunk until the first
+	// step is done.
+	State.ChunkBounds.Reset();
+	State.ChunkBounds.Init(FBox(ForceInit), FMath::DivideAndRoundUp(State.NumControlPoints, NEOFUR_CPU_SIM_CHUNK_SIZE));
+
+	for(int32 i = 0; i < State.NumControlPoints; i++) {
+		State.PositionX[i] = ControlPoints[i].Position.X;
+		State.PositionY[i] = ControlPoints[i].Position.Y;
+		State.PositionZ[i] = ControlPoints[i].Position.Z;
+		State.VelocityX[i] = ControlPoints[i].Velocity.X;
+		State.VelocityY[i] = ControlPoints[i].Velocity.Y;
+		State.VelocityZ[i] = ControlPoints[i].Velocity.Z;
+	}
+}
+
+// Skinning and morph targets. The bone indices differ per control point,
+// so this is done one point at a time (with SIMD matrix math) and
+// scattered into the SoA arrays for the rest of the kernel.
+template<bool bSkeletal, bool bMorphs>
+static void NeoFurSkinControlPoints(const FNeoFurCPUSimJob &Job, int32 StartIndex, int32 EndIndex)
+{
+	FNeoFurCPUSimState &State = *Job.State;
+	const FMatrix *BoneMats = Job.BoneMats;
+	const FNeoFurComponentSceneProxy::MorphDataVertexType *IncomingMorphData = Job.MorphData;
+
+	for(int32 i = StartIndex; i < EndIndex; i++) {
+
+		const FNeoFurComponentSceneProxy::VertexType_Static &StaticVert = Job.StaticVerts[i];
+
+		FVector Position = StaticVert.Position;
+		FVector TanZ = StaticVert.TanZ;
+		FVector SplineDir = StaticVert.CombedDirectionAndLength;
 
 		// Apply morph target data to the position and normal.
-		if(IncomingMorphData) {
-			SkinnedRenderPoint.Position += IncomingMorphData[i].Offset;
-			SkinnedRenderPoint.TanZ += IncomingMorphData[i].Normal;
+		if(bMorphs) {
+			Position += IncomingMorphData[i].Offset;
+			TanZ += IncomingMorphData[i].Normal;
 		}
 
-		if (BoneMats) {
+		if(bSkeletal) {
+			VectorRegister SourcePosition = VectorLoadFloat3_W1(&Position);
+			VectorRegister SourceTanZ = VectorLoadFloat3_W0(&TanZ);
+			VectorRegister SourceSplineDir = VectorLoadFloat3_W0(&SplineDir);
+
+			VectorRegister FinalPosition = VectorZero();
+			VectorRegister FinalTanZ = VectorZero();
+			VectorRegister FinalSplineDir = VectorZero();
 			float TotalInfluence = 0.0f;
-			FVector FinalPosition(0.0f, 0.0f, 0.0f);
-			FVector FinalTanZ(0.0f, 0.0f, 0.0f);
-			FVector FinalTanX(0.0f, 0.0f, 0.0f);
-			FVector FinalSplineDir(0.0f, 0.0f, 0.0f);
 
-			for (int32 j = 0; j < sizeof(StaticVert.InfluenceBones) / sizeof(StaticVert.InfluenceBones[0]); j++) {
-				if (StaticVert.InfluenceWeights[j]) {
+			for(int32 j = 0; j < ARRAY_COUNT(StaticVert.InfluenceBones); j++) {
+				if(StaticVert.InfluenceWeights[j]) {
 					float ThisWeight = float(StaticVert.InfluenceWeights[j]) / 255.0f;
-					
-					// SkinnedRenderPoint is used as the source
-					// instead of StaticVert here because we want to
-					// get the data from after morph targets.
-					FinalPosition  += BoneMats[StaticVert.InfluenceBones[j]].TransformPosition(SkinnedRenderPoint.Position) * ThisWeight;
-					FinalTanZ      += BoneMats[StaticVert.InfluenceBones[j]].TransformVector(SkinnedRenderPoint.TanZ) * ThisWeight;
-
-					FinalTanX      += BoneMats[StaticVert.InfluenceBones[j]].TransformVector(StaticVert.TanX) * ThisWeight;
-					FinalSplineDir += BoneMats[StaticVert.InfluenceBones[j]].TransformVector(StaticVert.CombedDirectionAndLength) * ThisWeight;
+					VectorRegister Weight = VectorSetFloat1(ThisWeight);
+					const FMatrix *BoneMat = &BoneMats[StaticVert.InfluenceBones[j]];
+
+					// Position and normal come from after morph targets.
+					FinalPosition  = VectorMultiplyAdd(VectorTransformVector(SourcePosition, BoneMat), Weight, FinalPosition);
+					FinalTanZ      = VectorMultiplyAdd(VectorTransformVector(SourceTanZ, BoneMat), Weight, FinalTanZ);
+					FinalSplineDir = VectorMultiplyAdd(VectorTransformVector(SourceSplineDir, BoneMat), Weight, FinalSplineDir);
 					TotalInfluence += ThisWeight;
 				}
 			}
 
 			if(TotalInfluence) {
-				FinalPosition /= TotalInfluence;
-				FinalTanZ /= TotalInfluence;
-				FinalTanX /= TotalInfluence;
-				FinalSplineDir /= TotalInfluence;
+				VectorRegister InvTotalInfluence = VectorSetFloat1(1.0f / TotalInfluence);
+				FinalPosition = VectorMultiply(FinalPosition, InvTotalInfluence);
+				FinalTanZ = VectorMultiply(FinalTanZ, InvTotalInfluence);
+				FinalSplineDir = VectorMultiply(FinalSplineDir, InvTotalInfluence);
 			}
-			
-			SkinnedRenderPoint.Position = FinalPosition;
-			SkinnedRenderPoint.TanZ = FinalTanZ;
-			SkinnedRenderPoint.TanX = FinalTanX;
-			SkinnedRenderPoint.CombedDirectionAndLength = FinalSplineDir;
+
+			VectorStoreFloat3(FinalPosition, &Position);
+			VectorStoreFloat3(FinalTanZ, &TanZ);
+			VectorStoreFloat3(FinalSplineDir, &SplineDir);
 		}
-		FVector NormalizedSplineDir = SkinnedRenderPoint.CombedDirectionAndLength;
-		float SplineLength = SkinnedRenderPoint.CombedDirectionAndLength.Size();
-		NormalizedSplineDir /= SplineLength;
 
-		// Needed for motion blur.
-		FVector OldRootPosition = OldControlPoints[i].RootPosition;
-		FVector ControlPointPosition_Old = OldControlPoints[i].Position;
+		FVector Normal = TanZ.GetUnsafeNormal();
+
+		State.RootX[i] = Position.X;
+		State.RootY[i] = Position.Y;
+		State.RootZ[i] = Position.Z;
+		State.SplineX[i] = SplineDir.X;
+		State.SplineY[i] = SplineDir.Y;
+		State.SplineZ[i] = SplineDir.Z;
+		State.NormalX[i] = Normal.X;
+		State.NormalY[i] = Normal.Y;
+		State.NormalZ[i] = Normal.Z;
+	}
+}
+
+// Springs, forces, integration and clamping, four control points at a
+// time. StartIndex and EndIndex must be multiples of four. Lanes past
+// the real control point count are padding; they get simulated but are
+// never copied out. Forces is the subset of the job's forces that can
+// reach this range.
+template<bool bForces, bool bWindGusts, bool bDistanceClamp, bool bAngleClamp>
+static void NeoFurIntegrateControlPoints(
+	const FNeoFurCPUSimJob &Job, int32 StartIndex, int32 EndIndex,
+	const FNeoFurForceField *const *Forces, int32 NumForces)
+{
+	FNeoFurCPUSimState &State = *Job.State;
+	const FNeoFurPhysicsParameters &Params = Job.PhysicsParameters;
+	const FNeoFurFramePhysicsInputs &Inputs = Job.PhysicsFrameInputs;
+
+	const VectorRegister Zero = VectorZero();
+	const VectorRegister One = VectorOne();
+	const VectorRegister MaxFloat = VectorSetFloat1(MAX_flt);
+	const VectorRegister SmallNumber = VectorSetFloat1(SMALL_NUMBER);
+	const VectorRegister MinSpringLength = VectorSetFloat1(0.01f);
+
+	const VectorRegister DeltaTime = VectorSetFloat1(Job.DeltaTime);
+	const VectorRegister InvDeltaTime = VectorSetFloat1(1.0f / Job.DeltaTime);
+	const VectorRegister ShellDistance = VectorSetFloat1(Job.ShellDistance);
+	const VectorRegister SpringLengthStiffness = VectorSetFloat1(Params.SpringLengthStiffness);
+	const VectorRegister AngleStiffnessStep = VectorSetFloat1(Params.SpringAngleStiffness * Job.DeltaTime);
+	const VectorRegister SpringDampeningStep = VectorSetFloat1(Params.SpringDampeningMultiplier * Job.DeltaTime);
+	const VectorRegister AirResistance = VectorSetFloat1(Params.AirResistanceMultiplier);
+	const VectorRegister MaxDistanceScale = VectorSetFloat1(Job.ShellDistance * Params.MaxStretchDistanceMultiplier);
+
+	// Note: Don't just accelerate down at 9.8m/s/s. This is to represent
+	// the FORCE of gravity, when balanced with all the spring systems and
+	// whatever other parts of the sim.
+	FVector GravityStep = Params.GravityInfluence * Job.LocalSpaceGravity * Job.DeltaTime;
+	const VectorRegister GravityX = VectorSetFloat1(GravityStep.X);
+	const VectorRegister GravityY = VectorSetFloat1(GravityStep.Y);
+	const VectorRegister GravityZ = VectorSetFloat1(GravityStep.Z);
+
+	FVector WindStep = Inputs.WindVector * Job.DeltaTime;
+	const VectorRegister WindX = VectorSetFloat1(WindStep.X);
+	const VectorRegister WindY = VectorSetFloat1(WindStep.Y);
+	const VectorRegister WindZ = VectorSetFloat1(WindStep.Z);
+	const VectorRegister WindGustsAmount = VectorSetFloat1(Inputs.WindGustsAmount);
+
+	// FIXME: Same rough degree-to-radian conversion as the compute shader.
+	float MaxRotation = Params.MaxRotationFromNormal * 3.14159f / 180.0f;
+	const VectorRegister CosMaxRotation = VectorSetFloat1(FMath::Cos(MaxRotation));
+	const VectorRegister SinMaxRotation = VectorSetFloat1(FMath::Sin(MaxRotation));
+
+	const FMatrix &VelocityTransform = Job.VelocityTransform;
+	VectorRegister VelocityTransformRegs[4][3];
+	for(int32 Row = 0; Row < 4; Row++) {
+		for(int32 Column = 0; Column < 3; Column++) {
+			VelocityTransformRegs[Row][Column] = VectorSetFloat1(VelocityTransform.M[Row][Column]);
+		}
+	}
+
+	for(int32 i = StartIndex; i < EndIndex; i += 4) {
+
+		VectorRegister RootX = VectorLoadAligned(&State.RootX[i]);
+		VectorRegister RootY = VectorLoadAligned(&State.RootY[i]);
+		VectorRegister RootZ = VectorLoadAligned(&State.RootZ[i]);
+
+		VectorRegister VelocityX = VectorLoadAligned(&State.VelocityX[i]);
+		VectorRegister VelocityY = VectorLoadAligned(&State.VelocityY[i]);
+		VectorRegister VelocityZ = VectorLoadAligned(&State.VelocityZ[i]);
+
+		VectorRegister SplineX = VectorLoadAligned(&State.SplineX[i]);
+		VectorRegister SplineY = VectorLoadAligned(&State.SplineY[i]);
+		VectorRegister SplineZ = VectorLoadAligned(&State.SplineZ[i]);
+		VectorRegister SplineLength = NeoFurVectorSqrt(NeoFurVectorDot3(SplineX, SplineY, SplineZ, SplineX, SplineY, SplineZ));
+		VectorRegister InvSplineLength = VectorDivide(One, SplineLength);
+		VectorRegister DirX = VectorMultiply(SplineX, InvSplineLength);
+		VectorRegister DirY = VectorMultiply(SplineY, InvSplineLength);
+		VectorRegister DirZ = VectorMultiply(SplineZ, InvSplineLength);
 
 		// Velocity as a result of the different transform.
 		// --------------------------------------------------------------------
-		
+
 		// General velocity "fudge". Not realistic, but makes it look stiff by
 		// faking it.
-		float VelocityAlpha = PrivateData->PhysicsParameters.VelocityInfluence;
-		NewControlPoints[i].Position =
-			VelocityAlpha * RelativeTransformSinceLastFrame.TransformPosition(OldControlPoints[i].Position) +
-			(1.0f - VelocityAlpha) * OldControlPoints[i].Position; // FIXME: Work skinning into this equation.
+		VectorRegister OldX = VectorLoadAligned(&State.PositionX[i]);
+		VectorRegister OldY = VectorLoadAligned(&State.PositionY[i]);
+		VectorRegister OldZ = VectorLoadAligned(&State.PositionZ[i]);
+		VectorRegister PositionX = VectorMultiplyAdd(OldX, VelocityTransformRegs[0][0], VectorMultiplyAdd(OldY, VelocityTransformRegs[1][0], VectorMultiplyAdd(OldZ, VelocityTransformRegs[2][0], VelocityTransformRegs[3][0])));
+		VectorRegister PositionY = VectorMultiplyAdd(OldX, VelocityTransformRegs[0][1], VectorMultiplyAdd(OldY, VelocityTransformRegs[1][1], VectorMultiplyAdd(OldZ, VelocityTransformRegs[2][1], VelocityTransformRegs[3][1])));
+		VectorRegister PositionZ = VectorMultiplyAdd(OldX, VelocityTransformRegs[0][2], VectorMultiplyAdd(OldY, VelocityTransformRegs[1][2], VectorMultiplyAdd(OldZ, VelocityTransformRegs[2][2], VelocityTransformRegs[3][2])));
 
 		// Spring simulation.
 		// --------------------------------------------------------------------
 		{
-			FVector TotalSpringForce(0.0f, 0.0f, 0.0f);
-			
-			// Spring length stuff.
-			FVector SpringVector = NewControlPoints[i].Position - SkinnedRenderPoint.Position;
-			float SpringLength = SpringVector.Size();
-
-			if(SpringLength > 0.01f) {
-
-				// Linear spring.
-				// TODO: Add maximum position offset clamping (max spring squish/stretch). That can help prevent fast motions from letting the control point sink into the body.
-				float SpringRestLength = In_ShellDistance * SplineLength;
-				float SpringOffset = SpringRestLength - SpringLength;
-				float SpringStiffness = PrivateData->PhysicsParameters.SpringLengthStiffness;
-				float SpringForce = SpringStiffness * SpringOffset;
-				TotalSpringForce += (SpringVector / SpringLength) * SpringForce;
-
-				// Torsion spring stuff.
-				// TODO: Add maximum angle offset clamping. That can help prevent fast motions from letting the control point sink into the body.
-				float dp = FVector::DotProduct((SpringVector / SpringLength), NormalizedSplineDir);
-				float AngleOffset = 0.0f;
-				if(dp < 1.0) {
-					AngleOffset = acos(dp);
-				}
-				float AngleSpringStiffness = PrivateData->PhysicsParameters.SpringAngleStiffness;
-				if (AngleOffset) {
-				    
-					FVector SkinnedPositionTarget = SkinnedRenderPoint.Position + NormalizedSplineDir * In_ShellDistance * SplineLength;
-					FVector AngleSpringReturnForceDirection = SkinnedPositionTarget - NewControlPoints[i].Position;
-					AngleSpringReturnForceDirection.Normalize();
-					FVector FinalReturnVelocity = AngleSpringReturnForceDirection * DeltaTime * AngleSpringStiffness * AngleOffset;
-
-					// Clamp to maximum required velocity to get to rest position this frame.
-					if ((NewControlPoints[i].Position - SkinnedPositionTarget).SizeSquared() < (FinalReturnVelocity * DeltaTime).SizeSquared()) {
-						FinalReturnVelocity = (SkinnedPositionTarget - NewControlPoints[i].Position) / DeltaTime;
-					}
-					
-					TotalSpringForce += FinalReturnVelocity / DeltaTime;
-				}
+			VectorRegister SpringX = VectorSubtract(PositionX, RootX);
+			VectorRegister SpringY = VectorSubtract(PositionY, RootY);
+			VectorRegister SpringZ = VectorSubtract(PositionZ, RootZ);
+			VectorRegister SpringLength = NeoFurVectorSqrt(NeoFurVectorDot3(SpringX, SpringY, SpringZ, SpringX, SpringY, SpringZ));
+			VectorRegister SpringMask = VectorCompareGT(SpringLength, MinSpringLength);
+			VectorRegister InvSpringLength = VectorDivide(One, SpringLength);
+			SpringX = VectorMultiply(SpringX, InvSpringLength);
+			SpringY = VectorMultiply(SpringY, InvSpringLength);
+			SpringZ = VectorMultiply(SpringZ, InvSpringLength);
 
-			}
-			
-			float SpringDampening = PrivateData->PhysicsParameters.SpringDampeningMultiplier;
+			// Linear spring.
+			VectorRegister SpringRestLength = VectorMultiply(ShellDistance, SplineLength);
+			VectorRegister SpringForce = VectorMultiply(SpringLengthStiffness, VectorSubtract(SpringRestLength, SpringLength));
+			VectorRegister TotalSpringForceX = VectorMultiply(SpringX, SpringForce);
+			VectorRegister TotalSpringForceY = VectorMultiply(SpringY, SpringForce);
+			VectorRegister TotalSpringForceZ = VectorMultiply(SpringZ, SpringForce);
+
+			// Torsion spring.
+			VectorRegister Dp = NeoFurVectorDot3(SpringX, SpringY, SpringZ, DirX, DirY, DirZ);
+			VectorRegister AngleOffset = VectorSelect(VectorCompareGT(One, Dp), NeoFurVectorACos(Dp), Zero);
+			VectorRegister AngleMask = VectorBitwiseAnd(SpringMask, VectorCompareNE(AngleOffset, Zero));
 
-			NewControlPoints[i].Velocity += TotalSpringForce * DeltaTime * SpringDampening;
+			VectorRegister ToTargetX = VectorSubtract(VectorMultiplyAdd(DirX, SpringRestLength, RootX), PositionX);
+			VectorRegister ToTargetY = VectorSubtract(VectorMultiplyAdd(DirY, SpringRestLength, RootY), PositionY);
+			VectorRegister ToTargetZ = VectorSubtract(VectorMultiplyAdd(DirZ, SpringRestLength, RootZ), PositionZ);
+			VectorRegister ToTargetSizeSquared = NeoFurVectorDot3(ToTargetX, ToTargetY, ToTargetZ, ToTargetX, ToTargetY, ToTargetZ);
+
+			// Same as FVector::Normalize(), which leaves tiny vectors alone.
+			VectorRegister NormalizeScale = VectorSelect(
+				VectorCompareGT(ToTargetSizeSquared, SmallNumber),
+				NeoFurVectorReciprocalSqrt(ToTargetSizeSquared), One);
+			VectorRegister ReturnScale = VectorMultiply(VectorMultiply(NormalizeScale, AngleStiffnessStep), AngleOffset);
+			VectorRegister ReturnVelocityX = VectorMultiply(ToTargetX, ReturnScale);
+			VectorRegister ReturnVelocityY = VectorMultiply(ToTargetY, ReturnScale);
+			VectorRegister ReturnVelocityZ = VectorMultiply(ToTargetZ, ReturnScale);
+
+			// Clamp to maximum required velocity to get to rest position this frame.
+			VectorRegister ReturnStepSizeSquared = VectorMultiply(
+				NeoFurVectorDot3(ReturnVelocityX, ReturnVelocityY, ReturnVelocityZ, ReturnVelocityX, ReturnVelocityY, ReturnVelocityZ),
+				VectorMultiply(DeltaTime, DeltaTime));
+			VectorRegister OvershootMask = VectorCompareGT(ReturnStepSizeSquared, ToTargetSizeSquared);
+			ReturnVelocityX = VectorSelect(OvershootMask, VectorMultiply(ToTargetX, InvDeltaTime), ReturnVelocityX);
+			ReturnVelocityY = VectorSelect(OvershootMask, VectorMultiply(ToTargetY, InvDeltaTime), ReturnVelocityY);
+			ReturnVelocityZ = VectorSelect(OvershootMask, VectorMultiply(ToTargetZ, InvDeltaTime), ReturnVelocityZ);
+
+			TotalSpringForceX = VectorSelect(AngleMask, VectorMultiplyAdd(ReturnVelocityX, InvDeltaTime, TotalSpringForceX), TotalSpringForceX);
+			TotalSpringForceY = VectorSelect(AngleMask, VectorMultiplyAdd(ReturnVelocityY, InvDeltaTime, TotalSpringForceY), TotalSpringForceY);
+			TotalSpringForceZ = VectorSelect(AngleMask, VectorMultiplyAdd(ReturnVelocityZ, InvDeltaTime, TotalSpringForceZ), TotalSpringForceZ);
+
+			VelocityX = VectorSelect(SpringMask, VectorMultiplyAdd(TotalSpringForceX, SpringDampeningStep, VelocityX), VelocityX);
+			VelocityY = VectorSelect(SpringMask, VectorMultiplyAdd(TotalSpringForceY, SpringDampeningStep, VelocityY), VelocityY);
+			VelocityZ = VectorSelect(SpringMask, VectorMultiplyAdd(TotalSpringForceZ, SpringDampeningStep, VelocityZ), VelocityZ);
 		}
-		
+
 		// Gravity
 		// --------------------------------------------------------------------
-		// Note: Don't just accelerate down at 9.8m/s/s. This is to represent
-		// the FORCE of gravity, when balanced with all the spring systems and
-		// whatever other parts of the sim.
-		NewControlPoints[i].Velocity += PrivateData->PhysicsParameters.GravityInfluence * LocalSpaceGravity * DeltaTime;
+		VelocityX = VectorAdd(VelocityX, GravityX);
+		VelocityY = VectorAdd(VelocityY, GravityY);
+		VelocityZ = VectorAdd(VelocityZ, GravityZ);
 
-		// Radial force effects.
+		// Force effects. Radial, directional and vortex forces are all
+		// mixed together the same way. See FNeoFurForceField.
 		// --------------------------------------------------------------------
-		for(int k = 0; k < PrivateData->PhysicsFrameInputs.NumForcesThisFrame; k++) {
-			FVector RadialForceVector = NewControlPoints[i].Position - PrivateData->PhysicsFrameInputs.LocalForces[k].Origin;
-			float RadialForceDistance = RadialForceVector.Size();
-			float RadialForceScale = 1.0f - (RadialForceDistance / PrivateData->PhysicsFrameInputs.LocalForces[k].Radius);
-			if(RadialForceDistance && RadialForceScale > 0.0f) {
-				RadialForceVector /= RadialForceDistance;
-				NewControlPoints[i].Velocity +=
-					RadialForceVector *
-					PrivateData->PhysicsFrameInputs.LocalForces[k].Strength *
-					RadialForceScale *
-					PrivateData->PhysicsParameters.RadialForceInfluence;
-			}
+		for(int32 k = 0; bForces && k < NumForces; k++) {
+			const FNeoFurForceField &Force = *Forces[k];
+			VectorRegister OffsetX = VectorSubtract(PositionX, VectorSetFloat1(Force.Origin.X));
+			VectorRegister OffsetY = VectorSubtract(PositionY, VectorSetFloat1(Force.Origin.Y));
+			VectorRegister OffsetZ = VectorSubtract(PositionZ, VectorSetFloat1(Force.Origin.Z));
+			VectorRegister ForceDistance = NeoFurVectorSqrt(NeoFurVectorDot3(OffsetX, OffsetY, OffsetZ, OffsetX, OffsetY, OffsetZ));
+			VectorRegister ForceScale = VectorSubtract(One, VectorDivide(ForceDistance, VectorSetFloat1(Force.Radius)));
+			VectorRegister ForceMask = VectorBitwiseAnd(
+				VectorCompareNE(ForceDistance, Zero),
+				VectorCompareGT(ForceScale, Zero));
+			VectorRegister ForceAmount = VectorMultiply(ForceScale, VectorSetFloat1(Force.Strength * Params.RadialForceInfluence));
+			VectorRegister InvForceDistance = VectorDivide(One, ForceDistance);
+
+			// (Offset * RadialScale + Axis x Offset) / Distance + Direction
+			VectorRegister RadialScale = VectorSetFloat1(Force.RadialScale);
+			VectorRegister AxisX = VectorSetFloat1(Force.Axis.X);
+			VectorRegister AxisY = VectorSetFloat1(Force.Axis.Y);
+			VectorRegister AxisZ = VectorSetFloat1(Force.Axis.Z);
+			VectorRegister ForceX = VectorMultiplyAdd(OffsetX, RadialScale, VectorSubtract(VectorMultiply(AxisY, OffsetZ), VectorMultiply(AxisZ, OffsetY)));
+			VectorRegister ForceY = VectorMultiplyAdd(OffsetY, RadialScale, VectorSubtract(VectorMultiply(AxisZ, OffsetX), VectorMultiply(AxisX, OffsetZ)));
+			VectorRegister ForceZ = VectorMultiplyAdd(OffsetZ, RadialScale, VectorSubtract(VectorMultiply(AxisX, OffsetY), VectorMultiply(AxisY, OffsetX)));
+			ForceX = VectorMultiplyAdd(ForceX, InvForceDistance, VectorSetFloat1(Force.Direction.X));
+			ForceY = VectorMultiplyAdd(ForceY, InvForceDistance, VectorSetFloat1(Force.Direction.Y));
+			ForceZ = VectorMultiplyAdd(ForceZ, InvForceDistance, VectorSetFloat1(Force.Direction.Z));
+
+			VelocityX = VectorSelect(ForceMask, VectorMultiplyAdd(ForceX, ForceAmount, VelocityX), VelocityX);
+			VelocityY = VectorSelect(ForceMask, VectorMultiplyAdd(ForceY, ForceAmount, VelocityY), VelocityY);
+			VelocityZ = VectorSelect(ForceMask, VectorMultiplyAdd(ForceZ, ForceAmount, VelocityZ), VelocityZ);
 		}
 
 		// "Air Resistance" Dampening - Deceleration proportional to velocity.
 		// --------------------------------------------------------------------
-		NewControlPoints[i].Velocity *= PrivateData->PhysicsParameters.AirResistanceMultiplier;
+		VelocityX = VectorMultiply(VelocityX, AirResistance);
+		VelocityY = VectorMultiply(VelocityY, AirResistance);
+		VelocityZ = VectorMultiply(VelocityZ, AirResistance);
 
 		// Wind
 		// --------------------------------------------------------------------
-
-		FVector WindVector = PrivateData->PhysicsFrameInputs.WindVector * DeltaTime;
-		NewControlPoints[i].Velocity += WindVector;
-		NewControlPoints[i].Velocity += WindVector * sin(FVector::DotProduct(
-			NewControlPoints[i].Position, WindVector)) * PrivateData->PhysicsFrameInputs.WindGustsAmount;
+		VelocityX = VectorAdd(VelocityX, WindX);
+		VelocityY = VectorAdd(VelocityY, WindY);
+		VelocityZ = VectorAdd(VelocityZ, WindZ);
+		if(bWindGusts) {
+			// There's no vector sin() we can count on here, so do the
+			// gust phase one lane at a time.
+			MS_ALIGN(16) float GustLanes[4] GCC_ALIGN(16);
+			VectorStoreAligned(NeoFurVectorDot3(PositionX, PositionY, PositionZ, WindX, WindY, WindZ), GustLanes);
+			for(int32 Lane = 0; Lane < 4; Lane++) {
+				GustLanes[Lane] = FMath::Sin(GustLanes[Lane]);
+			}
+			VectorRegister Gust = VectorMultiply(VectorLoadAligned(GustLanes), WindGustsAmount);
+			VelocityX = VectorMultiplyAdd(WindX, Gust, VelocityX);
+			VelocityY = VectorMultiplyAdd(WindY, Gust, VelocityY);
+			VelocityZ = VectorMultiplyAdd(WindZ, Gust, VelocityZ);
+		}
 
 		// Finally, apply the velocity to the particle's position.
 		// --------------------------------------------------------------------
-		if(!FMath::IsNaN(NewControlPoints[i].Velocity.X) && !FMath::IsNaN(NewControlPoints[i].Velocity.Y) && !FMath::IsNaN(NewControlPoints[i].Velocity.Z) &&
-			FMath::IsFinite(NewControlPoints[i].Velocity.X) && FMath::IsFinite(NewControlPoints[i].Velocity.Y) && FMath::IsFinite(NewControlPoints[i].Velocity.Z)) {
-			    
-			NewControlPoints[i].Position += NewControlPoints[i].Velocity * DeltaTime;
-		} else {
-			NewControlPoints[i].Velocity.X = 0.0f;
-			NewControlPoints[i].Velocity.Y = 0.0f;
-			NewControlPoints[i].Velocity.Z = 0.0f;
-		}
+		// NaN fails every comparison, so this catches NaN and infinity.
+		VectorRegister FiniteMask = VectorBitwiseAnd(
+			VectorCompareGE(MaxFloat, VectorAbs(VelocityX)),
+			VectorBitwiseAnd(
+				VectorCompareGE(MaxFloat, VectorAbs(VelocityY)),
+				VectorCompareGE(MaxFloat, VectorAbs(VelocityZ))));
+		PositionX = VectorSelect(FiniteMask, VectorMultiplyAdd(VelocityX, DeltaTime, PositionX), PositionX);
+		PositionY = VectorSelect(FiniteMask, VectorMultiplyAdd(VelocityY, DeltaTime, PositionY), PositionY);
+		PositionZ = VectorSelect(FiniteMask, VectorMultiplyAdd(VelocityZ, DeltaTime, PositionZ), PositionZ);
+		VelocityX = VectorSelect(FiniteMask, VelocityX, Zero);
+		VelocityY = VectorSelect(FiniteMask, VelocityY, Zero);
+		VelocityZ = VectorSelect(FiniteMask, VelocityZ, Zero);
 
 		// Max distance clamp.
 		// --------------------------------------------------------------------
-		
-		float Distance = (NewControlPoints[i].Position - SkinnedRenderPoint.Position).Size();
-		float MaxDistance = In_ShellDistance * PrivateData->PhysicsParameters.MaxStretchDistanceMultiplier * SplineLength;
-		if (Distance > MaxDistance) {
-			FVector NewOffset = ((NewControlPoints[i].Position - SkinnedRenderPoint.Position) / Distance) * MaxDistance;
-			NewControlPoints[i].Position = SkinnedRenderPoint.Position + NewOffset;
+		if(bDistanceClamp) {
+			VectorRegister OffsetX = VectorSubtract(PositionX, RootX);
+			VectorRegister OffsetY = VectorSubtract(PositionY, RootY);
+			VectorRegister OffsetZ = VectorSubtract(PositionZ, RootZ);
+			VectorRegister Distance = NeoFurVectorSqrt(NeoFurVectorDot3(OffsetX, OffsetY, OffsetZ, OffsetX, OffsetY, OffsetZ));
+			VectorRegister MaxDistance = VectorMultiply(MaxDistanceScale, SplineLength);
+			VectorRegister DistanceMask = VectorCompareGT(Distance, MaxDistance);
+			VectorRegister DistanceScale = VectorDivide(MaxDistance, Distance);
+			PositionX = VectorSelect(DistanceMask, VectorMultiplyAdd(OffsetX, DistanceScale, RootX), PositionX);
+			PositionY = VectorSelect(DistanceMask, VectorMultiplyAdd(OffsetY, DistanceScale, RootY), PositionY);
+			PositionZ = VectorSelect(DistanceMask, VectorMultiplyAdd(OffsetZ, DistanceScale, RootZ), PositionZ);
 		}
 
 		// TODO: Min distance clamp.
@@ -283,88 +471,1185 @@ void FNeoFurComponentSceneProxy::RunSimulation_Renderthread_CPU(
 
 		// Max angle clamp.
 		// --------------------------------------------------------------------
+		// acos(dot(Dir, Offset/Length)) > MaxRotation is the same test as
+		// dot(Dir, Offset/Length) < cos(MaxRotation). The clamped offset
+		// stays in the plane of Dir and Offset, so it's just
+		// Dir * cos(MaxRotation) + PerpendicularDir * sin(MaxRotation),
+		// scaled back up to the original length. No rotation matrix needed.
+		if(bAngleClamp) {
+			VectorRegister OffsetX = VectorSubtract(PositionX, RootX);
+			VectorRegister OffsetY = VectorSubtract(PositionY, RootY);
+			VectorRegister OffsetZ = VectorSubtract(PositionZ, RootZ);
+			VectorRegister OffsetLength = NeoFurVectorSqrt(NeoFurVectorDot3(OffsetX, OffsetY, OffsetZ, OffsetX, OffsetY, OffsetZ));
+			VectorRegister OffsetDotDir = NeoFurVectorDot3(OffsetX, OffsetY, OffsetZ, DirX, DirY, DirZ);
+			VectorRegister AngleMask = VectorCompareGT(VectorMultiply(CosMaxRotation, OffsetLength), OffsetDotDir);
 
-		// FIXME: Wasting time by doing degree-to-radian conversion here.
-		float MaxRotation = PrivateData->PhysicsParameters.MaxRotationFromNormal * 3.14159/180.0;
-		FVector ControlPointOffset = (NewControlPoints[i].Position - SkinnedRenderPoint.Position);
-		FVector NormalizedTanZ = NormalizedSplineDir; //SkinnedRenderPoint.TanZ / SkinnedRenderPoint.TanZ.Size();
-		FVector NormalizedOffset = ControlPointOffset / ControlPointOffset.Size();
-		if(acos(FVector::DotProduct(NormalizedTanZ, NormalizedOffset)) > MaxRotation) {
-
-			// Make a rotation matrix that can bring us into a coordinate space
-			// defined by the normal, a unit length vector that is coplanar with
-			// the normal and offset while also perpendicular to the normal, and
-			// an axis perpendicular to both of those.
-			FVector axis0 = NormalizedTanZ;
-			FVector axis1 = FVector::CrossProduct(NormalizedOffset, axis0);
-			axis1.Normalize(); // FIXME: Maybe unneeded.
-			FVector axis2 = FVector::CrossProduct(axis0, axis1);
-
-			// FIXME: There's a better way to set this up.
-			FMatrix rotMat = FMatrix(axis0, axis1, axis2, FVector::ZeroVector);
-			rotMat.M[3][3] = 1.0f;
-			rotMat.M[0][3] = 0.0f;
-			rotMat.M[1][3] = 0.0f;
-			rotMat.M[2][3] = 0.0f;
-			rotMat.M[3][0] = 0.0f;
-			rotMat.M[3][1] = 0.0f;
-			rotMat.M[3][2] = 0.0f;
-			
-			// Convert to the local coordinate space.
-			FVector LocalControlPointOffset = rotMat.GetTransposed().TransformVector(ControlPointOffset);
-
-			// Do the acual clamping in the local coordinate space, where the
-			// rotation axes are a simple sin/cos (and y=0 to stay on the right
-			// plane).
-			float xSide = LocalControlPointOffset.Z < 0 ? -1.0f : 1.0f;
-			LocalControlPointOffset.X = cos(MaxRotation);
-			LocalControlPointOffset.Z = sin(MaxRotation) * xSide;
-			// y=0 plane is the plane that the origin, the skinned position, and
-			// the control point all exist on. We definitely want to stay there.
-			LocalControlPointOffset.Y = 0;
-
-			// Restore the length of the original offset.
-			LocalControlPointOffset.Normalize(); // FIXME: Maybe unneeded.
-			LocalControlPointOffset = LocalControlPointOffset * ControlPointOffset.Size();
-			
-			// Convert back to object space.
-			ControlPointOffset = rotMat.TransformVector(LocalControlPointOffset);
-			NewControlPoints[i].Position = ControlPointOffset + SkinnedRenderPoint.Position;
-		}
-
-		// Write control point for next frame.
-		// --------------------------------------------------------------------
+			VectorRegister PerpX = VectorSubtract(OffsetX, VectorMultiply(DirX, OffsetDotDir));
+			VectorRegister PerpY = VectorSubtract(OffsetY, VectorMultiply(DirY, OffsetDotDir));
+			VectorRegister PerpZ = VectorSubtract(OffsetZ, VectorMultiply(DirZ, OffsetDotDir));
+			VectorRegister PerpSizeSquared = NeoFurVectorDot3(PerpX, PerpY, PerpZ, PerpX, PerpY, PerpZ);
+			VectorRegister PerpScale = VectorSelect(
+				VectorCompareGT(PerpSizeSquared, SmallNumber),
+				VectorMultiply(NeoFurVectorReciprocalSqrt(PerpSizeSquared), SinMaxRotation), Zero);
+
+			VectorRegister DirScale = VectorMultiply(CosMaxRotation, OffsetLength);
+			PerpScale = VectorMultiply(PerpScale, OffsetLength);
+			PositionX = VectorSelect(AngleMask, VectorMultiplyAdd(PerpX, PerpScale, VectorMultiplyAdd(DirX, DirScale, RootX)), PositionX);
+			PositionY = VectorSelect(AngleMask, VectorMultiplyAdd(PerpY, PerpScale, VectorMultiplyAdd(DirY, DirScale, RootY)), PositionY);
+			PositionZ = VectorSelect(AngleMask, VectorMultiplyAdd(PerpZ, PerpScale, VectorMultiplyAdd(DirZ, DirScale, RootZ)), PositionZ);
+		}
+
+		VectorStoreAligned(PositionX, &State.PositionX[i]);
+		VectorStoreAligned(PositionY, &State.PositionY[i]);
+		VectorStoreAligned(PositionZ, &State.PositionZ[i]);
+		VectorStoreAligned(VelocityX, &State.VelocityX[i]);
+		VectorStoreAligned(VelocityY, &State.VelocityY[i]);
+		VectorStoreAligned(VelocityZ, &State.VelocityZ[i]);
+	}
+}
+
+// Bounds of the working set's positions in [StartIndex, EndIndex).
+static FBox NeoFurGetPositionBounds(const FNeoFurCPUSimState &State, int32 StartIndex, int32 EndIndex)
+{
+	FBox Bounds(ForceInit);
+	int32 SimdEndIndex = StartIndex + (EndIndex - StartIndex) / 4 * 4;
+	if(SimdEndIndex > StartIndex) {
+		VectorRegister MinX = VectorLoadAligned(&State.PositionX[StartIndex]);
+		VectorRegister MinY = VectorLoadAligned(&State.PositionY[StartIndex]);
+		VectorRegister MinZ = VectorLoadAligned(&State.PositionZ[StartIndex]);
+		VectorRegister MaxX = MinX, MaxY = MinY, MaxZ = MinZ;
+		for(int32 i = StartIndex + 4; i < SimdEndIndex; i += 4) {
+			VectorRegister X = VectorLoadAligned(&State.PositionX[i]);
+			VectorRegister Y = VectorLoadAligned(&State.PositionY[i]);
+			VectorRegister Z = VectorLoadAligned(&State.PositionZ[i]);
+			MinX = VectorMin(MinX, X); MaxX = VectorMax(MaxX, X);
+			MinY = VectorMin(MinY, Y); MaxY = VectorMax(MaxY, Y);
+			MinZ = VectorMin(MinZ, Z); MaxZ = VectorMax(MaxZ, Z);
+		}
+
+		MS_ALIGN(16) float Lanes[6][4] GCC_ALIGN(16);
+		VectorStoreAligned(MinX, Lanes[0]); VectorStoreAligned(MinY, Lanes[1]); VectorStoreAligned(MinZ, Lanes[2]);
+		VectorStoreAligned(MaxX, Lanes[3]); VectorStoreAligned(MaxY, Lanes[4]); VectorStoreAligned(MaxZ, Lanes[5]);
+		for(int32 Lane = 0; Lane < 4; Lane++) {
+			Bounds += FVector(Lanes[0][Lane], Lanes[1][Lane], Lanes[2][Lane]);
+			Bounds += FVector(Lanes[3][Lane], Lanes[4][Lane], Lanes[5][Lane]);
+		}
+	}
+
+	for(int32 i = SimdEndIndex; i < EndIndex; i++) {
+		Bounds += FVector(State.PositionX[i], State.PositionY[i], State.PositionZ[i]);
+	}
+	return Bounds;
+}
+
+// Push control points out of the collision shapes, four at a time, and
+// take away any velocity heading into them. Runs after the clamps, so
+// collision gets the last word. StartIndex and EndIndex must be
+// multiples of four. Shapes is the subset of the job's collision shapes
+// that can reach this range.
+static void NeoFurCollideControlPoints(
+	const FNeoFurCPUSimJob &Job, int32 StartIndex, int32 EndIndex,
+	const FNeoFurCollisionShape *const *Shapes, int32 NumShapes)
+{
+	FNeoFurCPUSimState &State = *Job.State;
+	const VectorRegister Zero = VectorZero();
+	const VectorRegister One = VectorOne();
+
+	for(int32 i = StartIndex; i < EndIndex; i += 4) {
 
-		NewControlPoints[i].RootPosition = SkinnedRenderPoint.Position;
-		NewControlPoints[i].SkinnedSplineDirection = SkinnedRenderPoint.CombedDirectionAndLength;
-		NewControlPoints[i].SkinnedNormal = SkinnedRenderPoint.TanZ.GetUnsafeNormal();
+		VectorRegister PositionX = VectorLoadAligned(&State.PositionX[i]);
+		VectorRegister PositionY = VectorLoadAligned(&State.PositionY[i]);
+		VectorRegister PositionZ = VectorLoadAligned(&State.PositionZ[i]);
+		VectorRegister VelocityX = VectorLoadAligned(&State.VelocityX[i]);
+		VectorRegister VelocityY = VectorLoadAligned(&State.VelocityY[i]);
+		VectorRegister VelocityZ = VectorLoadAligned(&State.VelocityZ[i]);
+
+		for(int32 k = 0; k < NumShapes; k++) {
+			const FNeoFurCollisionShape &Shape = *Shapes[k];
+			FVector Axis = Shape.End - Shape.Start;
+			VectorRegister StartX = VectorSetFloat1(Shape.Start.X);
+			VectorRegister StartY = VectorSetFloat1(Shape.Start.Y);
+			VectorRegister StartZ = VectorSetFloat1(Shape.Start.Z);
+			VectorRegister AxisX = VectorSetFloat1(Axis.X);
+			VectorRegister AxisY = VectorSetFloat1(Axis.Y);
+			VectorRegister AxisZ = VectorSetFloat1(Axis.Z);
+			VectorRegister Radius = VectorSetFloat1(Shape.Radius);
+
+			// Closest point on the capsule's segment. For a sphere the
+			// axis is zero, so this is always the center.
+			VectorRegister T = VectorMultiply(
+				NeoFurVectorDot3(
+					VectorSubtract(PositionX, StartX), VectorSubtract(PositionY, StartY), VectorSubtract(PositionZ, StartZ),
+					AxisX, AxisY, AxisZ),
+				VectorSetFloat1(1.0f / FMath::Max(Axis.SizeSquared(), SMALL_NUMBER)));
+			T = VectorMin(VectorMax(T, Zero), One);
+			VectorRegister ClosestX = VectorMultiplyAdd(AxisX, T, StartX);
+			VectorRegister ClosestY = VectorMultiplyAdd(AxisY, T, StartY);
+			VectorRegister ClosestZ = VectorMultiplyAdd(AxisZ, T, StartZ);
+
+			VectorRegister OffsetX = VectorSubtract(PositionX, ClosestX);
+			VectorRegister OffsetY = VectorSubtract(PositionY, ClosestY);
+			VectorRegister OffsetZ = VectorSubtract(PositionZ, ClosestZ);
+			VectorRegister DistanceSquared = NeoFurVectorDot3(OffsetX, OffsetY, OffsetZ, OffsetX, OffsetY, OffsetZ);
+
+			// A point sitting exactly on the segment has no direction to be
+			// pushed in, so it's left alone.
+			VectorRegister InsideMask = VectorBitwiseAnd(
+				VectorCompareGT(VectorMultiply(Radius, Radius), DistanceSquared),
+				VectorCompareGT(DistanceSquared, Zero));
+			VectorRegister InvDistance = NeoFurVectorReciprocalSqrt(DistanceSquared);
+			VectorRegister NormalX = VectorMultiply(OffsetX, InvDistance);
+			VectorRegister NormalY = VectorMultiply(OffsetY, InvDistance);
+			VectorRegister NormalZ = VectorMultiply(OffsetZ, InvDistance);
+
+			PositionX = VectorSelect(InsideMask, VectorMultiplyAdd(NormalX, Radius, ClosestX), PositionX);
+			PositionY = VectorSelect(InsideMask, VectorMultiplyAdd(NormalY, Radius, ClosestY), PositionY);
+			PositionZ = VectorSelect(InsideMask, VectorMultiplyAdd(NormalZ, Radius, ClosestZ), PositionZ);
+
+			VectorRegister InwardSpeed = VectorMin(NeoFurVectorDot3(VelocityX, VelocityY, VelocityZ, NormalX, NormalY, NormalZ), Zero);
+			VelocityX = VectorSelect(InsideMask, VectorSubtract(VelocityX, VectorMultiply(NormalX, InwardSpeed)), VelocityX);
+			VelocityY = VectorSelect(InsideMask, VectorSubtract(VelocityY, VectorMultiply(NormalY, InwardSpeed)), VelocityY);
+			VelocityZ = VectorSelect(InsideMask, VectorSubtract(VelocityZ, VectorMultiply(NormalZ, InwardSpeed)), VelocityZ);
+		}
+
+		VectorStoreAligned(PositionX, &State.PositionX[i]);
+		VectorStoreAligned(PositionY, &State.PositionY[i]);
+		VectorStoreAligned(PositionZ, &State.PositionZ[i]);
+		VectorStoreAligned(VelocityX, &State.VelocityX[i]);
+		VectorStoreAligned(VelocityY, &State.VelocityY[i]);
+		VectorStoreAligned(VelocityZ, &State.VelocityZ[i]);
+	}
+}
+
+// Convert from the SoA working set to the vertex buffer layout. Returns
+// the sum of the squared distances the control points moved since
+// OldControlPoints, for sleep detection, and their bounds.
+static float NeoFurRepackControlPoints(
+	const FNeoFurCPUSimState &State,
+	const FNeoFurComponentSceneProxy::ControlPointVertexType *OldControlPoints,
+	FNeoFurComponentSceneProxy::ControlPointVertexType *ControlPoints,
+	int32 StartIndex, int32 EndIndex,
+	FBox &OutBounds)
+{
+	float Motion = 0.0f;
+	OutBounds = FBox(ForceInit);
+	for(int32 i = StartIndex; i < EndIndex; i++) {
+		FNeoFurComponentSceneProxy::ControlPointVertexType &ControlPoint = ControlPoints[i];
+		ControlPoint.Position = FVector(State.PositionX[i], State.PositionY[i], State.PositionZ[i]);
+		ControlPoint.Velocity = FVector(State.VelocityX[i], State.VelocityY[i], State.VelocityZ[i]);
+		ControlPoint.RootPosition = FVector(State.RootX[i], State.RootY[i], State.RootZ[i]);
+		ControlPoint.SkinnedSplineDirection = FVector(State.SplineX[i], State.SplineY[i], State.SplineZ[i]);
+		ControlPoint.SkinnedNormal = FVector(State.NormalX[i], State.NormalY[i], State.NormalZ[i]);
+		Motion += (ControlPoint.Position - OldControlPoints[i].Position).SizeSquared();
+		OutBounds += ControlPoint.Position;
+	}
+	return Motion;
+}
+
+// Kernel selection. Every feature that can be switched off for a whole
+// frame is a template parameter, so the inner loops don't carry
+// branches or loads for features the component isn't using.
+
+static FNeoFurCPUSimJob::FPassFunction NeoFurSelectSkinPass(bool bSkeletal, bool bMorphs)
+{
+	static const FNeoFurCPUSimJob::FPassFunction Passes[2][2] = {
+		{ &NeoFurSkinControlPoints<false, false>, &NeoFurSkinControlPoints<false, true> },
+		{ &NeoFurSkinControlPoints<true,  false>, &NeoFurSkinControlPoints<true,  true> },
+	};
+	return Passes[bSkeletal][bMorphs];
+}
+
+static FNeoFurCPUSimJob::FIntegratePassFunction NeoFurSelectIntegratePass(
+	bool bForces, bool bWindGusts, bool bDistanceClamp, bool bAngleClamp)
+{
+	static const FNeoFurCPUSimJob::FIntegratePassFunction Passes[2][2][2][2] = {
+		{
+			{
+				{ &NeoFurIntegrateControlPoints<false, false, false, false>, &NeoFurIntegrateControlPoints<false, false, false, true> },
+				{ &NeoFurIntegrateControlPoints<false, false, true,  false>, &NeoFurIntegrateControlPoints<false, false, true,  true> },
+			},
+			{
+				{ &NeoFurIntegrateControlPoints<false, true,  false, false>, &NeoFurIntegrateControlPoints<false, true,  false, true> },
+				{ &NeoFurIntegrateControlPoints<false, true,  true,  false>, &NeoFurIntegrateControlPoints<false, true,  true,  true> },
+			},
+		},
+		{
+			{
+				{ &NeoFurIntegrateControlPoints<true,  false, false, false>, &NeoFurIntegrateControlPoints<true,  false, false, true> },
+				{ &NeoFurIntegrateControlPoints<true,  false, true,  false>, &NeoFurIntegrateControlPoints<true,  false, true,  true> },
+			},
+			{
+				{ &NeoFurIntegrateControlPoints<true,  true,  false, false>, &NeoFurIntegrateControlPoints<true,  true,  false, true> },
+				{ &NeoFurIntegrateControlPoints<true,  true,  true,  false>, &NeoFurIntegrateControlPoints<true,  true,  true,  true> },
+			},
+		},
+	};
+	return Passes[bForces][bWindGusts][bDistanceClamp][bAngleClamp];
+}
+
+// Pick the kernels for the job's step. Everything else in the job has to
+// be filled in first.
+static void NeoFurSelectPasses(FNeoFurCPUSimJob &Job)
+{
+	const FNeoFurPhysicsParameters &Physics = Job.PhysicsParameters;
+	const FNeoFurFramePhysicsInputs &Inputs = Job.PhysicsFrameInputs;
+
+	bool bSkeletal = Job.BoneMats != nullptr;
+	bool bMorphs = Job.MorphData != nullptr;
+
+	// Without bones or morphs the roots are just the static vertex
+	// data, so once that's in the working set there's nothing left
+	// to skin.
+	bool bRestPose = !bSkeletal && !bMorphs;
+	Job.SkinPass = (bRestPose && Job.State->bRestPoseRoots) ? nullptr : NeoFurSelectSkinPass(bSkeletal, bMorphs);
+	Job.State->bRestPoseRoots = bRestPose;
+
+	bool bForces = Job.NumForces > 0 && Physics.RadialForceInfluence != 0.0f;
+	bool bWindGusts = Inputs.WindGustsAmount != 0.0f && !Inputs.WindVector.IsZero();
+
+	// A stretch multiplier of zero turns the distance clamp off. The
+	// angle clamp can't trigger at 180 degrees, so that's off too.
+	bool bDistanceClamp = Physics.MaxStretchDistanceMultiplier > 0.0f;
+	bool bAngleClamp = Physics.MaxRotationFromNormal < 180.0f;
+
+	Job.IntegratePass = NeoFurSelectIntegratePass(bForces, bWindGusts, bDistanceClamp, bAngleClamp);
+}
+
+// Simulate control points [StartIndex, EndIndex). Runs on task-graph
+// worker threads, so this must only read from the job and only write
+// to its own range of the working set and Job.NewControlPoints.
+static void NeoFurSimulateControlPoints(const FNeoFurCPUSimJob &Job, int32 StartIndex, int32 EndIndex)
+{
+	FNeoFurSimulationTimeScope SimulationTime;
+
+	if(Job.SkinPass) {
+		Job.SkinPass(Job, StartIndex, EndIndex);
 	}
-	
-	// Update GPU-side control point vertex buffer.
+
+	int32 ChunkIndex = StartIndex / NEOFUR_CPU_SIM_CHUNK_SIZE;
+	FBox &ChunkBounds = Job.State->ChunkBounds[ChunkIndex];
+
+	// Only hand the kernel the forces that can reach this chunk. The
+	// velocity fudge is the only thing that moves the control points
+	// between the end of the last step and the forces, so moving last
+	// step's bounds the same way covers them.
+	FBox Bounds = ChunkBounds.IsValid ? ChunkBounds.TransformBy(Job.VelocityTransform) : ChunkBounds;
+	TArray<const FNeoFurForceField *, TInlineAllocator<16>> ChunkForces;
+	for(int32 i = 0; i < Job.NumForces; i++) {
+		const FNeoFurForceField &Force = Job.Forces[i];
+		if(!Bounds.IsValid || FMath::SphereAABBIntersection(Force.Origin, FMath::Square(Force.Radius), Bounds)) {
+			ChunkForces.Add(&Force);
+		}
+	}
+
+	// The last chunk also picks up the padding lanes.
+	int32 SimdEndIndex = EndIndex == Job.NumControlPoints ? Align(EndIndex, 4) : EndIndex;
+	Job.IntegratePass(Job, StartIndex, SimdEndIndex, ChunkForces.GetData(), ChunkForces.Num());
+
+	// Same for collision, against where the control points ended up
+	// after integrating.
+	if(Job.NumCollisionShapes) {
+		TArray<const FNeoFurCollisionShape *, TInlineAllocator<NEOFUR_MAX_COLLISION_SHAPES>> ChunkShapes;
+		FBox CollisionBounds = NeoFurGetPositionBounds(*Job.State, StartIndex, EndIndex);
+		for(int32 i = 0; i < Job.NumCollisionShapes; i++) {
+			const FNeoFurCollisionShape &Shape = Job.CollisionShapes[i];
+			if(CollisionBounds.Intersect(Shape.GetBox())) {
+				ChunkShapes.Add(&Shape);
+			}
+		}
+		if(ChunkShapes.Num()) {
+			NeoFurCollideControlPoints(Job, StartIndex, SimdEndIndex, ChunkShapes.GetData(), ChunkShapes.Num());
+		}
+	}
+
+	// Repacking here instead of in the upload keeps the render thread's
+	// share of the work down to one memcpy of the control points.
+	Job.ChunkMotion[ChunkIndex] = NeoFurRepackControlPoints(
+		*Job.State, Job.OldControlPoints, Job.NewControlPoints, StartIndex, EndIndex, ChunkBounds);
+}
+
+// Compares everything that can push the fur around against what the
+// last step ran with, and records this step's values for next time.
+// Returns true if anything changed.
+static bool NeoFurUpdateSleepInputs(
+	FNeoFurCPUSimState &State,
+	const FNeoFurCPUSimJob &Job,
+	const FNeoFurComponentSceneProxy::SimulationParamsType &Params)
+{
+	bool bChanged = false;
+
+	// Moving the component at all, or any force hitting it this step.
+	if(!Job.RelativeTransformSinceLastFrame.Equals(FTransform::Identity) ||
+		Job.NumForces > 0)
+	{
+		bChanged = true;
+	}
+
+	if(Job.PhysicsFrameInputs.WindVector != State.LastWindVector ||
+		Job.PhysicsFrameInputs.WindGustsAmount != State.LastWindGustsAmount ||
+		Job.LocalSpaceGravity != State.LastGravity ||
+		Job.ShellDistance != State.LastShellDistance ||
+		FMemory::Memcmp(&Job.PhysicsParameters, &State.LastPhysicsParameters, sizeof(FNeoFurPhysicsParameters)))
+	{
+		bChanged = true;
+		State.LastWindVector = Job.PhysicsFrameInputs.WindVector;
+		State.LastWindGustsAmount = Job.PhysicsFrameInputs.WindGustsAmount;
+		State.LastGravity = Job.LocalSpaceGravity;
+		State.LastShellDistance = Job.ShellDistance;
+		State.LastPhysicsParameters = Job.PhysicsParameters;
+	}
+
+	// Bones and morphs. The arrays only grow on the first step, or when
+	// morph targets turn on, so copying doesn't touch the heap after that.
+	if(Params.BoneMats.Num() != State.LastBoneMats.Num() ||
+		FMemory::Memcmp(Params.BoneMats.GetData(), State.LastBoneMats.GetData(), Params.BoneMats.Num() * Params.BoneMats.GetTypeSize()))
+	{
+		bChanged = true;
+		State.LastBoneMats = Params.BoneMats;
+	}
+
+	// Collision shapes can move without any of our own bones moving, like
+	// an arm swinging into fur on the chest.
+	if(Params.CollisionShapes.Num() != State.LastCollisionShapes.Num() ||
+		FMemory::Memcmp(Params.CollisionShapes.GetData(), State.LastCollisionShapes.GetData(), Params.CollisionShapes.Num() * Params.CollisionShapes.GetTypeSize()))
+	{
+		bChanged = true;
+		State.LastCollisionShapes = Params.CollisionShapes;
+	}
+
+	if(Params.MorphData.Num() != State.LastMorphData.Num() ||
+		FMemory::Memcmp(Params.MorphData.GetData(), State.LastMorphData.GetData(), Params.MorphData.Num() * Params.MorphData.GetTypeSize()))
+	{
+		bChanged = true;
+		State.LastMorphData = Params.MorphData;
+	}
+
+	return bChanged;
+}
+
+
+void FNeoFurComponentSceneProxy::RunSimulation_Renderthread_CPU(SimulationParamsType *Params, bool bApplyForces)
+{
+	check(IsInRenderingThread());
+	check(!ShouldUseGPUShader());
+
+	FNeoFurCPUSimJob &Job = PrivateData->CPUSimJob;
+
+	// When catching up, there's more than one step per parameter block.
+	// The block can't be released until the last one.
+	if(Job.Params == Params) {
+		Job.Params = nullptr;
+	}
+
+	// Normally last frame's jobs were already picked up when we drew,
+	// but if we weren't drawn (offscreen, hidden) they're still here.
+	FinishSimulation_Renderthread_CPU();
+
+	// The job holds on to the parameter block from here on, even if we
+	// skip the simulation. It gets released when the job is finished.
+	Job.Params = Params;
+	Job.MorphData = Params->MorphData.Num() ? Params->MorphData.GetData() : nullptr;
+
+	if(PrivateData->bSkipSimulation) return;
+
+	// Only from here on, so waiting for last frame's tasks above doesn't
+	// count them twice.
+	FNeoFurSimulationTimeScope SimulationTime;
+
+	int32 NumControlPoints = PrivateData->ControlPointVertexBuffers_CPU[PrivateData->ControlPointVertexBufferFrame].Num();
+	if(!NumControlPoints) return;
+
+	Job.RelativeTransformSinceLastFrame = Params->RelativeTransformSinceLastFrame;
+	Job.DeltaTime = Params->DeltaTime;
+	Job.LocalSpaceGravity = Params->LocalSpaceGravity;
+	Job.PhysicsParameters = PrivateData->PhysicsParameters;
+	Job.PhysicsFrameInputs = PrivateData->PhysicsFrameInputs;
+	Job.ShellDistance = PrivateData->ShellDistance;
+	Job.Forces = Params->Forces.GetData();
+	Job.NumForces = bApplyForces ? Params->Forces.Num() : 0;
+	Job.CollisionShapes = Params->CollisionShapes.GetData();
+	Job.NumCollisionShapes = Params->CollisionShapes.Num();
+
+	// The velocity "fudge" blends between the old position and the old
+	// position moved by the relative transform. Both ends are linear in
+	// the position, so we can blend the matrices once instead of blending
+	// every point.
+	Job.VelocityTransform = Job.RelativeTransformSinceLastFrame.ToMatrixWithScale() * Job.PhysicsParameters.VelocityInfluence;
+	Job.VelocityTransform += FMatrix::Identity * (1.0f - Job.PhysicsParameters.VelocityInfluence);
+
+	// The simulation state lives in the SoA working set from the first
+	// frame on. The AoS control point arrays are just the seed and the
+	// staging area for the upload after that.
+	if(PrivateData->CPUSimState.NumControlPoints != NumControlPoints) {
+		NeoFurInitCPUSimState(
+			PrivateData->CPUSimState,
+			PrivateData->ControlPointVertexBuffers_CPU[PrivateData->ControlPointVertexBufferFrame]);
+	}
+
+	// Settled fur with nothing new acting on it would just come out the
+	// same again, so skip the step and the upload. The last two steps
+	// stay in the GPU buffers, and those are close enough to each other
+	// that interpolating between them doesn't show.
+	if(NeoFurUpdateSleepInputs(PrivateData->CPUSimState, Job, *Params)) {
+		PrivateData->CPUSimState.SettledSteps = 0;
+	} else if(PrivateData->CPUSimState.SettledSteps >= NEOFUR_SLEEP_SETTLE_STEPS) {
+		return;
+	}
+
+	Job.StaticVerts = PrivateData->AssetResources->StaticVertexData_CPU.GetData();
+	Job.State = &PrivateData->CPUSimState;
+	Job.OldControlPoints = PrivateData->ControlPointVertexBuffers_CPU[PrivateData->ControlPointVertexBufferFrame].GetData();
+	Job.NewControlPoints = PrivateData->ControlPointVertexBuffers_CPU[!PrivateData->ControlPointVertexBufferFrame].GetData();
+	Job.NumControlPoints = NumControlPoints;
+
+	// Expand the bone palette into storage that lives as long as the
+	// proxy. This only allocates on the first frame. The palette is
+	// usually a handful of bones, so expanding to full matrices here is
+	// cheaper than doing 3x4 math per point. The palette size was fixed
+	// when the buffers were generated, and anything past what the
+	// component sent us gets filled in with identity.
+	int32 NumBoneMats = Params->BoneMats.Num();
+	if(NumBoneMats) {
+		Job.BoneMatsStorage.SetNumUninitialized(PrivateData->NumBoneMats, false);
+		for(int32 i = 0; i < PrivateData->NumBoneMats; i++) {
+			Job.BoneMatsStorage[i] = i < NumBoneMats ? Params->BoneMats[i].ToMatrix() : FMatrix::Identity;
+		}
+		Job.BoneMats = Job.BoneMatsStorage.GetData();
+	} else {
+		Job.BoneMats = nullptr;
+	}
+
+	// Pick the kernels for this frame.
+	NeoFurSelectPasses(Job);
+
+	// Split the control points into chunks and hand them to the task
+	// graph. Every chunk writes to its own range of the working set, so
+	// they don't need to synchronize with each other.
+	int32 NumChunks = FMath::DivideAndRoundUp(NumControlPoints, NEOFUR_CPU_SIM_CHUNK_SIZE);
+	Job.Tasks.Reset(NumChunks);
+	Job.ChunkMotionStorage.SetNumUninitialized(NumChunks, false);
+	Job.ChunkMotion = Job.ChunkMotionStorage.GetData();
+
+	const FNeoFurCPUSimJob *JobPtr = &Job;
+	for(int32 ChunkIndex = 0; ChunkIndex < NumChunks; ChunkIndex++) {
+		int32 StartIndex = ChunkIndex * NEOFUR_CPU_SIM_CHUNK_SIZE;
+		int32 EndIndex = FMath::Min(StartIndex + NEOFUR_CPU_SIM_CHUNK_SIZE, NumControlPoints);
+		Job.Tasks.Add(FFunctionGraphTask::CreateAndDispatchWhenReady(
+			[JobPtr, StartIndex, EndIndex]()
+			{
+				NeoFurSimulateControlPoints(*JobPtr, StartIndex, EndIndex);
+			},
+			TStatId(), nullptr, ENamedThreads::AnyThread));
+	}
+
+	Job.bPendingUpload = true;
+}
+
+void FNeoFurComponentSceneProxy::FinishSimulation_Renderthread_CPU() const
+{
+	check(IsInRenderingThread());
+
+	FNeoFurCPUSimJob &Job = PrivateData->CPUSimJob;
+
+	if(Job.Tasks.Num()) {
+		FTaskGraphInterface::Get().WaitUntilTasksComplete(Job.Tasks, ENamedThreads::RenderThread_Local);
+		Job.Tasks.Reset();
+	}
+
+	Job.MorphData = nullptr;
+	if(Job.Params) {
+		Job.Params->bInUse = false;
+		Job.Params = nullptr;
+	}
+
+	if(!Job.bPendingUpload) return;
+	Job.bPendingUpload = false;
+
+	FNeoFurSimulationTimeScope SimulationTime;
+
+	int32 NumControlPoints = Job.NumControlPoints;
+
+	// Sleep detection. Compare the average squared speed against the
+	// threshold, which is proportional to the kinetic energy.
+	{
+		float Motion = 0.0f;
+		for(int32 i = 0; i < Job.ChunkMotionStorage.Num(); i++) {
+			Motion += Job.ChunkMotionStorage[i];
+		}
+		float MeanSquaredSpeed = Motion / (float(NumControlPoints) * Job.DeltaTime * Job.DeltaTime);
+
+		FNeoFurCPUSimState &State = PrivateData->CPUSimState;
+		if(MeanSquaredSpeed < NEOFUR_SLEEP_SPEED_THRESHOLD * NEOFUR_SLEEP_SPEED_THRESHOLD) {
+			State.SettledSteps++;
+		} else {
+			State.SettledSteps = 0;
+		}
+	}
+
+	// Update GPU-side control point vertex buffer. This is the only part
+	// of the CPU simulation that has to happen on the render thread.
+	// Every shell reads the same control points, so there's one copy.
 	ControlPointVertexType *GPUControlPoints = (ControlPointVertexType *)RHILockVertexBuffer(
         PrivateData->ControlPointVertexBuffers_GPU[PrivateData->ControlPointVertexBufferFrame].VertexBufferRHI, 0,
         PrivateData->ControlPointVertexBuffers_GPU[PrivateData->ControlPointVertexBufferFrame].VertexBufferRHI->GetSize(),
 		RLM_WriteOnly);
-	for(int32 i = 0; i < In_ShellCount; i++) {
-		memcpy(
-			GPUControlPoints + (i * NumControlPoints),
-			&NewControlPoints[0],
-			sizeof(ControlPointVertexType) * NumControlPoints);
-	}
+	memcpy(GPUControlPoints, Job.NewControlPoints, sizeof(ControlPointVertexType) * NumControlPoints);
 	RHIUnlockVertexBuffer(
 		PrivateData->ControlPointVertexBuffers_GPU[PrivateData->ControlPointVertexBufferFrame].VertexBufferRHI);
 
-	// Record active shell count so we don't render something with
-	// more shells than whatever was simulated. (This buffer will be
-	// used next frame for motion blur.)
-	PrivateData->LastSimulatedActiveShellCount[PrivateData->ControlPointVertexBufferFrame] = In_ShellCount;
-	
 	// Switch buffers for next frame.
 	PrivateData->ControlPointVertexBufferFrame = !PrivateData->ControlPointVertexBufferFrame;
 }
 
+#if WITH_DEV_AUTOMATION_TESTS
+
+// ---------------------------------------------------------------------------
+// Tests
+// ---------------------------------------------------------------------------
+
+// One control point's root through NeoFurSkinControlPoints() the way the
+// CPU simulation did it before the SIMD kernel, with FMatrix transforms.
+// BoneMats and MorphData are null when the mesh has no bones or morphs.
+static void NeoFurReferenceSkinControlPoint(
+	const FNeoFurComponentSceneProxy::VertexType_Static &StaticVert,
+	const FMatrix *BoneMats,
+	const FNeoFurComponentSceneProxy::MorphDataVertexType *MorphData,
+	FVector &RootPosition, FVector &SplineDirection, FVector &Normal)
+{
+	FVector Position = StaticVert.Position;
+	FVector TanZ = StaticVert.TanZ;
+	FVector SplineDir = StaticVert.CombedDirectionAndLength;
+
+	if(MorphData) {
+		Position += MorphData->Offset;
+		TanZ += MorphData->Normal;
+	}
+
+	if(BoneMats) {
+		FVector FinalPosition(0.0f, 0.0f, 0.0f);
+		FVector FinalTanZ(0.0f, 0.0f, 0.0f);
+		FVector FinalSplineDir(0.0f, 0.0f, 0.0f);
+		float TotalInfluence = 0.0f;
+
+		for(int32 j = 0; j < ARRAY_COUNT(StaticVert.InfluenceBones); j++) {
+			if(StaticVert.InfluenceWeights[j]) {
+				float ThisWeight = float(StaticVert.InfluenceWeights[j]) / 255.0f;
+				const FMatrix &BoneMat = BoneMats[StaticVert.InfluenceBones[j]];
+				FinalPosition += BoneMat.TransformPosition(Position) * ThisWeight;
+				FinalTanZ += BoneMat.TransformVector(TanZ) * ThisWeight;
+				FinalSplineDir += BoneMat.TransformVector(SplineDir) * ThisWeight;
+				TotalInfluence += ThisWeight;
+			}
+		}
+
+		if(TotalInfluence) {
+			Position = FinalPosition / TotalInfluence;
+			TanZ = FinalTanZ / TotalInfluence;
+			SplineDir = FinalSplineDir / TotalInfluence;
+		}
+	}
+
+	RootPosition = Position;
+	SplineDirection = SplineDir;
+	Normal = TanZ.GetUnsafeNormal();
+}
+
+// One control point through NeoFurIntegrateControlPoints() the way the CPU
+// simulation did it before the SIMD kernel: FVector math, the C library
+// acos() and a rotation matrix for the angle clamp. Features that are
+// switched off in the parameters drop out on their own. Returns true if
+// the angle clamp moved the point.
+static bool NeoFurReferenceIntegrateControlPoint(
+	const FNeoFurCPUSimJob &Job,
+	const FNeoFurForceField *Forces, int32 NumForces,
+	const FVector &RootPosition, const FVector &SplineDirection,
+	FVector &Position, FVector &Velocity)
+{
+	const FNeoFurPhysicsParameters &Params = Job.PhysicsParameters;
+	const FNeoFurFramePhysicsInputs &Inputs = Job.PhysicsFrameInputs;
+	float DeltaTime = Job.DeltaTime;
+
+	float SplineLength = SplineDirection.Size();
+	FVector NormalizedSplineDir = SplineDirection / SplineLength;
+
+	// Velocity as a result of the different transform.
+	float VelocityAlpha = Params.VelocityInfluence;
+	Position =
+		VelocityAlpha * Job.RelativeTransformSinceLastFrame.TransformPosition(Position) +
+		(1.0f - VelocityAlpha) * Position;
 
+	// Spring simulation.
+	{
+		FVector TotalSpringForce(0.0f, 0.0f, 0.0f);
+		FVector SpringVector = Position - RootPosition;
+		float SpringLength = SpringVector.Size();
 
+		if(SpringLength > 0.01f) {
 
+			// Linear spring.
+			float SpringRestLength = Job.ShellDistance * SplineLength;
+			float SpringForce = Params.SpringLengthStiffness * (SpringRestLength - SpringLength);
+			TotalSpringForce += (SpringVector / SpringLength) * SpringForce;
 
+			// Torsion spring.
+			float dp = FVector::DotProduct(SpringVector / SpringLength, NormalizedSplineDir);
+			float AngleOffset = 0.0f;
+			if(dp < 1.0f) {
+				AngleOffset = acosf(FMath::Max(dp, -1.0f));
+			}
+			if(AngleOffset) {
+				FVector SkinnedPositionTarget = RootPosition + NormalizedSplineDir * SpringRestLength;
+				FVector AngleSpringReturnForceDirection = SkinnedPositionTarget - Position;
+				AngleSpringReturnForceDirection.Normalize();
+				FVector FinalReturnVelocity = AngleSpringReturnForceDirection * DeltaTime * Params.SpringAngleStiffness * AngleOffset;
+
+				// Clamp to maximum required velocity to get to rest position this frame.
+				if((Position - SkinnedPositionTarget).SizeSquared() < (FinalReturnVelocity * DeltaTime).SizeSquared()) {
+					FinalReturnVelocity = (SkinnedPositionTarget - Position) / DeltaTime;
+				}
+
+				TotalSpringForce += FinalReturnVelocity / DeltaTime;
+			}
+		}
+
+		Velocity += TotalSpringForce * DeltaTime * Params.SpringDampeningMultiplier;
+	}
+
+	// Gravity.
+	Velocity += Params.GravityInfluence * Job.LocalSpaceGravity * DeltaTime;
+
+	// Force effects.
+	for(int32 k = 0; k < NumForces; k++) {
+		const FNeoFurForceField &Force = Forces[k];
+		FVector Offset = Position - Force.Origin;
+		float Distance = Offset.Size();
+		float Scale = 1.0f - Distance / Force.Radius;
+		if(Distance && Scale > 0.0f) {
+			FVector ForceDirection = (Offset * Force.RadialScale + FVector::CrossProduct(Force.Axis, Offset)) / Distance + Force.Direction;
+			Velocity += ForceDirection * Force.Strength * Scale * Params.RadialForceInfluence;
+		}
+	}
+
+	// Air resistance.
+	Velocity *= Params.AirResistanceMultiplier;
+
+	// Wind.
+	FVector WindVector = Inputs.WindVector * DeltaTime;
+	Velocity += WindVector;
+	Velocity += WindVector * sinf(FVector::DotProduct(Position, WindVector)) * Inputs.WindGustsAmount;
+
+	// Apply the velocity.
+	if(!Velocity.ContainsNaN()) {
+		Position += Velocity * DeltaTime;
+	} else {
+		Velocity = FVector::ZeroVector;
+	}
+
+	// Max distance clamp.
+	float Distance = (Position - RootPosition).Size();
+	float MaxDistance = Job.ShellDistance * Params.MaxStretchDistanceMultiplier * SplineLength;
+	if(Params.MaxStretchDistanceMultiplier > 0.0f && Distance > MaxDistance) {
+		Position = RootPosition + ((Position - RootPosition) / Distance) * MaxDistance;
+	}
+
+	// Max angle clamp, in the space of the spline direction, the part of
+	// the offset perpendicular to it, and the axis perpendicular to both.
+	float MaxRotation = Params.MaxRotationFromNormal * 3.14159f / 180.0f;
+	FVector ControlPointOffset = Position - RootPosition;
+	FVector NormalizedOffset = ControlPointOffset / ControlPointOffset.Size();
+	if(acosf(FMath::Clamp(FVector::DotProduct(NormalizedSplineDir, NormalizedOffset), -1.0f, 1.0f)) <= MaxRotation) {
+		return false;
+	}
+
+	FVector Axis0 = NormalizedSplineDir;
+	FVector Axis1 = FVector::CrossProduct(NormalizedOffset, Axis0);
+	Axis1.Normalize();
+	FVector Axis2 = FVector::CrossProduct(Axis0, Axis1);
+	FMatrix RotMat(Axis0, Axis1, Axis2, FVector::ZeroVector);
+
+	FVector LocalControlPointOffset = RotMat.GetTransposed().TransformVector(ControlPointOffset);
+	float Side = LocalControlPointOffset.Z < 0.0f ? -1.0f : 1.0f;
+	LocalControlPointOffset = FVector(cosf(MaxRotation), 0.0f, sinf(MaxRotation) * Side) * ControlPointOffset.Size();
+	Position = RootPosition + RotMat.TransformVector(LocalControlPointOffset);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(
+	FNeoFurCPUSimKernelMatchesReferenceTest,
+	"NeoFur.CPUSim.KernelMatchesReference",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FNeoFurCPUSimKernelMatchesReferenceTest::RunTest(const FString &Parameters)
+{
+	// Two chunks, and the last one isn't a multiple of four, so it has
+	// padding lanes.
+	const int32 NumControlPoints = NEOFUR_CPU_SIM_CHUNK_SIZE + 61;
+	const int32 NumChunks = FMath::DivideAndRoundUp(NumControlPoints, NEOFUR_CPU_SIM_CHUNK_SIZE);
+	const int32 NumSteps = 60;
+	const int32 NumBones = 4;
+
+	// The acos() approximation is good to about 7e-5 radians, and the
+	// torsion spring feeds that back in every step. The difference
+	// settles well under this once the fur comes to rest. Forces can push
+	// unclamped fur well past its rest length, and the difference grows
+	// with it, so these are relative to how far the control point is from
+	// its root and how fast it's going. Anything under a unit, or a unit
+	// per second, counts as one.
+	const float MaxAllowedPositionError = 2e-3f;
+	const float MaxAllowedVelocityError = 1e-2f;
+
+	// Skinning is the same math in a different order.
+	const float MaxAllowedSkinningError = 1e-4f;
+
+	const FNeoFurForceField Forces[] = {
+		FNeoFurForceField::Radial(FVector(0.0f, 0.0f, 5.0f), 15.0f, 200.0f),
+		FNeoFurForceField::Directional(FVector(5.0f, 0.0f, 0.0f), 10.0f, FVector(0.0f, 1.0f, 0.0f), 150.0f),
+		FNeoFurForceField::Vortex(FVector(-5.0f, 0.0f, 0.0f), 10.0f, FVector(0.0f, 0.0f, 1.0f), 300.0f),
+	};
+
+	// Every combination of the integrate pass switches, with the skin
+	// pass switches cycling through theirs alongside. Each switch is
+	// turned off through the parameters, the same way a component would,
+	// so this also checks that the kernel selection agrees.
+	for(int32 Scenario = 0; Scenario < 16; Scenario++) {
+
+		bool bSkeletal      = (Scenario & 1) != 0;
+		bool bMorphs        = (Scenario & 2) == 0;
+		bool bForces        = (Scenario & 1) == 0;
+		bool bWindGusts     = (Scenario & 2) != 0;
+		bool bDistanceClamp = (Scenario & 4) == 0;
+		bool bAngleClamp    = (Scenario & 8) == 0;
+		FString ScenarioName = FString::Printf(
+			TEXT("Skeletal %d, morphs %d, forces %d, wind gusts %d, distance clamp %d, angle clamp %d"),
+			bSkeletal, bMorphs, bForces, bWindGusts, bDistanceClamp, bAngleClamp);
+
+		FRandomStream Random(0x53494D44 + Scenario);
+
+		FNeoFurCPUSimJob Job;
+		Job.RelativeTransformSinceLastFrame = FTransform(FRotator(1.0f, 3.0f, -2.0f), FVector(0.5f, -0.25f, 0.1f));
+		Job.DeltaTime = 1.0f / float(NEOFUR_SIMULATION_STEP_RATE);
+		Job.LocalSpaceGravity = FVector(0.0f, 0.0f, -980.0f);
+		Job.ShellDistance = 2.0f;
+		Job.PhysicsParameters.VelocityInfluence = 0.5f;
+		Job.PhysicsParameters.MaxStretchDistanceMultiplier = bDistanceClamp ? 1.5f : 0.0f;
+		Job.PhysicsParameters.MaxRotationFromNormal = bAngleClamp ? 30.0f : 180.0f;
+		Job.PhysicsFrameInputs.WindVector = FVector(40.0f, 15.0f, 0.0f);
+		Job.PhysicsFrameInputs.WindGustsAmount = bWindGusts ? 0.5f : 0.0f;
+		Job.VelocityTransform = Job.RelativeTransformSinceLastFrame.ToMatrixWithScale() * Job.PhysicsParameters.VelocityInfluence;
+		Job.VelocityTransform += FMatrix::Identity * (1.0f - Job.PhysicsParameters.VelocityInfluence);
+		Job.Forces = bForces ? Forces : nullptr;
+		Job.NumForces = bForces ? ARRAY_COUNT(Forces) : 0;
+
+		// A growth mesh with up to four bones per vertex, some of them
+		// unweighted, and morph deltas on every vertex.
+		TArray<FNeoFurComponentSceneProxy::VertexType_Static> StaticVerts;
+		TArray<FNeoFurComponentSceneProxy::MorphDataVertexType> MorphData;
+		StaticVerts.SetNumZeroed(NumControlPoints);
+		MorphData.SetNumZeroed(NumControlPoints);
+		for(int32 i = 0; i < NumControlPoints; i++) {
+			FNeoFurComponentSceneProxy::VertexType_Static &StaticVert = StaticVerts[i];
+			StaticVert.Position = FVector(Random.FRandRange(-10.0f, 10.0f), Random.FRandRange(-10.0f, 10.0f), Random.FRandRange(0.0f, 10.0f));
+			StaticVert.TanZ = Random.GetUnitVector();
+			StaticVert.CombedDirectionAndLength = Random.GetUnitVector() * Random.FRandRange(0.5f, 2.0f);
+			for(int32 j = 0; j < ARRAY_COUNT(StaticVert.InfluenceBones); j++) {
+				StaticVert.InfluenceBones[j] = uint16(Random.RandRange(0, NumBones - 1));
+				bool bWeighted = j == 0 || Random.FRand() < 0.5f;
+				StaticVert.InfluenceWeights[j] = uint8(bWeighted ? Random.RandRange(1, 255) : 0);
+			}
+			MorphData[i].Offset = Random.GetUnitVector() * Random.FRandRange(0.0f, 0.5f);
+			MorphData[i].Normal = Random.GetUnitVector() * Random.FRandRange(0.0f, 0.25f);
+		}
+
+		FRotator BoneRotations[NumBones];
+		FVector BoneTranslations[NumBones];
+		for(int32 b = 0; b < NumBones; b++) {
+			BoneRotations[b] = FRotator(Random.FRandRange(-20.0f, 20.0f), Random.FRandRange(-20.0f, 20.0f), Random.FRandRange(-20.0f, 20.0f));
+			BoneTranslations[b] = FVector(Random.FRandRange(-2.0f, 2.0f), Random.FRandRange(-2.0f, 2.0f), Random.FRandRange(-2.0f, 2.0f));
+		}
+
+		// Start every control point somewhere off its rest position, some
+		// of them far enough off that the clamps have something to do.
+		TArray<FNeoFurComponentSceneProxy::ControlPointVertexType> ControlPoints[2];
+		ControlPoints[0].SetNumZeroed(NumControlPoints);
+		ControlPoints[1].SetNumZeroed(NumControlPoints);
+		for(int32 i = 0; i < NumControlPoints; i++) {
+			ControlPoints[0][i].Position =
+				StaticVerts[i].Position + StaticVerts[i].CombedDirectionAndLength * Job.ShellDistance +
+				Random.GetUnitVector() * Random.FRandRange(0.0f, 2.0f);
+			ControlPoints[0][i].Velocity = Random.GetUnitVector() * Random.FRandRange(0.0f, 20.0f);
+		}
+		int32 Frame = 0;
+
+		TArray<FVector> Positions;
+		TArray<FVector> Velocities;
+		Positions.SetNumUninitialized(NumControlPoints);
+		Velocities.SetNumUninitialized(NumControlPoints);
+		for(int32 i = 0; i < NumControlPoints; i++) {
+			Positions[i] = ControlPoints[0][i].Position;
+			Velocities[i] = ControlPoints[0][i].Velocity;
+		}
+
+		FNeoFurCPUSimState State;
+		NeoFurInitCPUSimState(State, ControlPoints[0]);
+		Job.StaticVerts = StaticVerts.GetData();
+		Job.State = &State;
+		Job.NumControlPoints = NumControlPoints;
+		Job.ChunkMotionStorage.SetNumZeroed(NumChunks);
+		Job.ChunkMotion = Job.ChunkMotionStorage.GetData();
+		Job.MorphData = bMorphs ? MorphData.GetData() : nullptr;
+		Job.BoneMats = nullptr;
+
+		float MaxPositionError = 0.0f;
+		float MaxVelocityError = 0.0f;
+		float MaxSkinningError = 0.0f;
+		int32 NumAngleClamped = 0;
+
+		for(int32 Step = 0; Step < NumSteps; Step++) {
+
+			// The bones move every step, and go through the uploaded
+			// palette layout on the way in, same as the component's.
+			FMatrix BoneMats[NumBones];
+			if(bSkeletal) {
+				Job.BoneMatsStorage.SetNumUninitialized(NumBones);
+				for(int32 b = 0; b < NumBones; b++) {
+					FRotator Rotation = BoneRotations[b] + FRotator(0.0f, float(Step * (b + 1)), 0.0f);
+					BoneMats[b] = FTransform(Rotation, BoneTranslations[b]).ToMatrixWithScale();
+					FNeoFurComponentSceneProxy::BoneMatrixType PaletteEntry;
+					PaletteEntry.SetMatrix(BoneMats[b]);
+					Job.BoneMatsStorage[b] = PaletteEntry.ToMatrix();
+				}
+				Job.BoneMats = Job.BoneMatsStorage.GetData();
+			}
+
+			Job.OldControlPoints = ControlPoints[Frame].GetData();
+			Job.NewControlPoints = ControlPoints[!Frame].GetData();
+			NeoFurSelectPasses(Job);
+			if(Job.IntegratePass != NeoFurSelectIntegratePass(bForces, bWindGusts, bDistanceClamp, bAngleClamp)) {
+				AddError(FString::Printf(TEXT("%s: the parameters picked the wrong kernel."), *ScenarioName));
+				break;
+			}
+
+			for(int32 StartIndex = 0; StartIndex < NumControlPoints; StartIndex += NEOFUR_CPU_SIM_CHUNK_SIZE) {
+				NeoFurSimulateControlPoints(Job, StartIndex, FMath::Min(StartIndex + NEOFUR_CPU_SIM_CHUNK_SIZE, NumControlPoints));
+			}
+			Frame = !Frame;
+
+			for(int32 i = 0; i < NumControlPoints; i++) {
+				FVector RootPosition;
+				FVector SplineDirection;
+				FVector Normal;
+				NeoFurReferenceSkinControlPoint(
+					StaticVerts[i], bSkeletal ? BoneMats : nullptr, bMorphs ? &MorphData[i] : nullptr,
+					RootPosition, SplineDirection, Normal);
+				if(NeoFurReferenceIntegrateControlPoint(
+					Job, Job.Forces, Job.NumForces, RootPosition, SplineDirection, Positions[i], Velocities[i]))
+				{
+					NumAngleClamped++;
+				}
+
+				const FNeoFurComponentSceneProxy::ControlPointVertexType &ControlPoint = ControlPoints[Frame][i];
+				float Distance = FMath::Max((Positions[i] - RootPosition).Size(), 1.0f);
+				float Speed = FMath::Max(Velocities[i].Size(), 1.0f);
+				MaxPositionError = FMath::Max(MaxPositionError, (ControlPoint.Position - Positions[i]).GetAbsMax() / Distance);
+				MaxVelocityError = FMath::Max(MaxVelocityError, (ControlPoint.Velocity - Velocities[i]).GetAbsMax() / Speed);
+				MaxSkinningError = FMath::Max(MaxSkinningError, (ControlPoint.RootPosition - RootPosition).GetAbsMax());
+				MaxSkinningError = FMath::Max(MaxSkinningError, (ControlPoint.SkinnedSplineDirection - SplineDirection).GetAbsMax());
+				MaxSkinningError = FMath::Max(MaxSkinningError, (ControlPoint.SkinnedNormal - Normal).GetAbsMax());
+			}
+		}
+
+		if(bAngleClamp && NumAngleClamped == 0) {
+			AddError(FString::Printf(TEXT("%s: the angle clamp never triggered."), *ScenarioName));
+		}
+		if(!(MaxPositionError <= MaxAllowedPositionError)) {
+			AddError(FString::Printf(TEXT("%s: max relative position error after %d steps is %f, expected at most %f."),
+				*ScenarioName, NumSteps, MaxPositionError, MaxAllowedPositionError));
+		}
+		if(!(MaxVelocityError <= MaxAllowedVelocityError)) {
+			AddError(FString::Printf(TEXT("%s: max relative velocity error after %d steps is %f, expected at most %f."),
+				*ScenarioName, NumSteps, MaxVelocityError, MaxAllowedVelocityError));
+		}
+		if(!(MaxSkinningError <= MaxAllowedSkinningError)) {
+			AddError(FString::Printf(TEXT("%s: max skinning error is %f, expected at most %f."),
+				*ScenarioName, MaxSkinningError, MaxAllowedSkinningError));
+		}
+	}
+
+	return true;
+}
+
+// Counts heap allocations made by one thread, passing everything through
+// to the allocator it replaced. It goes in over GMalloc the first time a
+// test asks for it and stays there for good, the same way the engine's
+// own malloc proxies do. Uninstalling it could pull it out from under a
+// thread that's partway through a call, but leaving it in means the only
+// thing any other thread ever sees is the same allocator one call deeper.
+// Allocations made before it went in are freed through it just the same.
+// Counting is switched on and off per thread, so nothing else has to stop
+// while it's measuring.
+class FNeoFurAllocationCounter : public FMalloc
+{
+public:
+
+	static FNeoFurAllocationCounter &Get()
+	{
+		// Allocated with the system allocator (see FUseSystemMallocForNew)
+		// and never freed, since it's GMalloc from here on.
+		static FNeoFurAllocationCounter *Counter = nullptr;
+		if(!Counter) {
+			check(IsInGameThread());
+			Counter = new FNeoFurAllocationCounter(GMalloc);
+			FPlatformAtomics::InterlockedExchangePtr((void**)&GMalloc, Counter);
+		}
+		return *Counter;
+	}
+
+	// Starts counting allocations made by the calling thread.
+	void Begin()
+	{
+		check(GMalloc == this);
+		check(!CountingThreadId);
+		NumAllocations = 0;
+		FPlatformAtomics::InterlockedExchange((volatile int32*)&CountingThreadId, int32(FPlatformTLS::GetCurrentThreadId()));
+	}
+
+	// Stops counting, and returns the number of allocations since Begin().
+	int32 End()
+	{
+		check(CountingThreadId == FPlatformTLS::GetCurrentThreadId());
+		FPlatformAtomics::InterlockedExchange((volatile int32*)&CountingThreadId, 0);
+		return NumAllocations;
+	}
+
+	virtual void *Malloc(SIZE_T Count, uint32 Alignment) override
+	{
+		CountAllocation();
+		return Inner->Malloc(Count, Alignment);
+	}
+
+	virtual void *Realloc(void *Original, SIZE_T Count, uint32 Alignment) override
+	{
+		if(Count) {
+			CountAllocation();
+		}
+		return Inner->Realloc(Original, Count, Alignment);
+	}
+
+	virtual void Free(void *Original) override
+	{
+		Inner->Free(Original);
+	}
+
+	virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override
+	{
+		return Inner->QuantizeSize(Count, Alignment);
+	}
+
+	virtual bool GetAllocationSize(void *Original, SIZE_T &SizeOut) override
+	{
+		return Inner->GetAllocationSize(Original, SizeOut);
+	}
+
+	virtual void Trim() override
+	{
+		Inner->Trim();
+	}
+
+  #if ENGINE_MINOR_VERSION >= 15
+	virtual void SetupTLSCachesOnCurrentThread() override
+	{
+		Inner->SetupTLSCachesOnCurrentThread();
+	}
+
+	virtual void ClearAndDisableTLSCachesOnCurrentThread() override
+	{
+		Inner->ClearAndDisableTLSCachesOnCurrentThread();
+	}
+  #endif
+
+	virtual bool ValidateHeap() override
+	{
+		return Inner->ValidateHeap();
+	}
+
+	virtual void InitializeStatsMetadata() override
+	{
+		Inner->InitializeStatsMetadata();
+	}
+
+	virtual void UpdateStats() override
+	{
+		Inner->UpdateStats();
+	}
+
+	virtual void GetAllocatorStats(FGenericMemoryStats &OutStats) override
+	{
+		Inner->GetAllocatorStats(OutStats);
+	}
+
+	virtual void DumpAllocatorStats(FOutputDevice &Ar) override
+	{
+		Inner->DumpAllocatorStats(Ar);
+	}
+
+	virtual bool Exec(UWorld *InWorld, const TCHAR *Cmd, FOutputDevice &Ar) override
+	{
+		return Inner->Exec(InWorld, Cmd, Ar);
+	}
+
+	virtual bool IsInternallyThreadSafe() const override
+	{
+		return Inner->IsInternallyThreadSafe();
+	}
+
+	virtual const TCHAR *GetDescriptiveName() override
+	{
+		return Inner->GetDescriptiveName();
+	}
+
+private:
+
+	explicit FNeoFurAllocationCounter(FMalloc *InInner)
+		: Inner(InInner)
+		, CountingThreadId(0)
+		, NumAllocations(0)
+	{
+	}
+
+	void CountAllocation()
+	{
+		// Only the counting thread ever writes NumAllocations.
+		if(CountingThreadId && CountingThreadId == FPlatformTLS::GetCurrentThreadId()) {
+			NumAllocations++;
+		}
+	}
+
+	FMalloc *const Inner;
+	volatile uint32 CountingThreadId; // Zero when not counting.
+	int32 NumAllocations;
+};
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(
+	FNeoFurSimulationHandoffAllocationTest,
+	"NeoFur.CPUSim.SteadyStateHandoffDoesNotAllocate",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FNeoFurSimulationHandoffAllocationTest::RunTest(const FString &Parameters)
+{
+	typedef FNeoFurComponentSceneProxy::SimulationParamsType SimulationParamsType;
+
+	const int32 NumBones = 40;
+	const int32 NumVertices = 2000;
+
+	// What TickComponent() fills each block from: the skeleton's pose,
+	// the fur asset's bone palette, the component's morph deltas,
+	// collision bodies and forces. All of these are already allocated
+	// before the tick.
+	TArray<uint16> BonePalette;
+	TArray<FMatrix> RefBasesInvMatrix;
+	TArray<FTransform> SpaceBases;
+	for(int32 i = 0; i < NumBones; i++) {
+		BonePalette.Add(uint16(i));
+		RefBasesInvMatrix.Add(FTranslationMatrix(FVector(0.0f, 0.0f, -float(i))));
+		SpaceBases.Add(FTransform(FVector(0.0f, 0.0f, float(i))));
+	}
+	TArray<FNeoFurComponentSceneProxy::MorphDataVertexType> MorphDeltaBuffer;
+	MorphDeltaBuffer.SetNumZeroed(NumVertices);
+	TArray<FNeoFurCollisionShape> CollisionBodies;
+	CollisionBodies.SetNumZeroed(6);
+	for(int32 i = 0; i < CollisionBodies.Num(); i++) {
+		CollisionBodies[i].Start = FVector(0.0f, 5.0f, 0.0f);
+		CollisionBodies[i].End = FVector(0.0f, 5.0f, 10.0f);
+		CollisionBodies[i].Radius = 3.0f;
+	}
+	TArray<FNeoFurForceField> ComponentForces;
+	ComponentForces.Add(FNeoFurForceField::Radial(FVector(0.0f, 0.0f, 10.0f), 50.0f, 100.0f));
+	ComponentForces.Add(FNeoFurForceField::Vortex(FVector::ZeroVector, 80.0f, FVector(0.0f, 0.0f, 1.0f), 50.0f));
+	FTransform ParentToComponent(FVector(0.0f, 0.0f, 5.0f));
+	FBox Bounds(FVector(-100.0f), FVector(100.0f));
+
+	// The proxy's side: the ring, the fixed-step bookkeeping, and the CPU
+	// simulation's snapshot of what the last step ran with.
+	SimulationParamsType Ring[NEOFUR_SIMULATION_PARAMS_RING_SIZE];
+	FNeoFurSimulationStepper Stepper;
+	FNeoFurCPUSimState State;
+	FNeoFurCPUSimJob Job;
+	Job.ShellDistance = 2.0f;
+
+	// Half a step per frame, so after the warm-up only every other frame
+	// steps, and the ones in between hold their forces over.
+	float StepTime = 1.0f / float(NEOFUR_SIMULATION_STEP_RATE);
+	int32 NumSteppingFrames = 0;
+	int32 NumHeldOverFrames = 0;
+
+	// One frame of TickComponent() filling the next block, and of
+	// RunSimulation_Renderthread() taking it.
+	auto RunFrame = [&](int32 Frame)
+	{
+		for(int32 i = 0; i < NumBones; i++) {
+			SpaceBases[i].SetRotation(FQuat(FVector(1.0f, 0.0f, 0.0f), float(Frame) * 0.01f * float(i)));
+		}
+
+		SimulationParamsType &Params = Ring[Frame % NEOFUR_SIMULATION_PARAMS_RING_SIZE];
+		Params.Reset();
+		Params.SetBoneMats(BonePalette, RefBasesInvMatrix, SpaceBases);
+		Params.SetMorphData(MorphDeltaBuffer);
+		for(int32 i = 0; i < CollisionBodies.Num(); i++) {
+			Params.AddCollisionShape(CollisionBodies[i], SpaceBases[i] * ParentToComponent);
+		}
+		Params.AddForces(ComponentForces, nullptr, Bounds, FTransform::Identity);
+		Params.RelativeTransformSinceLastFrame = FTransform(FVector(1.0f, 0.0f, 0.0f));
+		Params.DeltaTime = StepTime * 0.5f;
+		Params.LocalSpaceGravity = FVector(0.0f, 0.0f, -980.0f);
+		Params.RateDivisor = 1;
+		Params.WarmUpSteps = Frame == 0 ? NEOFUR_SIMULATION_WARM_UP_STEPS : 0;
+
+		if(!Stepper.Advance(Params, Frame == 0)) return;
+
+		if(Params.Forces.Num() > ComponentForces.Num()) {
+			NumHeldOverFrames++;
+		}
+		NumSteppingFrames++;
+
+		Job.RelativeTransformSinceLastFrame = Params.RelativeTransformSinceLastFrame;
+		Job.DeltaTime = Params.DeltaTime;
+		Job.LocalSpaceGravity = Params.LocalSpaceGravity;
+		Job.NumForces = Params.Forces.Num();
+		NeoFurUpdateSleepInputs(State, Job, Params);
+	};
+
+	// The arrays grow to size on the way around the ring. The warm-up
+	// steps on every frame for the first few, and after that each block
+	// comes up on both stepping and non-stepping frames twice.
+	int32 Frame = 0;
+	for(; Frame < NEOFUR_SIMULATION_PARAMS_RING_SIZE * 4; Frame++) {
+		RunFrame(Frame);
+	}
+
+	NumSteppingFrames = 0;
+	NumHeldOverFrames = 0;
+	int32 NumMeasuredFrames = NEOFUR_SIMULATION_PARAMS_RING_SIZE * 10;
+
+	FNeoFurAllocationCounter &AllocationCounter = FNeoFurAllocationCounter::Get();
+	AllocationCounter.Begin();
+	for(int32 i = 0; i < NumMeasuredFrames; i++, Frame++) {
+		RunFrame(Frame);
+	}
+	int32 NumAllocations = AllocationCounter.End();
+
+	if(NumSteppingFrames != NumMeasuredFrames / 2 || NumHeldOverFrames != NumSteppingFrames) {
+		AddError(FString::Printf(
+			TEXT("Expected %d frames to step with held over forces, got %d stepping and %d with held over forces"),
+			NumMeasuredFrames / 2, NumSteppingFrames, NumHeldOverFrames));
+	}
+
+	if(NumAllocations) {
+		AddError(FString::Printf(
+			TEXT("%d heap allocations once the ring is warmed up"), NumAllocations));
+	}
+
+	return true;
+}
 
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,170 @@
+// ---------------------------------------------------------------------------
+//
+// Copyright (c) 2016 Neoglyphic Entertainment, Inc. All rights reserved.
+//
+// This is part of the NeoFur fur and hair rendering and simulation
+// plugin for Unreal Engine.
+//
+// Do not redistribute NeoFur without the express permission of
+// Neoglyphic Entertainment. See your license for specific details.
+//
+// -------------------------- END HEADER -------------------------------------
+
+#include "NeoFur.h"
+
+#include "NeoFurForceFieldRegistry.h"
+#include "NeoFurProfiling.h"
+
+static TMap<TWeakObjectPtr<UWorld>, TSharedPtr<FNeoFurForceFieldRegistry>> NeoFurForceFieldRegistries;
+static FDelegateHandle NeoFurForceFieldPreActorTickHandle;
+static FDelegateHandle NeoFurForceFieldWorldCleanupHandle;
+
+static FIntVector NeoFurForceGridCell(const FVector &Location)
+{
+	return FIntVector(
+		FMath::FloorToInt(Location.X / NEOFUR_FORCE_GRID_CELL_SIZE),
+		FMath::FloorToInt(Location.Y / NEOFUR_FORCE_GRID_CELL_SIZE),
+		FMath::FloorToInt(Location.Z / NEOFUR_FORCE_GRID_CELL_SIZE));
+}
+
+FNeoFurForceFieldRegistry *FNeoFurForceFieldRegistry::Get(UWorld *World)
+{
+	if(!World) return nullptr;
+
+	if(!NeoFurForceFieldPreActorTickHandle.IsValid()) {
+		NeoFurForceFieldPreActorTickHandle = FWorldDelegates::OnWorldPreActorTick.AddStatic(&FNeoFurForceFieldRegistry::OnWorldPreActorTick);
+		NeoFurForceFieldWorldCleanupHandle = FWorldDelegates::OnWorldCleanup.AddStatic(&FNeoFurForceFieldRegistry::OnWorldCleanup);
+	}
+
+	TSharedPtr<FNeoFurForceFieldRegistry> &Registry = NeoFurForceFieldRegistries.FindOrAdd(World);
+	if(!Registry.IsValid()) {
+		Registry = MakeShareable(new FNeoFurForceFieldRegistry);
+	}
+
+	return Registry.Get();
+}
+
+FNeoFurForceFieldRegistry *FNeoFurForceFieldRegistry::Find(UWorld *World)
+{
+	const TSharedPtr<FNeoFurForceFieldRegistry> *Registry = NeoFurForceFieldRegistries.Find(World);
+	return Registry ? Registry->Get() : nullptr;
+}
+
+FNeoFurForceFieldRegistry::FNeoFurForceFieldRegistry()
+{
+	QueryStamp = 0;
+}
+
+void FNeoFurForceFieldRegistry::OnWorldPreActorTick(UWorld *World, ELevelTick TickType, float DeltaSeconds)
+{
+	FNeoFurForceFieldRegistry *Registry = Find(World);
+	if(Registry) {
+		Registry->Flip();
+	}
+}
+
+void FNeoFurForceFieldRegistry::OnWorldCleanup(UWorld *World, bool bSessionEnded, bool bCleanupResources)
+{
+	NeoFurForceFieldRegistries.Remove(World);
+}
+
+void FNeoFurForceFieldRegistry::AddForce(const FNeoFurForceField &Force)
+{
+	if(Force.Radius <= 0.0f || Force.Strength == 0.0f) return;
+	PendingForces.Add(Force);
+}
+
+void FNeoFurForceFieldRegistry::Flip()
+{
+	// Nothing this frame or last. Skip clearing out a grid that's already
+	// empty.
+	if(!Forces.Num() && !PendingForces.Num()) return;
+
+	NEOFUR_PROFILE_SCOPE("FNeoFurForceFieldRegistry::Flip");
+
+	Swap(Forces, PendingForces);
+	PendingForces.Reset();
+
+	Cells.Reset();
+	LargeForces.Reset();
+	ForceQueryStamps.Reset();
+	ForceQueryStamps.SetNumZeroed(Forces.Num());
+	QueryStamp = 0;
+
+	for(int32 i = 0; i < Forces.Num(); i++) {
+		const FNeoFurForceField &Force = Forces[i];
+		FVector Extent(Force.Radius);
+		FIntVector MinCell = NeoFurForceGridCell(Force.Origin - Extent);
+		FIntVector MaxCell = NeoFurForceGridCell(Force.Origin + Extent);
+
+		int64 NumCells =
+			int64(MaxCell.X - MinCell.X + 1) *
+			int64(MaxCell.Y - MinCell.Y + 1) *
+			int64(MaxCell.Z - MinCell.Z + 1);
+		if(NumCells > NEOFUR_FORCE_GRID_MAX_CELLS_PER_FORCE) {
+			LargeForces.Add(i);
+			continue;
+		}
+
+		for(int32 Z = MinCell.Z; Z <= MaxCell.Z; Z++) {
+			for(int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++) {
+				for(int32 X = MinCell.X; X <= MaxCell.X; X++) {
+					Cells.Add(FIntVector(X, Y, Z), i);
+				}
+			}
+		}
+	}
+}
+
+void FNeoFurForceFieldRegistry::GatherForce(
+	int32 ForceIndex, const FBox &Bounds, const FTransform &WorldToLocal,
+	TArray<FNeoFurForceField> &OutForces)
+{
+	if(ForceQueryStamps[ForceIndex] == QueryStamp) return;
+	ForceQueryStamps[ForceIndex] = QueryStamp;
+
+	const FNeoFurForceField &Force = Forces[ForceIndex];
+	if(FMath::SphereAABBIntersection(Force.Origin, FMath::Square(Force.Radius), Bounds)) {
+		OutForces.Add(Force.TransformBy(WorldToLocal));
+	}
+}
+
+void FNeoFurForceFieldRegistry::GatherForces(
+	const FBox &Bounds, const FTransform &WorldToLocal,
+	TArray<FNeoFurForceField> &OutForces)
+{
+	if(!Forces.Num() || !Bounds.IsValid) return;
+
+	QueryStamp++;
+
+	FIntVector MinCell = NeoFurForceGridCell(Bounds.Min);
+	FIntVector MaxCell = NeoFurForceGridCell(Bounds.Max);
+	int64 NumCells =
+		int64(MaxCell.X - MinCell.X + 1) *
+		int64(MaxCell.Y - MinCell.Y + 1) *
+		int64(MaxCell.Z - MinCell.Z + 1);
+
+	// Something huge covering more cells than there are forces is better
+	// off just checking every force.
+	if(NumCells > Forces.Num()) {
+		for(int32 i = 0; i < Forces.Num(); i++) {
+			GatherForce(i, Bounds, WorldToLocal, OutForces);
+		}
+		return;
+	}
+
+	for(int32 Z = MinCell.Z; Z <= MaxCell.Z; Z++) {
+		for(int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++) {
+			for(int32 X = MinCell.X; X <= MaxCell.X; X++) {
+				for(auto It = Cells.CreateConstKeyIterator(FIntVector(X, Y, Z)); It; ++It) {
+					GatherForce(It.Value(), Bounds, WorldToLocal, OutForces);
+				}
+			}
+		}
+	}
+
+	for(int32 i = 0; i < LargeForces.Num(); i++) {
+		GatherForce(LargeForces[i], Bounds, WorldToLocal, OutForces);
+	}
+}
+
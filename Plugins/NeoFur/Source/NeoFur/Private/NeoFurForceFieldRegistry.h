@@ -0,0 +1,70 @@
+// ---------------------------------------------------------------------------
+//
+// Copyright (c) 2016 Neoglyphic Entertainment, Inc. All rights reserved.
+//
+// This is part of the NeoFur fur and hair rendering and simulation
+// plugin for Unreal Engine.
+//
+// Do not redistribute NeoFur without the express permission of
+// Neoglyphic Entertainment. See your license for specific details.
+//
+// -------------------------- END HEADER -------------------------------------
+
+#pragma once
+
+#include "NeoFur.h"
+#include "NeoFurComponentSceneProxy.h"
+
+// Per-world list of forces acting on fur that aren't aimed at any one
+// component, like explosions, footsteps and gusts. Forces get sorted into
+// a coarse grid once per frame, so each fur component only looks at the
+// ones in the cells its bounds cover.
+//
+// Forces last one frame. Anything added during a frame gets picked up by
+// the fur on the next one, no matter what order everything ticks in.
+class FNeoFurForceFieldRegistry
+{
+public:
+
+	// Returns the registry for World, creating it if needed.
+	static FNeoFurForceFieldRegistry *Get(UWorld *World);
+
+	// Returns the registry for World, or nullptr if no forces have ever
+	// been added to it.
+	static FNeoFurForceFieldRegistry *Find(UWorld *World);
+
+	// Force is in world space.
+	void AddForce(const FNeoFurForceField &Force);
+
+	// Appends every one of last frame's forces that overlaps Bounds (in
+	// world space), moved into the space WorldToLocal goes to.
+	void GatherForces(const FBox &Bounds, const FTransform &WorldToLocal, TArray<FNeoFurForceField> &OutForces);
+
+private:
+
+	FNeoFurForceFieldRegistry();
+
+	// Makes this frame's forces current and rebuilds the grid.
+	void Flip();
+
+	void GatherForce(int32 ForceIndex, const FBox &Bounds, const FTransform &WorldToLocal, TArray<FNeoFurForceField> &OutForces);
+
+	static void OnWorldPreActorTick(UWorld *World, ELevelTick TickType, float DeltaSeconds);
+	static void OnWorldCleanup(UWorld *World, bool bSessionEnded, bool bCleanupResources);
+
+	// Being added to during this frame.
+	TArray<FNeoFurForceField> PendingForces;
+
+	// Last frame's forces, and which grid cells they overlap. Forces too
+	// big to be worth putting in the grid go in LargeForces instead, and
+	// every query checks those.
+	TArray<FNeoFurForceField> Forces;
+	TMultiMap<FIntVector, int32> Cells;
+	TArray<int32> LargeForces;
+
+	// When each force was last returned, so a force that's in several of
+	// the cells a query covers only gets returned once.
+	TArray<uint32> ForceQueryStamps;
+	uint32 QueryStamp;
+};
+
@@ -21,14 +21,283 @@
 #include "RHICommandList.h"
 #include "ShaderParameterUtils.h"
 
+// ----------------------------------------------------------------------
+// CPU simulation working set
+// ----------------------------------------------------------------------
+
+// Structure-of-arrays copy of the control points for the CPU simulation,
+// so the kernel can work on four control points per SIMD register. Every
+// array is padded out to a multiple of four. This only gets converted to
+// ControlPointVertexType for the upload.
+struct FNeoFurCPUSimState
+{
+	typedef TArray<float, TAlignedHeapAllocator<16>> FFloatArray;
+
+	// Carried over between frames.
+	FFloatArray PositionX, PositionY, PositionZ;
+	FFloatArray VelocityX, VelocityY, VelocityZ;
+
+	// Rebuilt from the skinned mesh every frame.
+	FFloatArray RootX, RootY, RootZ;
+	FFloatArray SplineX, SplineY, SplineZ;
+	FFloatArray NormalX, NormalY, NormalZ;
+
+	int32 NumControlPoints;
+
+	// Bounds of each chunk's control points at the end of the last step.
+	// Used to skip forces and collision shapes that can't reach a chunk.
+	TArray<FBox> ChunkBounds;
+
+	// True when the roots, spline directions and normals are the
+	// unskinned, unmorphed static vertex data.
+	bool bRestPoseRoots;
+
+	// Sleep tracking. Once the fur has barely moved for
+	// NEOFUR_SLEEP_SETTLE_STEPS steps in a row, and nothing acting on it
+	// has changed, steps are skipped until something does change. The
+	// Last* members are what the last step ran with.
+	int32 SettledSteps;
+	TArray<FNeoFurComponentSceneProxy::BoneMatrixType> LastBoneMats;
+	TArray<FNeoFurComponentSceneProxy::MorphDataVertexType> LastMorphData;
+	TArray<FNeoFurCollisionShape> LastCollisionShapes;
+	FNeoFurPhysicsParameters LastPhysicsParameters;
+	FVector LastWindVector;
+	float LastWindGustsAmount;
+	FVector LastGravity;
+	float LastShellDistance;
+
+	FNeoFurCPUSimState()
+		: NumControlPoints(-1)
+		, bRestPoseRoots(false)
+		, SettledSteps(0)
+		, LastWindVector(FVector::ZeroVector)
+		, LastWindGustsAmount(0.0f)
+		, LastGravity(FVector::ZeroVector)
+		, LastShellDistance(0.0f)
+	{
+	}
+};
+
+// ----------------------------------------------------------------------
+// CPU simulation job
+// ----------------------------------------------------------------------
+
+// Everything the CPU simulation tasks read or write for one frame. The
+// render thread fills this in, hands chunks of it to worker threads,
+// and must not touch it (or the control point arrays it points into)
+// again until FinishSimulation_Renderthread_CPU() has waited on the
+// tasks.
+struct FNeoFurCPUSimJob
+{
+	typedef void (*FPassFunction)(const FNeoFurCPUSimJob &Job, int32 StartIndex, int32 EndIndex);
+	typedef void (*FIntegratePassFunction)(
+		const FNeoFurCPUSimJob &Job, int32 StartIndex, int32 EndIndex,
+		const FNeoFurForceField *const *Forces, int32 NumForces);
+
+	FTransform RelativeTransformSinceLastFrame;
+	FMatrix VelocityTransform; // See NeoFurIntegrateControlPoints().
+	float DeltaTime;
+	FVector LocalSpaceGravity;
+
+	// Snapshots, so SetPhysicsParameters() and friends can keep
+	// running on the render thread while the tasks are in flight.
+	FNeoFurPhysicsParameters PhysicsParameters;
+	FNeoFurFramePhysicsInputs PhysicsFrameInputs;
+	float ShellDistance;
+
+	const FNeoFurComponentSceneProxy::VertexType_Static *StaticVerts;
+	FNeoFurCPUSimState *State;
+	const FNeoFurComponentSceneProxy::ControlPointVertexType *OldControlPoints; // Last step's output.
+	FNeoFurComponentSceneProxy::ControlPointVertexType *NewControlPoints; // Repacked output for the upload.
+	int32 NumControlPoints;
+
+	// Sum of the squared distance every control point moved this step,
+	// one entry per chunk. Points into ChunkMotionStorage.
+	float *ChunkMotion;
+	TArray<float> ChunkMotionStorage;
+
+	// Null for static meshes.
+	const FMatrix *BoneMats;
+	TArray<FMatrix> BoneMatsStorage;
+
+	// Null when no morph targets are active. Points into Params.
+	const FNeoFurComponentSceneProxy::MorphDataVertexType *MorphData;
+
+	// Points into Params.
+	const FNeoFurForceField *Forces;
+	int32 NumForces;
+
+	// Points into Params. Empty when collision is off.
+	const FNeoFurCollisionShape *CollisionShapes;
+	int32 NumCollisionShapes;
+
+	// The game thread's parameter block for this frame. Released back
+	// to the game thread when the job is finished.
+	FNeoFurComponentSceneProxy::SimulationParamsType *Params;
+
+	// Kernel specializations picked for this frame. SkinPass is null
+	// when the working set already has this frame's roots.
+	FPassFunction SkinPass;
+	FIntegratePassFunction IntegratePass;
+
+	FGraphEventArray Tasks;
+	bool bPendingUpload;
+
+	FNeoFurCPUSimJob()
+		: ChunkMotion(nullptr)
+		, MorphData(nullptr)
+		, Forces(nullptr)
+		, NumForces(0)
+		, CollisionShapes(nullptr)
+		, NumCollisionShapes(0)
+		, Params(nullptr)
+		, SkinPass(nullptr)
+		, IntegratePass(nullptr)
+		, bPendingUpload(false)
+	{
+	}
+};
+
+// ----------------------------------------------------------------------
+// Shared asset resources
+// ----------------------------------------------------------------------
+
+// Render resources that only depend on the fur asset, so every proxy
+// using the same asset shares one copy. The asset holds a reference and
+// each proxy holds another. The last reference has to go away on the
+// render thread, since that's where the RHI resources get released.
+class FNeoFurAssetRenderResources
+{
+public:
+
+	// Game thread. Kicks off building the resources for FurAsset on a
+	// worker task and returns with one reference held for the caller.
+	static FNeoFurAssetRenderResources *Create(const UNeoFurAsset *FurAsset);
+
+	// Game thread. Drops the caller's reference on the render thread.
+	void BeginRelease();
+
+	uint32 AddRef() const;
+	uint32 Release() const;
+	uint32 GetRefCount() const;
+
+	// Render thread. Creates the RHI resources once the build task is
+	// done. Returns false until then, and nothing here can be used.
+	bool IsReady_Renderthread();
+
+	// Completes when StaticVertexData_CPU is filled in.
+	FGraphEventRef BuildTask;
+
+	// Static per-vertex data for the CPU simulation and vertex factory.
+	TArray<FNeoFurComponentSceneProxy::VertexType_Static> StaticVertexData_CPU;
+	FVertexBuffer StaticVertexData_GPU;
+
+	// FIXME: Remove old mesh data.
+	// Source data copied from the original skeletal mesh. Only there if
+	// the compute shader simulation is available.
+	FVertexBuffer SkeletalMeshVertexBufferCopy_GPU;
+	FIndexBuffer SkeletalMeshIndexBufferCopy; // Don't need a CPU version of this (not used in simulation).
+
+	FIndexBuffer PostAnimationIndexBuffer; // One shell's worth, 16-bit when it fits.
+
+	uint32 MemoryUsage;
+
+private:
+
+	FNeoFurAssetRenderResources();
+	~FNeoFurAssetRenderResources();
+
+	void Build_Worker();
+	void InitRHI_Renderthread();
+
+	// Asset data waiting to go to the GPU.
+	TArray<FNeoFurComponentSceneProxy::VertexType> PendingVertices;
+	TArray<uint32> PendingIndices;
+	TArray<uint16> PendingShellIndices16;
+
+	bool bRHIReady;
+
+	mutable FThreadSafeCounter NumRefs;
+};
+
+// ----------------------------------------------------------------------
+// Fixed-step simulation
+// ----------------------------------------------------------------------
+
+// Turns the time each frame's parameters bring with them into whole
+// simulation steps. Frames that don't step hand their time, component
+// movement and forces on to the next frame that does. Render thread
+// only.
+struct FNeoFurSimulationStepper
+{
+	float TimeAccumulator;
+	FTransform PendingRelativeTransform;
+	TArray<FNeoFurForceField> PendingForces; // From frames that didn't step.
+	int32 PendingWarmUpSteps; // Still to run, a few per frame.
+
+	FNeoFurSimulationStepper()
+		: TimeAccumulator(0.0f)
+		, PendingRelativeTransform(FTransform::Identity)
+		, PendingWarmUpSteps(0)
+	{
+	}
+
+	// Adds Params' frame and returns how many steps to run. Params is
+	// left set up for the first step: DeltaTime is the step time, and
+	// the movement and forces include everything held over. Steps at
+	// least once if bMustStep.
+	int32 Advance(FNeoFurComponentSceneProxy::SimulationParamsType &Params, bool bMustStep);
+
+	// How far the leftover time is into the next step.
+	float GetAlpha(float StepTime) const
+	{
+		return TimeAccumulator / StepTime;
+	}
+};
+
+// ----------------------------------------------------------------------
+// Simulation timing
+// ----------------------------------------------------------------------
+
+// Cycles spent simulating fur since startup, across every proxy, on the
+// render thread and the CPU simulation tasks. Read through
+// UNeoFurComponent::GetTotalSimulationSeconds().
+extern FThreadSafeCounter64 GNeoFurSimulationCycles;
+
+// Adds the time spent in its scope to GNeoFurSimulationCycles. Don't put
+// one around anything that waits on the simulation tasks, or the tasks
+// get counted twice.
+class FNeoFurSimulationTimeScope
+{
+public:
+
+	FNeoFurSimulationTimeScope() : StartCycles(FPlatformTime::Cycles()) {}
+	~FNeoFurSimulationTimeScope() { GNeoFurSimulationCycles.Add(FPlatformTime::Cycles() - StartCycles); }
+
+private:
+
+	uint32 StartCycles;
+};
+
 // ----------------------------------------------------------------------
 // Private data
 // ----------------------------------------------------------------------
 
+struct FNeoFurProxyPrivateData;
+
+// What the vertex factory gets through FMeshBatchElement::UserData.
+// Shells normally get drawn as instances of the first shell, but where
+// instancing isn't available each shell gets its own batch element, so
+// the shell has to come along with the element.
+struct FNeoFurShellBatchData
+{
+	const FNeoFurProxyPrivateData *PrivateData;
+	int32 ShellOffset;
+};
+
 struct FNeoFurProxyPrivateData
 {
 	int32 ActiveShellCount;
-	int32 LastSimulatedActiveShellCount[2]; // Record of ActiveShellCount when it was used to simulate each of the two control point buffers.
     int32 ShellCount;
 	float ShellDistance;
 	float ShellFade;
@@ -41,34 +310,39 @@ struct FNeoFurProxyPrivateData
 	FNeoFurPhysicsParameters PhysicsParameters;
 	FNeoFurFramePhysicsInputs PhysicsFrameInputs;
 
-	// FIXME: Remove old mesh data.
-	// Source data copied from the original skeletal mesh.
-	FVertexBuffer SkeletalMeshVertexBufferCopy_GPU;
-	TArray<FNeoFurComponentSceneProxy::VertexType> SkeletalMeshVertexBufferCopy_CPU;
-	FIndexBuffer SkeletalMeshIndexBufferCopy; // Don't need a CPU version of this (not used in simulation).
+	// Mesh data shared with every other proxy using the same asset.
+	TRefCountPtr<FNeoFurAssetRenderResources> AssetResources;
 
-	// New mesh data.
-	TArray<FNeoFurComponentSceneProxy::VertexType_Static> StaticVertexData_CPU;
-	FVertexBuffer StaticVertexData_GPU;
+	// Builds the initial control points. The buffers aren't usable until
+	// bBuffersReady is set.
+	FGraphEventRef BuildTask;
+	bool bBuffersReady;
 
 	// Control point data (last frame and next frame).
 	FVertexBuffer ControlPointVertexBuffers_GPU[2];
 	TArray<FNeoFurComponentSceneProxy::ControlPointVertexType> ControlPointVertexBuffers_CPU[2];
 	int32 ControlPointVertexBufferFrame;
 
+	FNeoFurCPUSimState CPUSimState;
+	FNeoFurCPUSimJob CPUSimJob;
+
 	// Ready-to-render data with shells.
 	FNeoFurVertexFactory VertexFactories[2];
-	FVertexBuffer PostAnimationVertexBuffer; // No CPU version needed (write-only).
-	FIndexBuffer  PostAnimationIndexBuffer;
+	TArray<FNeoFurShellBatchData> ShellBatchData; // One per shell.
 	
 	FVertexBuffer BoneMatsVertexBuffer;
+	int32 NumBoneMats; // Size of the fur asset's bone palette.
 	FVertexBuffer MorphDataVertexBuffer;
 
 	bool bForceSimulateOnCPU;
 	bool bSkipRendering;
 	bool bSkipSimulation;
 	
-	float LastDeltaTime;
+	// Fixed-step simulation state. SimulationAlpha is how far between
+	// the last two steps to draw.
+	FNeoFurSimulationStepper Stepper;
+	float SimulationAlpha;
+	float PreviousSimulationAlpha;
 
 	FUnorderedAccessViewRHIRef ControlPointsUAV[2];
 	FShaderResourceViewRHIRef SkeletalMeshSRV;
@@ -76,7 +350,6 @@ struct FNeoFurProxyPrivateData
 	FShaderResourceViewRHIRef PhysicsPropertiesSRV;
 	FShaderResourceViewRHIRef MorphDataSRV;
 	FVertexBufferRHIRef PhysicsPropertiesVertBuffer;
-	FUnorderedAccessViewRHIRef PostAnimVertexBufferUAV;
 	FShaderResourceViewRHIRef BoneMatsSRV;
 
 	FShaderResourceViewRHIRef PerFrameDataVertBufferSRV;
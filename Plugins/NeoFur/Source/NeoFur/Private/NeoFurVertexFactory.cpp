@@ -42,7 +42,7 @@ public:
     virtual uint32 GetSize() const override;
     
     FShaderParameter ShellCount;
-    FShaderParameter VertsPerShell;
+    FShaderParameter ShellOffset;
 	FShaderParameter ActiveShellCount;
 
 	FShaderParameter Bendiness;
@@ -51,13 +51,16 @@ public:
 	FShaderParameter ShellDistance;
 
 	FShaderParameter NormalDirectionBlend;
+
+	FShaderParameter SimulationAlpha;
+	FShaderParameter PreviousSimulationAlpha;
 };
 
 void FNeoFurVertexFactoryShaderParameters::Bind(const FShaderParameterMap &ParameterMap)
 {
     ShellCount.Bind(ParameterMap, TEXT("ShellCount"));
 	ActiveShellCount.Bind(ParameterMap, TEXT("ActiveShellCount"));
-    VertsPerShell.Bind(ParameterMap, TEXT("VertsPerShell"));
+    ShellOffset.Bind(ParameterMap, TEXT("ShellOffset"));
 
 	Bendiness.Bind(ParameterMap, TEXT("Bendiness"));
 	ShellFade.Bind(ParameterMap, TEXT("ShellFade"));
@@ -65,12 +68,15 @@ void FNeoFurVertexFactoryShaderParameters::Bind(const FShaderParameterMap &Param
 	ShellDistance.Bind(ParameterMap, TEXT("ShellDistance"));
 
 	NormalDirectionBlend.Bind(ParameterMap, TEXT("NormalDirectionBlend"));
+
+	SimulationAlpha.Bind(ParameterMap, TEXT("SimulationAlpha"));
+	PreviousSimulationAlpha.Bind(ParameterMap, TEXT("PreviousSimulationAlpha"));
 }
 
 void FNeoFurVertexFactoryShaderParameters::Serialize(FArchive &Ar)
 {
     Ar << ShellCount;
-    Ar << VertsPerShell;
+    Ar << ShellOffset;
 	Ar << ActiveShellCount;
 
 	Ar << Bendiness;
@@ -79,6 +85,9 @@ void FNeoFurVertexFactoryShaderParameters::Serialize(FArchive &Ar)
 	Ar << ShellDistance;
 	
 	Ar << NormalDirectionBlend;
+
+	Ar << SimulationAlpha;
+	Ar << PreviousSimulationAlpha;
 }
 
 void FNeoFurVertexFactoryShaderParameters::SetMesh(
@@ -92,9 +101,11 @@ void FNeoFurVertexFactoryShaderParameters::SetMesh(
     FRHIVertexShader* ShaderRHI = Shader->GetVertexShader();
     if(ShaderRHI) {
 
-        FNeoFurProxyPrivateData *UserData = (FNeoFurProxyPrivateData*)BatchElement.UserData;
+        const FNeoFurShellBatchData *BatchData = (const FNeoFurShellBatchData*)BatchElement.UserData;
+        const FNeoFurProxyPrivateData *UserData = BatchData->PrivateData;
         
         SetShaderValue(RHICmdList, ShaderRHI, ShellCount, UserData->ShellCount);
+        SetShaderValue(RHICmdList, ShaderRHI, ShellOffset, BatchData->ShellOffset);
         SetShaderValue(RHICmdList, ShaderRHI, ActiveShellCount, UserData->ActiveShellCount);
 
 		SetShaderValue(RHICmdList, ShaderRHI, Bendiness, UserData->PhysicsParameters.Bendiness);
@@ -104,12 +115,8 @@ void FNeoFurVertexFactoryShaderParameters::SetMesh(
 
 		SetShaderValue(RHICmdList, ShaderRHI, NormalDirectionBlend, UserData->PhysicsParameters.NormalDirectionBlend);
 
-        int32 NumVertsPerLayer =
-            (UserData->StaticVertexData_GPU.VertexBufferRHI->GetSize() /
-                sizeof(FNeoFurComponentSceneProxy::VertexType_Static)) /
-			UserData->ShellCount;
-
-        SetShaderValue(RHICmdList, ShaderRHI, VertsPerShell, NumVertsPerLayer);
+		SetShaderValue(RHICmdList, ShaderRHI, SimulationAlpha, UserData->SimulationAlpha);
+		SetShaderValue(RHICmdList, ShaderRHI, PreviousSimulationAlpha, UserData->PreviousSimulationAlpha);
     }
 }
 
@@ -152,8 +159,8 @@ void FNeoFurVertexFactory::InitRHI()
 	// Attribute IDs here are from the FVertexFactoryInput structure
 	// in LocalVertexFactory.usf.
 	
-	// Note: We don't do instancing with the fur, so we can probably
-	// hijack attributes 8-12 for our own purposes. Hopefully Epic
+	// Note: We don't use instance data streams with the fur, so we can
+	// probably hijack attributes 8-12 for our own purposes. Hopefully Epic
 	// doesn't change the LocalVertexFactory vertex format very much,
 	// or we'll have to modify this to compensate for it.
 
@@ -221,14 +228,6 @@ void FNeoFurVertexFactory::InitRHI()
 				STRUCT_OFFSET(FNeoFurComponentSceneProxy::ControlPointVertexType, SkinnedNormal),
 				sizeof(FNeoFurComponentSceneProxy::ControlPointVertexType), VET_Float3), 2));
 
-	// Vertex ID fallback for mobile (static).
-	Elements.Add(
-		AccessStreamComponent(
-			FVertexStreamComponent(
-				VertexBuffer_Static,
-				STRUCT_OFFSET(FNeoFurComponentSceneProxy::VertexType_Static, VertexID),
-				sizeof(FNeoFurComponentSceneProxy::VertexType_Static), VET_Float1), 13));
-
 	// Colors (FIXME: Not currently supported)
 	Elements.Add(AccessStreamComponent(FVertexStreamComponent(&GNullColorVertexBuffer, 0, 0, VET_Color), 3));
 	#if ENGINE_MINOR_VERSION >= 11
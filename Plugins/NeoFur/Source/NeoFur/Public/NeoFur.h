@@ -59,10 +59,107 @@
 #define NEOFUR_BUILTIN_SHADERS_ONLY 0
 #endif
 
+// Server stub mode. Dedicated servers never render, so fur components
+// do not tick, simulate or create scene proxies there. This value is
+// set externally by NeoFur.Build.cs for server targets, and otherwise
+// follows UE_SERVER.
+#ifndef NEOFUR_SERVER_STUB
+#define NEOFUR_SERVER_STUB UE_SERVER
+#endif
+
 #ifndef NEOFUR_MAX_BONE_COUNT
 #define NEOFUR_MAX_BONE_COUNT 256
 #endif
 
+// Number of control points simulated by each task-graph job in the CPU
+// simulation. Large enough that the per-job overhead is noise, small
+// enough that a typical creature still spreads across the workers.
+#ifndef NEOFUR_CPU_SIM_CHUNK_SIZE
+#define NEOFUR_CPU_SIM_CHUNK_SIZE 1024
+#endif
+
+// Number of per-frame simulation parameter blocks each fur proxy keeps
+// for handing data from the game thread to the render thread. The game
+// thread can run a frame ahead of the render thread, and the CPU
+// simulation holds on to its block until the next frame's draw, so
+// three covers steady state.
+#ifndef NEOFUR_SIMULATION_PARAMS_RING_SIZE
+#define NEOFUR_SIMULATION_PARAMS_RING_SIZE 3
+#endif
+
+// Default fur budget for each world, shared by every fur component in
+// it. The shell budget is the total number of shells drawn, and the
+// control point budget is the total number of control points
+// simulated. Components are dropped in order of how small they are on
+// screen when the budget runs out. Zero means no limit. These can be
+// changed at runtime with UNeoFurComponent::SetFurBudget().
+#ifndef NEOFUR_DEFAULT_SHELL_BUDGET
+#define NEOFUR_DEFAULT_SHELL_BUDGET 1200
+#endif
+
+#ifndef NEOFUR_DEFAULT_CONTROL_POINT_BUDGET
+#define NEOFUR_DEFAULT_CONTROL_POINT_BUDGET 500000
+#endif
+
+// Base rate of the fixed-step fur simulation, in steps per second.
+// Components that are small on screen step at a fraction of this. Time
+// left over between steps is covered by interpolating between the last
+// two steps when drawing.
+#ifndef NEOFUR_SIMULATION_STEP_RATE
+#define NEOFUR_SIMULATION_STEP_RATE 60
+#endif
+
+// Most simulation steps to run in one frame when catching up. Past this
+// the simulation just runs slower than real time, rather than making a
+// bad frame worse.
+#ifndef NEOFUR_SIMULATION_MAX_STEPS_PER_FRAME
+#define NEOFUR_SIMULATION_MAX_STEPS_PER_FRAME 2
+#endif
+
+// Cell size of the grid world-level fur forces get sorted into, and the
+// most cells one force can cover before it skips the grid and just gets
+// checked by everything.
+#ifndef NEOFUR_FORCE_GRID_CELL_SIZE
+#define NEOFUR_FORCE_GRID_CELL_SIZE 500.0f
+#endif
+
+#ifndef NEOFUR_FORCE_GRID_MAX_CELLS_PER_FORCE
+#define NEOFUR_FORCE_GRID_MAX_CELLS_PER_FORCE 64
+#endif
+
+// Most capsules and spheres taken from the owner's physics asset for fur
+// collision. Every control point is tested against every one that
+// overlaps its chunk, so this should stay small.
+#ifndef NEOFUR_MAX_COLLISION_SHAPES
+#define NEOFUR_MAX_COLLISION_SHAPES 32
+#endif
+
+// Fur that hasn't been rendered for this long (in seconds) stops
+// simulating until it's back on screen, and then gets
+// NEOFUR_SIMULATION_WARM_UP_STEPS extra steps to settle. Those still
+// count against NEOFUR_SIMULATION_MAX_STEPS_PER_FRAME, so they get run
+// a few at a time over the next several frames.
+#ifndef NEOFUR_OFFSCREEN_SIMULATION_TIME
+#define NEOFUR_OFFSCREEN_SIMULATION_TIME 0.25f
+#endif
+
+#ifndef NEOFUR_SIMULATION_WARM_UP_STEPS
+#define NEOFUR_SIMULATION_WARM_UP_STEPS 8
+#endif
+
+// CPU-simulated fur goes to sleep after this many steps in a row where
+// its control points moved slower than NEOFUR_SLEEP_SPEED_THRESHOLD (in
+// units per second, root mean square over all the control points), as
+// long as the bones, morphs, movement, wind, gravity and physics
+// parameters stayed the same. Anything changing wakes it back up.
+#ifndef NEOFUR_SLEEP_SETTLE_STEPS
+#define NEOFUR_SLEEP_SETTLE_STEPS 30
+#endif
+
+#ifndef NEOFUR_SLEEP_SPEED_THRESHOLD
+#define NEOFUR_SLEEP_SPEED_THRESHOLD 0.1f
+#endif
+
 #define NEOFUR_ENABLE_PROFILING 0
 #define NEOFUR_USE_CUSTOM_RNG 0
 
@@ -16,6 +16,26 @@
 #include "NeoFurComponentSceneProxy.h"
 #include "NeoFurAsset.generated.h"
 
+// Sparse deltas for one of the growth mesh's morph targets, already
+// remapped to fur vertex indices. Only vertices the morph target actually
+// moves are listed.
+struct FNeoFurMorphTargetDeltas
+{
+	FName Name;
+	TArray<int32> VertexIndices;
+	TArray<FNeoFurComponentSceneProxy::MorphDataVertexType> Deltas;
+
+	friend FArchive &operator<<(FArchive &Ar, FNeoFurMorphTargetDeltas &MorphTargetDeltas)
+	{
+		Ar << MorphTargetDeltas.Name;
+		Ar << MorphTargetDeltas.VertexIndices;
+		Ar << MorphTargetDeltas.Deltas;
+		return Ar;
+	}
+};
+
+class FNeoFurAssetRenderResources;
+
 UCLASS()
 class NEOFUR_API UNeoFurAsset : public UObject
 {
@@ -83,10 +103,32 @@ public:
 
 	TArray<int32> OriginalIndexToNewIndexMapping;
 
+	// Skeleton bone index for each bone the fur actually uses.
+	// Vertices[].InfluenceBones index into this, not into the skeleton, so
+	// only these bones get sent to the render thread every frame.
+	TArray<uint16> BonePalette;
+
+	// Per-morph-target delta tables for the growth mesh. Indices into this
+	// are stable for as long as the asset isn't regenerated.
+	TArray<FNeoFurMorphTargetDeltas> MorphTargetDeltas;
+
+	// Returns the index into MorphTargetDeltas for the growth mesh morph
+	// target with this name, or INDEX_NONE if it doesn't move any fur
+	// vertices.
+	int32 FindMorphTargetDeltas(FName MorphTargetName) const;
+
     // Generated from spline data in the FBX file.
     TArray< TArray<FVector> > SplineLines;
 
     void Serialize(FArchive &Ar) override;
+    void PostLoad() override;
+    void BeginDestroy() override;
+
+	// Game thread. Returns the render resources shared by every scene
+	// proxy using this asset, creating them the first time around. The
+	// caller should take its own reference before the asset could go
+	// away.
+	FNeoFurAssetRenderResources *GetRenderResources();
 
 #if WITH_EDITOR
     void PostEditChangeProperty(FPropertyChangedEvent &PropertyChangedEvent) override;
@@ -94,7 +136,73 @@ public:
 
 private:
 
+	// Brings the generated data up to date with the growth mesh, spline
+	// data and settings. Does nothing if none of those changed since the
+	// data was built, and pulls it from the derived data cache if they
+	// match something built before.
     void RegenerateFromSkeletalMesh();
+
+	// Builds the generated data from scratch.
+	void BuildDerivedData();
+
+#if WITH_EDITOR
+	// Derived data cache key for everything RegenerateFromSkeletalMesh()
+	// reads.
+	FString GetDerivedDataKey() const;
+
+	// Reads or writes everything that RegenerateFromSkeletalMesh()
+	// generates, for the derived data cache.
+	void SerializeDerivedData(FArchive &Ar);
+#endif
+
+	// GetDerivedDataKey() for the data we have now, or empty if we don't
+	// know where it came from.
+	FString DerivedDataKey;
+
+	// The guide splines as they came out of the spline data file, before
+	// SplineTransform, stored flat: each line is the next
+	// SplineSourceLineLengths[i] points of SplineSourcePoints.
+	// SplineSourceHash is the SHA-1 of the file they came from, so the FBX
+	// only gets parsed again when the file actually changes.
+	FString SplineSourceHash;
+	TArray<FVector> SplineSourcePoints;
+	TArray<int32> SplineSourceLineLengths;
+
+#if WITH_EDITOR
+	// Reloads the source splines from the file at FullPath if it doesn't
+	// match SplineSourceHash. Returns false if the file couldn't be read
+	// and there's no cached data either, in which case SplineLines should
+	// be left alone.
+	bool UpdateSplineSource(const FString &FullPath);
+#endif
+
+	// Rebuilds SplineLines from the source splines and SplineTransform.
+	void BuildSplineLinesFromSource();
+
+	// Reads or writes the cooked layout, which replaces everything after
+	// the version number in cooked packages.
+	void SerializeCooked(FArchive &Ar);
+	FByteBulkData CookedBulkData;
+
+	// Remaps Vertices[].InfluenceBones from skeleton bone indices to a
+	// dense palette of just the referenced bones, and fills in
+	// BonePalette. Must only be run on skeleton-indexed vertex data.
+	void BuildBonePalette();
+
+	// Fills in MorphTargetDeltas from the skeletal mesh's morph targets.
+	// Must be run after the vertex data and OriginalIndexToNewIndexMapping
+	// are final.
+	void BuildMorphTargetDeltas();
+	void BuildMorphTargetDeltaIndices();
+
+	// MorphTargetDeltas index by morph target name.
+	TMap<FName, int32> MorphTargetDeltaIndices;
+
+	// Drops our reference to the shared render resources. Proxies that
+	// already have them keep them alive until they're done.
+	void ReleaseRenderResources();
+
+	FNeoFurAssetRenderResources *RenderResources;
     
 };
 
@@ -98,6 +98,13 @@ public:
 	UPROPERTY(EditAnywhere, Category = "NeoFur")
     float ActiveShellCountScale;
 
+	// Push the fur out of the spheres and capsules in the physics asset of
+	// the skeletal mesh we're attached to. With this on, the angle clamp
+	// can usually be loosened, or turned off by setting it to 180. The
+	// distance clamp can be turned off by setting it to zero.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "NeoFurPhysics")
+	bool bCollideWithPhysicsAsset;
+
 	// Debugging features
 	// ------------------------------------------------------------------------
 	
@@ -110,14 +117,20 @@ public:
 	UPROPERTY(EditAnywhere, Category = "NeoFurDebug")
 	bool bSkipRendering;
 
+#if WITH_EDITORONLY_DATA
+	// Draws the asset's guide splines. Spline data isn't cooked, so this
+	// only exists in builds that load uncooked assets.
 	UPROPERTY(EditAnywhere, Category = "NeoFurDebug")
 	bool bDrawSplines;
+#endif
 	
 	// USceneComponent stuff
 	// ------------------------------------------------------------------------
 
 	// FIXME: Maybe we should use PostPhysicsTick() instead?
 	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction *ThisTickFunction) override;
+	virtual void OnRegister() override;
+	virtual void OnUnregister() override;
 	
 	virtual void AddRadialForce(FVector Origin, float Radius, float Strength, enum ERadialImpulseFalloff Falloff, bool bAccelChange = false) override;
 	virtual void AddRadialImpulse(FVector Origin, float Radius, float Strength, enum ERadialImpulseFalloff Falloff, bool bAccelChange = false) override;
@@ -135,6 +148,28 @@ public:
 
 	UFUNCTION(BlueprintCallable, Category = "NeoFurDebug", meta = (WorldContext = "WorldContextObject"))
 	static int32 GetTotalActiveShellCount(UObject *WorldContextObject);
+
+	// Time spent simulating fur since startup, in every world, on the
+	// render thread and the CPU simulation tasks. Take the difference
+	// between two calls for what happened in between. The render thread
+	// runs a frame behind, so this lags the game thread by a frame.
+	static double GetTotalSimulationSeconds();
+
+	// Forces that push on all the fur they overlap, for one frame. Call
+	// these every frame for a force that lasts.
+	UFUNCTION(BlueprintCallable, Category = "NeoFurPhysics", meta = (WorldContext = "WorldContextObject"))
+	static void AddFurRadialForce(UObject *WorldContextObject, FVector Origin, float Radius, float Strength);
+
+	UFUNCTION(BlueprintCallable, Category = "NeoFurPhysics", meta = (WorldContext = "WorldContextObject"))
+	static void AddFurDirectionalForce(UObject *WorldContextObject, FVector Origin, float Radius, FVector Direction, float Strength);
+
+	UFUNCTION(BlueprintCallable, Category = "NeoFurPhysics", meta = (WorldContext = "WorldContextObject"))
+	static void AddFurVortexForce(UObject *WorldContextObject, FVector Origin, float Radius, FVector Axis, float Strength);
+
+	// Sets the total number of shells drawn and control points simulated
+	// for all the fur in the world. Zero means no limit.
+	UFUNCTION(BlueprintCallable, Category = "NeoFur", meta = (WorldContext = "WorldContextObject"))
+	static void SetFurBudget(UObject *WorldContextObject, int32 MaxShells, int32 MaxSimulatedControlPoints);
 	
 #if ENGINE_MINOR_VERSION >= 15
 	virtual void GetUsedMaterials(TArray<UMaterialInterface*>& OutMaterials, bool bGetDebugMaterials = false) const override;
@@ -142,12 +177,54 @@ public:
 
 private:
 
+	friend class FNeoFurBudgetManager;
+
+	// Called by the world's fur budget manager with this frame's shell
+	// count, fade and simulation rate, whether to simulate at all, and
+	// whether the fur is close enough to need a proxy.
+	void ApplyBudgetedLOD(int32 NewActiveShellCount, float NewShellFade, int32 NewRateDivisor, bool bNewSimulate, bool bNewInRange);
+	bool bHasBudgetedLOD;
+	bool bBudgetedInRange;
+	float BudgetedShellFade;
+	int32 SimulationRateDivisor;
+	bool bSimulationCulled;
+	bool bSimulationNeedsWarmUp;
+
+	// One sphere or capsule from the parent's physics asset, in the space
+	// of the bone it's attached to.
+	struct FCollisionBody
+	{
+		int32 BoneIndex;
+		FNeoFurCollisionShape Shape;
+	};
+
+	// Rebuilds CollisionBodies if the parent's physics asset or mesh
+	// changed since last time.
+	void UpdateCollisionBodies(USkinnedMeshComponent *Parent);
+	TArray<FCollisionBody> CollisionBodies;
+	TWeakObjectPtr<UPhysicsAsset> CollisionBodiesPhysicsAsset;
+	TWeakObjectPtr<USkeletalMesh> CollisionBodiesMesh;
+
 	USkinnedMeshComponent *FindSkinnedMeshParent() const;
 	UStaticMeshComponent *FindStaticMeshParent() const;
+
+	// How far the fur can get from the mesh, for bounds and collision.
+	float GetMaxStretchDistance() const;
+
 	FTransform LastFrameTransform;
 
 	FNeoFurFramePhysicsInputs AccumulatedForces;
 
+	// Forces sent to this component in particular since last tick, in
+	// component space.
+	TArray<FNeoFurForceField> ComponentForces;
+
+	// Sum of the active morph target deltas for every fur vertex. Kept
+	// between frames so that only the vertices the morph targets touch
+	// have to be cleared, which are the ones in MorphDeltaDirtyVertices.
+	TArray<FNeoFurComponentSceneProxy::MorphDataVertexType> MorphDeltaBuffer;
+	TArray<int32> MorphDeltaDirtyVertices;
+
 
 };
 
@@ -20,6 +20,7 @@
 #include "NeoFurComponentSceneProxy.generated.h"
 
 class UNeoFurAsset;
+class FNeoFurForceFieldRegistry;
 
 const float NeoFurPhysicsParameters_Default_VelocityInfluence            = 1.0f;
 const float NeoFurPhysicsParameters_Default_SpringLengthStiffness        = 250.0f;
@@ -64,9 +65,13 @@ struct FNeoFurPhysicsParameters
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "NeoFur Physics", meta = (ClampMin = "0.0", ClampMax = "1.0"))
 	float AirResistanceMultiplier;
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "NeoFur Physics", meta = (ClampMin = "1.0"))
+	// How far the fur can stretch, as a multiple of its length. Zero turns
+	// the clamp off.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "NeoFur Physics", meta = (ClampMin = "0.0"))
 	float MaxStretchDistanceMultiplier;
 	
+	// How far the fur can swing away from its rest direction, in degrees.
+	// 180 turns the clamp off.
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "NeoFur Physics", meta = (ClampMin = "0.0", ClampMax = "180.0"))
 	float MaxRotationFromNormal;
 
@@ -116,23 +121,84 @@ struct FNeoFurPhysicsParameters
 	}
 };
 
-const int32 NeoFurFramePhysicsInputsNumLocalForces = 4;
-struct FNeoFurFramePhysicsInputs
+// One force pushing on fur for one frame. Radial, directional and
+// vortex forces all come down to the same math, so every force is some
+// mix of the three. For a control point at Offset from Origin, inside
+// Radius:
+//
+//   Velocity += ((Offset * RadialScale + Axis x Offset) / |Offset| + Direction)
+//               * Strength * (1 - |Offset| / Radius)
+//
+// If this structure changes, update the PHYSICSPARAMETERS_FORCES_*
+// offsets in NeoFurComputeShader.usf.
+struct FNeoFurForceField
 {
-	struct {
-		FVector Origin;
-		float Radius;
-		float Strength;
-	} LocalForces[NeoFurFramePhysicsInputsNumLocalForces];
+	FVector Origin;
+	float Radius;
+	float Strength;
+	float RadialScale;
+	FVector Direction;
+	FVector Axis;
+
+	// Pushes away from Origin.
+	static FNeoFurForceField Radial(const FVector &Origin, float Radius, float Strength)
+	{
+		FNeoFurForceField Force = { Origin, Radius, Strength, 1.0f, FVector::ZeroVector, FVector::ZeroVector };
+		return Force;
+	}
 
+	// Pushes along Direction everywhere inside the radius.
+	static FNeoFurForceField Directional(const FVector &Origin, float Radius, const FVector &Direction, float Strength)
+	{
+		FNeoFurForceField Force = { Origin, Radius, Strength, 0.0f, Direction.GetSafeNormal(), FVector::ZeroVector };
+		return Force;
+	}
+
+	// Swirls around Axis, counterclockwise looking down it.
+	static FNeoFurForceField Vortex(const FVector &Origin, float Radius, const FVector &Axis, float Strength)
+	{
+		FNeoFurForceField Force = { Origin, Radius, Strength, 0.0f, FVector::ZeroVector, Axis.GetSafeNormal() };
+		return Force;
+	}
+
+	FNeoFurForceField TransformBy(const FTransform &Transform) const
+	{
+		FNeoFurForceField Result = *this;
+		Result.Origin = Transform.TransformPosition(Origin);
+		Result.Direction = Transform.TransformVectorNoScale(Direction);
+		Result.Axis = Transform.TransformVectorNoScale(Axis);
+		return Result;
+	}
+};
+
+// A capsule the fur gets pushed out of, usually one of the bodies in the
+// owner's physics asset. A sphere is a capsule with both ends in the same
+// place.
+//
+// If this structure changes, update the PHYSICSPARAMETERS_COLLISION_*
+// offsets in NeoFurComputeShader.usf.
+struct FNeoFurCollisionShape
+{
+	FVector Start;
+	FVector End;
+	float Radius;
+
+	// Bounds of everything inside the shape.
+	FBox GetBox() const
+	{
+		FBox Box(Start, Start);
+		Box += End;
+		return Box.ExpandBy(Radius);
+	}
+};
+
+struct FNeoFurFramePhysicsInputs
+{
 	FVector WindVector;
 	float WindGustsAmount;
-	int32 NumForcesThisFrame;
 
 	FNeoFurFramePhysicsInputs()
 	{
-		NumForcesThisFrame = 0;
-		memset(LocalForces, 0, sizeof(LocalForces));
 		WindVector = FVector(0.0f, 0.0f, 0.0f);
 		WindGustsAmount = 0.0f;
 	}
@@ -170,15 +236,14 @@ public:
 	virtual FPrimitiveViewRelevance GetViewRelevance(const FSceneView* View) /* override */ ;
 	
 
-	// These functions handle initial buffer creation, and copying of
-	// skinning data from the parent skinned mesh's vertex buffer.
-	typedef struct FNeoFurComponentSceneProxyGenerateCommand FNeoFurComponentSceneProxyGenerateCommand;
+	// These functions handle initial buffer creation. GenerateBuffers()
+	// kicks off building the CPU-side data on a worker task, and
+	// FinishGenerateBuffers_Renderthread() creates the RHI buffers from it
+	// once it's done. Returns false until everything is ready.
 	void GenerateBuffers(UNeoFurAsset *FurAsset);
+	bool FinishGenerateBuffers_Renderthread();
 
-	void GenerateBuffers_Renderthread_CPU(
-		FRHICommandListImmediate &RHICmdList,
-		FNeoFurComponentSceneProxyGenerateCommand *Command);
-
+	// Zero hides the fur without getting rid of the proxy.
 	void SetActiveShellCount(int32 NewActiveShellCount, float ShellFade);
 	void SetShellDistance(float InDistance);
     void SetVisibleLengthScale(float InVisibleLengthScale);
@@ -187,39 +252,147 @@ public:
 	{
 		FVector Offset;
 		FVector Normal;
+
+		friend FArchive& operator<<(FArchive& Ar, MorphDataVertexType& V)
+		{
+			Ar << V.Offset;
+			Ar << V.Normal;
+			return Ar;
+		}
 	};
 
-	// Note: This takes ownership of BoneMats and delete[]s it in the render
-	// thread.
-	void RunSimulation(
-		const FTransform &RelativeTransformSinceLastFrame,
-		float DeltaTime,
-		const FVector &LocalSpaceGravity,
-		FMatrix *BoneMats, int32 NumBoneMats,
-		MorphDataVertexType *IncomingMorphData);
+	// One entry in the asset's bone palette, as uploaded for skinning.
+	// Bone transforms never have a projection part, so only the first
+	// three columns of the FMatrix are kept, stored transposed so that
+	// each row produces one component of the output. If this layout
+	// changes, update the bone matrix reads in NeoFurComputeShader.usf.
+	struct BoneMatrixType
+	{
+		float M[3][4];
+
+		void SetMatrix(const FMatrix &Matrix)
+		{
+			for(int32 Row = 0; Row < 3; Row++) {
+				for(int32 Column = 0; Column < 4; Column++) {
+					M[Row][Column] = Matrix.M[Column][Row];
+				}
+			}
+		}
+
+		FMatrix ToMatrix() const
+		{
+			FMatrix Result;
+			for(int32 Row = 0; Row < 4; Row++) {
+				for(int32 Column = 0; Column < 3; Column++) {
+					Result.M[Row][Column] = M[Column][Row];
+				}
+				Result.M[Row][3] = Row == 3 ? 1.0f : 0.0f;
+			}
+			return Result;
+		}
+	};
+
+	// Everything the game thread hands over to the render thread for one
+	// frame of simulation. The proxy owns a small ring of these that get
+	// reused, so once the arrays have grown to size, ticking fur doesn't
+	// touch the heap.
+	struct SimulationParamsType
+	{
+		FTransform RelativeTransformSinceLastFrame;
+		float DeltaTime;
+		FVector LocalSpaceGravity;
+
+		// Each simulation step is this many base steps long. See
+		// NEOFUR_SIMULATION_STEP_RATE.
+		int32 RateDivisor;
+
+		// Extra steps to run on top of the normal ones, to settle the
+		// springs after the simulation was culled. They're spread over
+		// the next few frames, within NEOFUR_SIMULATION_MAX_STEPS_PER_FRAME.
+		int32 WarmUpSteps;
+
+		// Indexed by the fur asset's bone palette, not by the skeleton.
+		// Empty for fur that isn't attached to a skinned mesh.
+		TArray<BoneMatrixType> BoneMats;
+
+		// One entry per fur vertex, or empty if no morph targets are active.
+		TArray<MorphDataVertexType> MorphData;
+
+		// Every force that reaches this component, in component space.
+		TArray<FNeoFurForceField> Forces;
+
+		// Bodies to push the fur out of, in component space.
+		TArray<FNeoFurCollisionShape> CollisionShapes;
+
+		// Set by the game thread when this is queued, cleared by the render
+		// thread when it's done with it.
+		FThreadSafeBool bInUse;
+
+		// The game thread fills in a block with these. None of them touch
+		// the heap once the block's arrays have grown to size.
+
+		// Empty the arrays for a new frame, keeping their memory.
+		void Reset();
+
+		// Skinning matrices for the bones in the asset's bone palette. Bones
+		// the skeleton doesn't have get identity.
+		void SetBoneMats(
+			const TArray<uint16> &BonePalette,
+			const TArray<FMatrix> &RefBasesInvMatrix,
+			const TArray<FTransform> &SpaceBases);
+
+		// MorphDeltas has one entry per fur vertex.
+		void SetMorphData(const TArray<MorphDataVertexType> &MorphDeltas);
+
+		// Shape is in the space of a bone, and ToComponent takes it from
+		// there to component space.
+		void AddCollisionShape(const FNeoFurCollisionShape &Shape, const FTransform &ToComponent);
+
+		// Forces sent straight to the component, and anything in the world
+		// that reaches Bounds. ForceFields can be null.
+		void AddForces(
+			const TArray<FNeoFurForceField> &ComponentForces,
+			FNeoFurForceFieldRegistry *ForceFields,
+			const FBox &Bounds,
+			const FTransform &WorldToComponent);
+	};
+
+	// Get the next parameter block for the game thread to fill in. Returns
+	// nullptr if the render thread has fallen so far behind that it's still
+	// using all of them, in which case this frame's simulation should be
+	// skipped. The block isn't claimed until it's passed to RunSimulation(),
+	// so it's fine to bail out after calling this.
+	SimulationParamsType *GetNextSimulationParams();
+
+	// Queue up a simulation step. Params must come from
+	// GetNextSimulationParams(), and belongs to the render thread after
+	// this.
+	void RunSimulation(SimulationParamsType *Params);
 		
 	void RunSimulation_Renderthread(
 		FRHICommandListImmediate &RHICmdList,
-		const FTransform &RelativeTransformSinceLastFrame,
-		float DeltaTime,
-		const FVector &LocalSpaceGravity,
-		FMatrix *BoneMats, int32 NumBoneMats,
-		MorphDataVertexType *IncomingMorphData);
-
-	void RunSimulation_Renderthread_CPU(
-		const FTransform &RelativeTransformSinceLastFrame,
-		float DeltaTime,
-		const FVector &LocalSpaceGravity,
-		FMatrix *BoneMats,
-		MorphDataVertexType *IncomingMorphData);
+		SimulationParamsType *Params);
+
+	// Kicks off the CPU simulation as task-graph jobs and returns
+	// without waiting for them. Params is released back to the game
+	// thread once the jobs are finished. Params->Forces are left out
+	// unless bApplyForces is set.
+	void RunSimulation_Renderthread_CPU(SimulationParamsType *Params, bool bApplyForces);
+
+	// Waits for any CPU simulation jobs in flight, uploads the result
+	// to the GPU control point buffer and flips the double buffer.
+	// Does nothing if there's nothing in flight.
+	void FinishSimulation_Renderthread_CPU() const;
 		
 #if !NEOFUR_NO_COMPUTE_SHADERS
 	void RunSimulation_Renderthread_GPU(
 		const FTransform &RelativeTransformSinceLastFrame,
 		float DeltaTime,
 		const FVector &LocalSpaceGravity,
-		FMatrix *BoneMats, int32 NumBoneMats,
-		MorphDataVertexType *IncomingMorphData,
+		const BoneMatrixType *BoneMats, int32 NumBoneMats,
+		const MorphDataVertexType *IncomingMorphData,
+		const FNeoFurForceField *Forces, int32 NumForces,
+		const FNeoFurCollisionShape *CollisionShapes, int32 NumCollisionShapes,
 		FRHICommandListImmediate &RHICmdList);
 #endif
 
@@ -316,10 +489,6 @@ public:
 		// scene proxy, because we use some of the UV channels to give
 		// information about which shell layer we're on.
 		FVector2D UVs[MAX_TEXCOORDS];
-
-		// HTML5 doesn't support SV_VertexID and mobile supports it
-		// only sometimes.
-		float VertexID;
 	};
 	
 	// This structure has decoding and encoding code in
@@ -344,11 +513,9 @@ private:
 	// Needs vertex buffers to be initialized before calling.
 	uint32 GetControlPointCount() const;
 
-	// Fur will twitch if frame times are erratic, so we need to have
-	// some tolerance for the occasional frame time spike.
-	#define NeoFurFrameTimeSmoothingFrames 30
-	float PreviousFrameTimes[NeoFurFrameTimeSmoothingFrames];
-	int32 FrameTimeIndex;
+	// Game thread side of the simulation parameter handoff.
+	SimulationParamsType SimulationParamsRing[NEOFUR_SIMULATION_PARAMS_RING_SIZE];
+	int32 SimulationParamsRingIndex;
 
     FNeoFurProxyPrivateData *PrivateData;
     
@@ -3,6 +3,7 @@
 #include "SweetDreams.h"
 #include "MainCharacter.h"
 #include "CustomCharacterMovementComponent.h"
+#include "GravityAvoidanceManager.h"
 
 #include "GameFramework/GameNetworkManager.h"
 #include "Navigation/PathFollowingComponent.h" // @todo Epic: this is here only due to circular dependency to AIModule.
@@ -68,6 +69,80 @@ UCustomCharacterMovementComponent::UCustomCharacterMovementComponent(const FObje
 	GravityPoint = FVector::ZeroVector;
 	OldGravityPoint = GravityPoint;
 	OldGravityScale = GravityScale;
+
+	bUseGravityAvoidance = false;
+	AvoidanceRadius = 0.0f;
+	AvoidanceQueryRadius = 300.0f;
+	AvoidanceTimeHorizon = 1.5f;
+	AvoidanceCollisionWeight = 1.0f;
+	AvoidanceDesiredVelocity = FVector::ZeroVector;
+	AvoidanceVelocityDelta = FVector::ZeroVector;
+	bHasAvoidanceVelocity = false;
+}
+
+void UCustomCharacterMovementComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (bUseGravityAvoidance)
+	{
+		FGravityAvoidanceManager* AvoidanceManager = FGravityAvoidanceManager::Get(GetWorld());
+		if (AvoidanceManager != nullptr)
+		{
+			AvoidanceManager->RegisterAgent(this);
+		}
+	}
+}
+
+void UCustomCharacterMovementComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	FGravityAvoidanceManager* AvoidanceManager = FGravityAvoidanceManager::Find(GetWorld());
+	if (AvoidanceManager != nullptr)
+	{
+		AvoidanceManager->UnregisterAgent(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UCustomCharacterMovementComponent::CalcVelocity(float DeltaTime, float Friction, bool bFluid, float BrakingDeceleration)
+{
+	if (bUseGravityAvoidance && IsMovingOnGround())
+	{
+		// The desired velocity comes from the input, not from Velocity. Velocity still carries last frame's
+		// steering, so the next solve would take that as desired and steer on top of it again.
+		FVector DesiredVelocity = FVector::ZeroVector;
+		if (bHasRequestedVelocity)
+		{
+			DesiredVelocity = RequestedVelocity;
+		}
+		else if (!Acceleration.IsNearlyZero())
+		{
+			DesiredVelocity = Acceleration.GetSafeNormal() * (GetMaxSpeed() * AnalogInputModifier);
+		}
+
+		AvoidanceDesiredVelocity = DesiredVelocity;
+
+		// Steering was solved last frame from the previous desired velocity; only apply it while still moving.
+		// It redirects the input, so acceleration and friction still apply as usual.
+		if (bHasAvoidanceVelocity && !DesiredVelocity.IsNearlyZero())
+		{
+			const FVector SteeredVelocity = (DesiredVelocity + AvoidanceVelocityDelta).GetClampedToMaxSize(GetMaxSpeed());
+
+			if (bHasRequestedVelocity)
+			{
+				RequestedVelocity = SteeredVelocity;
+			}
+			else
+			{
+				const float SpeedScale = FMath::Min(SteeredVelocity.Size() / DesiredVelocity.Size(), 1.0f);
+				Acceleration = SteeredVelocity.GetSafeNormal() * (Acceleration.Size() * SpeedScale);
+				AnalogInputModifier *= SpeedScale;
+			}
+		}
+	}
+
+	Super::CalcVelocity(DeltaTime, Friction, bFluid, BrakingDeceleration);
 }
 
 bool UCustomCharacterMovementComponent::DoJump(bool bReplayingMoves)
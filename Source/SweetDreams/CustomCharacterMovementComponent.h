@@ -759,6 +759,70 @@ public:
 	*/
 	virtual void UpdateComponentRotation();
 
+public:
+	/** Registers with the gravity avoidance manager if needed. */
+	virtual void BeginPlay() override;
+
+	/** Unregisters from the gravity avoidance manager. */
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/**
+	* Compute new velocity; if gravity avoidance is enabled, steer it around nearby agents.
+	*/
+	virtual void CalcVelocity(float DeltaTime, float Friction, bool bFluid, float BrakingDeceleration) override;
+
+public:
+	/**
+	* If true, steer around other characters within the plane perpendicular to gravity while walking.
+	* @see FGravityAvoidanceManager
+	*/
+	UPROPERTY(Category = "Custom Character Movement|Avoidance", BlueprintReadOnly, EditAnywhere)
+		uint32 bUseGravityAvoidance : 1;
+
+	/**
+	* Radius used for avoidance; if zero, the capsule radius is used.
+	*/
+	UPROPERTY(Category = "Custom Character Movement|Avoidance", BlueprintReadWrite, EditAnywhere, meta = (ClampMin = "0", UIMin = "0"))
+		float AvoidanceRadius;
+
+	/**
+	* Other characters further away than this are ignored by avoidance.
+	*/
+	UPROPERTY(Category = "Custom Character Movement|Avoidance", BlueprintReadWrite, EditAnywhere, meta = (ClampMin = "0", UIMin = "0"))
+		float AvoidanceQueryRadius;
+
+	/**
+	* Collisions predicted further in the future than this (in seconds) are ignored by avoidance.
+	*/
+	UPROPERTY(Category = "Custom Character Movement|Avoidance", BlueprintReadWrite, EditAnywhere, meta = (ClampMin = "0", UIMin = "0"))
+		float AvoidanceTimeHorizon;
+
+	/**
+	* How strongly avoidance prefers avoiding collisions over keeping the desired velocity.
+	*/
+	UPROPERTY(Category = "Custom Character Movement|Avoidance", BlueprintReadWrite, EditAnywhere, meta = (ClampMin = "0", UIMin = "0"))
+		float AvoidanceCollisionWeight;
+
+protected:
+	/**
+	* Velocity the input or path following asks for before avoidance, read by the avoidance manager.
+	*/
+	FVector AvoidanceDesiredVelocity;
+
+protected:
+	/**
+	* Steering computed by the avoidance manager, applied on top of the desired velocity.
+	*/
+	FVector AvoidanceVelocityDelta;
+
+protected:
+	/**
+	* If true, AvoidanceVelocityDelta is valid.
+	*/
+	uint32 bHasAvoidanceVelocity : 1;
+
+	friend class FGravityAvoidanceManager;
+
 
 
 
@@ -0,0 +1,340 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SweetDreams.h"
+#include "CustomCharacterMovementComponent.h"
+#include "GravityAvoidanceManager.h"
+
+#include "Async/ParallelFor.h"
+
+DECLARE_CYCLE_STAT(TEXT("Gravity Avoidance"), STAT_GravityAvoidance, STATGROUP_Character);
+
+namespace GravityAvoidanceStatics
+{
+	/** Maximum number of neighbors considered per agent; the closest ones are kept. */
+	static const int32 MaxNeighbors = 10;
+
+	/** Candidate velocity directions, as angles in degrees from the desired direction. */
+	static const float SampleAngles[] = { 0.0f, 20.0f, -20.0f, 45.0f, -45.0f, 70.0f, -70.0f, 100.0f, -100.0f, 180.0f };
+
+	/** Candidate speeds, as fractions of the desired speed. */
+	static const float SampleSpeeds[] = { 1.0f, 0.6f, 0.25f };
+
+	/** Avoidance managers of all game worlds. */
+	static TMap<TWeakObjectPtr<UWorld>, TSharedPtr<FGravityAvoidanceManager>> Managers;
+
+	static FDelegateHandle PostActorTickHandle;
+	static FDelegateHandle WorldCleanupHandle;
+
+	/** Neighbor state projected onto the gravity tangent plane of the agent being solved. */
+	struct FNeighbor
+	{
+		FVector2D Position;
+		FVector2D Velocity;
+		float CombinedRadius;
+		float DistanceSquared;
+		bool bReciprocal;
+	};
+
+	/**
+	* Return the time until a disc moving with relative velocity V starting at relative position P touches
+	* the origin with combined radius R, or BIG_NUMBER if it never does.
+	*/
+	FORCEINLINE float TimeToCollision(const FVector2D& P, const FVector2D& V, float R)
+	{
+		const float DistSq = P.SizeSquared();
+		const float PdotV = P | V;
+		const float RSq = R * R;
+
+		if (DistSq <= RSq)
+		{
+			// Already overlapping; only penalize getting closer.
+			return (PdotV > 0.0f) ? KINDA_SMALL_NUMBER : BIG_NUMBER;
+		}
+
+		const float VSq = V.SizeSquared();
+		if (VSq <= KINDA_SMALL_NUMBER || PdotV <= 0.0f)
+		{
+			return BIG_NUMBER;
+		}
+
+		const float Discriminant = PdotV * PdotV - VSq * (DistSq - RSq);
+		if (Discriminant < 0.0f)
+		{
+			return BIG_NUMBER;
+		}
+
+		return (PdotV - FMath::Sqrt(Discriminant)) / VSq;
+	}
+}
+
+
+FGravityAvoidanceManager* FGravityAvoidanceManager::Get(UWorld* World)
+{
+	using namespace GravityAvoidanceStatics;
+
+	if (World == nullptr || !World->IsGameWorld())
+	{
+		return nullptr;
+	}
+
+	if (!PostActorTickHandle.IsValid())
+	{
+		PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddStatic(&FGravityAvoidanceManager::OnWorldPostActorTick);
+		WorldCleanupHandle = FWorldDelegates::OnWorldCleanup.AddStatic(&FGravityAvoidanceManager::OnWorldCleanup);
+	}
+
+	TSharedPtr<FGravityAvoidanceManager>& Manager = Managers.FindOrAdd(World);
+	if (!Manager.IsValid())
+	{
+		Manager = MakeShareable(new FGravityAvoidanceManager());
+		Manager->CellSize = 1.0f;
+		Manager->LastTickSeconds = 0.0;
+	}
+
+	return Manager.Get();
+}
+
+FGravityAvoidanceManager* FGravityAvoidanceManager::Find(UWorld* World)
+{
+	const TSharedPtr<FGravityAvoidanceManager>* Manager = GravityAvoidanceStatics::Managers.Find(World);
+	return (Manager != nullptr) ? Manager->Get() : nullptr;
+}
+
+void FGravityAvoidanceManager::OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	FGravityAvoidanceManager* Manager = Find(World);
+	if (Manager != nullptr && TickType != LEVELTICK_ViewportsOnly && !World->IsPaused())
+	{
+		Manager->Tick(DeltaSeconds);
+	}
+}
+
+void FGravityAvoidanceManager::OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources)
+{
+	GravityAvoidanceStatics::Managers.Remove(World);
+}
+
+void FGravityAvoidanceManager::RegisterAgent(UCustomCharacterMovementComponent* Agent)
+{
+	Agents.AddUnique(Agent);
+}
+
+void FGravityAvoidanceManager::UnregisterAgent(UCustomCharacterMovementComponent* Agent)
+{
+	Agents.RemoveSwap(Agent);
+}
+
+void FGravityAvoidanceManager::Tick(float DeltaSeconds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_GravityAvoidance);
+	LastTickSeconds = 0.0;
+	FSimpleScopeSecondsCounter ScopeTime(LastTickSeconds);
+
+	Agents.RemoveAllSwap([](const TWeakObjectPtr<UCustomCharacterMovementComponent>& Agent) { return !Agent.IsValid(); });
+
+	const int32 NumAgents = Agents.Num();
+	Snapshot.SetNumUninitialized(NumAgents, false);
+	Results.SetNumUninitialized(NumAgents, false);
+
+	// Gather state on the game thread.
+	float MaxQueryRadius = 1.0f;
+	for (int32 AgentIndex = 0; AgentIndex < NumAgents; ++AgentIndex)
+	{
+		const UCustomCharacterMovementComponent* Movement = Agents[AgentIndex].Get();
+		const ACharacter* Character = Movement->GetCharacterOwner();
+		FAgent& Agent = Snapshot[AgentIndex];
+
+		Agent.Location = Movement->UpdatedComponent ? Movement->UpdatedComponent->GetComponentLocation() : FVector::ZeroVector;
+		Agent.Velocity = Movement->Velocity;
+		Agent.DesiredVelocity = Movement->AvoidanceDesiredVelocity;
+		Agent.Up = -Movement->GetGravityDirection(true);
+		Agent.Radius = Movement->AvoidanceRadius;
+		Agent.HalfHeight = 0.0f;
+		if (Character != nullptr)
+		{
+			float CapsuleRadius, CapsuleHalfHeight;
+			Character->GetCapsuleComponent()->GetScaledCapsuleSize(CapsuleRadius, CapsuleHalfHeight);
+			Agent.Radius = (Agent.Radius > 0.0f) ? Agent.Radius : CapsuleRadius;
+			Agent.HalfHeight = CapsuleHalfHeight;
+		}
+		Agent.QueryRadius = Movement->AvoidanceQueryRadius;
+		Agent.TimeHorizon = FMath::Max(Movement->AvoidanceTimeHorizon, KINDA_SMALL_NUMBER);
+		Agent.CollisionWeight = Movement->AvoidanceCollisionWeight;
+		Agent.MaxSpeed = Movement->GetMaxSpeed();
+		Agent.bActive = Character != nullptr && Character->Role == ROLE_Authority && Movement->IsMovingOnGround();
+
+		MaxQueryRadius = FMath::Max(MaxQueryRadius, Agent.QueryRadius);
+	}
+
+	// Rebuild the spatial hash. Cells are at least as large as any query radius, so every neighbor of an
+	// agent lies in one of the 27 cells around it.
+	CellSize = MaxQueryRadius;
+	for (FAgent& Agent : Snapshot)
+	{
+		Agent.Cell = FIntVector(FMath::FloorToInt(Agent.Location.X / CellSize), FMath::FloorToInt(Agent.Location.Y / CellSize), FMath::FloorToInt(Agent.Location.Z / CellSize));
+	}
+
+	SortedAgents.SetNumUninitialized(NumAgents, false);
+	for (int32 AgentIndex = 0; AgentIndex < NumAgents; ++AgentIndex)
+	{
+		SortedAgents[AgentIndex] = AgentIndex;
+	}
+
+	const TArray<FAgent>& LocalSnapshot = Snapshot;
+	SortedAgents.Sort([&LocalSnapshot](int32 A, int32 B)
+	{
+		const FIntVector& CellA = LocalSnapshot[A].Cell;
+		const FIntVector& CellB = LocalSnapshot[B].Cell;
+		if (CellA.X != CellB.X) return CellA.X < CellB.X;
+		if (CellA.Y != CellB.Y) return CellA.Y < CellB.Y;
+		return CellA.Z < CellB.Z;
+	});
+
+	Cells.Reset();
+	for (int32 SortedIndex = 0; SortedIndex < NumAgents; ++SortedIndex)
+	{
+		const FIntVector& Cell = Snapshot[SortedAgents[SortedIndex]].Cell;
+		FCellRange* Range = Cells.Find(Cell);
+		if (Range != nullptr)
+		{
+			Range->Count++;
+		}
+		else
+		{
+			FCellRange NewRange;
+			NewRange.Start = SortedIndex;
+			NewRange.Count = 1;
+			Cells.Add(Cell, NewRange);
+		}
+	}
+
+	// Solve every agent independently.
+	ParallelFor(NumAgents, [this](int32 AgentIndex)
+	{
+		Results[AgentIndex] = SolveAgent(AgentIndex);
+	});
+
+	// Hand results back to the movement components.
+	for (int32 AgentIndex = 0; AgentIndex < NumAgents; ++AgentIndex)
+	{
+		UCustomCharacterMovementComponent* Movement = Agents[AgentIndex].Get();
+		Movement->AvoidanceVelocityDelta = Results[AgentIndex];
+		Movement->bHasAvoidanceVelocity = Snapshot[AgentIndex].bActive;
+	}
+}
+
+FVector FGravityAvoidanceManager::SolveAgent(int32 AgentIndex) const
+{
+	using namespace GravityAvoidanceStatics;
+
+	const FAgent& Agent = Snapshot[AgentIndex];
+	if (!Agent.bActive)
+	{
+		return FVector::ZeroVector;
+	}
+
+	// Build a 2D basis in the gravity tangent plane, aligned with the desired direction.
+	const FVector PlaneDesired = FVector::VectorPlaneProject(Agent.DesiredVelocity, Agent.Up);
+	const float DesiredSpeed = PlaneDesired.Size();
+	if (DesiredSpeed <= KINDA_SMALL_NUMBER)
+	{
+		return FVector::ZeroVector;
+	}
+
+	const FVector AxisX = PlaneDesired / DesiredSpeed;
+	const FVector AxisY = Agent.Up ^ AxisX;
+	const FVector2D Preferred(DesiredSpeed, 0.0f);
+	const FVector2D Current(Agent.Velocity | AxisX, Agent.Velocity | AxisY);
+
+	// Gather neighbors from the surrounding cells.
+	TArray<FNeighbor, TInlineAllocator<MaxNeighbors * 2>> Neighbors;
+	const float QueryRadiusSq = FMath::Square(Agent.QueryRadius);
+
+	for (int32 DX = -1; DX <= 1; ++DX)
+	{
+		for (int32 DY = -1; DY <= 1; ++DY)
+		{
+			for (int32 DZ = -1; DZ <= 1; ++DZ)
+			{
+				const FCellRange* Range = Cells.Find(Agent.Cell + FIntVector(DX, DY, DZ));
+				if (Range == nullptr)
+				{
+					continue;
+				}
+
+				for (int32 SortedIndex = Range->Start; SortedIndex < Range->Start + Range->Count; ++SortedIndex)
+				{
+					const int32 OtherIndex = SortedAgents[SortedIndex];
+					if (OtherIndex == AgentIndex)
+					{
+						continue;
+					}
+
+					const FAgent& Other = Snapshot[OtherIndex];
+					const FVector Delta = Other.Location - Agent.Location;
+					const float DistSq = Delta.SizeSquared();
+
+					// Skip agents out of range or standing on a different floor.
+					if (DistSq > QueryRadiusSq || FMath::Abs(Delta | Agent.Up) > Agent.HalfHeight + Other.HalfHeight)
+					{
+						continue;
+					}
+
+					FNeighbor Neighbor;
+					Neighbor.Position = FVector2D(Delta | AxisX, Delta | AxisY);
+					Neighbor.Velocity = FVector2D(Other.Velocity | AxisX, Other.Velocity | AxisY);
+					Neighbor.CombinedRadius = Agent.Radius + Other.Radius;
+					Neighbor.DistanceSquared = DistSq;
+					Neighbor.bReciprocal = Other.bActive;
+					Neighbors.Add(Neighbor);
+				}
+			}
+		}
+	}
+
+	if (Neighbors.Num() == 0)
+	{
+		return FVector::ZeroVector;
+	}
+
+	if (Neighbors.Num() > MaxNeighbors)
+	{
+		Neighbors.Sort([](const FNeighbor& A, const FNeighbor& B) { return A.DistanceSquared < B.DistanceSquared; });
+		Neighbors.SetNum(MaxNeighbors, false);
+	}
+
+	// Pick the sampled velocity with the lowest penalty; the penalty grows with the deviation from the desired
+	// velocity and with the inverse of the time to the first collision (reciprocal velocity obstacles).
+	const float CollisionPenaltyScale = Agent.CollisionWeight * FMath::Max(Agent.MaxSpeed, DesiredSpeed);
+	FVector2D BestVelocity = Preferred;
+	float BestPenalty = BIG_NUMBER;
+
+	for (const float SpeedScale : SampleSpeeds)
+	{
+		for (const float Angle : SampleAngles)
+		{
+			float Sin, Cos;
+			FMath::SinCos(&Sin, &Cos, FMath::DegreesToRadians(Angle));
+			const FVector2D Candidate(Cos * DesiredSpeed * SpeedScale, Sin * DesiredSpeed * SpeedScale);
+
+			float MinTime = BIG_NUMBER;
+			for (const FNeighbor& Neighbor : Neighbors)
+			{
+				// Agents that avoid as well take half the responsibility.
+				const FVector2D RelativeVelocity = Neighbor.bReciprocal ? (Candidate * 2.0f - Current - Neighbor.Velocity) : (Candidate - Neighbor.Velocity);
+				MinTime = FMath::Min(MinTime, TimeToCollision(Neighbor.Position, RelativeVelocity, Neighbor.CombinedRadius));
+			}
+
+			const float CollisionPenalty = (MinTime < Agent.TimeHorizon) ? CollisionPenaltyScale / MinTime : 0.0f;
+			const float Penalty = CollisionPenalty + (Candidate - Preferred).Size();
+			if (Penalty < BestPenalty)
+			{
+				BestPenalty = Penalty;
+				BestVelocity = Candidate;
+			}
+		}
+	}
+
+	const FVector2D Delta = BestVelocity - Preferred;
+	return AxisX * Delta.X + AxisY * Delta.Y;
+}
@@ -0,0 +1,109 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+class UCustomCharacterMovementComponent;
+
+/**
+ * RVO-style local avoidance for characters walking on arbitrary-gravity surfaces.
+ * Each agent steers in the plane perpendicular to its own gravity direction. Neighbors are found
+ * through a spatial hash rebuilt every frame, and avoidance velocities are solved in parallel.
+ * Results are consumed by UCustomCharacterMovementComponent::CalcVelocity on the next frame.
+ */
+class SWEETDREAMS_API FGravityAvoidanceManager
+{
+public:
+	/**
+	* Return the avoidance manager of the given world, creating it if needed.
+	*
+	* @param World - World the manager belongs to.
+	* @return Avoidance manager, or null if World isn't a game world.
+	*/
+	static FGravityAvoidanceManager* Get(UWorld* World);
+
+	/**
+	* Return the avoidance manager of the given world, if one was created.
+	*
+	* @param World - World the manager belongs to.
+	* @return Avoidance manager or null.
+	*/
+	static FGravityAvoidanceManager* Find(UWorld* World);
+
+public:
+	/**
+	* Start steering the given movement component around other agents.
+	*
+	* @param Agent - Movement component to register.
+	*/
+	void RegisterAgent(UCustomCharacterMovementComponent* Agent);
+
+	/**
+	* Stop steering the given movement component.
+	*
+	* @param Agent - Movement component to unregister.
+	*/
+	void UnregisterAgent(UCustomCharacterMovementComponent* Agent);
+
+	/** Return the wall time spent solving avoidance during the last tick, in seconds. */
+	FORCEINLINE double GetLastTickSeconds() const { return LastTickSeconds; }
+
+	/** Return the number of registered agents. */
+	FORCEINLINE int32 GetNumAgents() const { return Agents.Num(); }
+
+private:
+	/** Snapshot of an agent's state, taken on the game thread before solving. */
+	struct FAgent
+	{
+		FVector Location;
+		FVector Velocity;
+		FVector DesiredVelocity;
+		FVector Up;
+		FIntVector Cell;
+		float Radius;
+		float HalfHeight;
+		float QueryRadius;
+		float TimeHorizon;
+		float CollisionWeight;
+		float MaxSpeed;
+		bool bActive;
+	};
+
+	/** Range of SortedAgents that falls into a spatial hash cell. */
+	struct FCellRange
+	{
+		int32 Start;
+		int32 Count;
+	};
+
+	/** Snapshot agents, rebuild the spatial hash and solve avoidance for every agent. */
+	void Tick(float DeltaSeconds);
+
+	/**
+	* Solve the avoidance velocity of a single agent. Thread safe; only reads the snapshot.
+	*
+	* @param AgentIndex - Index of the agent in the snapshot.
+	* @return Velocity delta to apply on top of the agent's desired velocity.
+	*/
+	FVector SolveAgent(int32 AgentIndex) const;
+
+	/** Called after all actors ticked in any world. */
+	static void OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+
+	/** Called when a world is cleaned up. */
+	static void OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources);
+
+	/** Registered movement components. */
+	TArray<TWeakObjectPtr<UCustomCharacterMovementComponent>> Agents;
+
+	/** Per-frame state; kept around to reuse allocations. */
+	TArray<FAgent> Snapshot;
+	TArray<int32> SortedAgents;
+	TMap<FIntVector, FCellRange> Cells;
+	TArray<FVector> Results;
+
+	/** Edge length of a spatial hash cell; at least the largest query radius. */
+	float CellSize;
+
+	/** Wall time spent in the last tick. */
+	double LastTickSeconds;
+};
@@ -0,0 +1,116 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SweetDreams.h"
+#include "GravityCharacter.h"
+#include "CustomCharacterMovementComponent.h"
+
+
+AGravityCharacter::AGravityCharacter(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UCustomCharacterMovementComponent>(ACharacter::CharacterMovementComponentName))
+{
+	CustomCharacterMovement = Cast<UCustomCharacterMovementComponent>(GetCharacterMovement());
+
+	// Nothing to do per frame on the actor itself; movement, animation and avoidance tick on their own.
+	// Blueprint subclasses that implement Event Tick turn ticking back on.
+	PrimaryActorTick.bCanEverTick = false;
+}
+
+void AGravityCharacter::ApplyDamageMomentum(float DamageTaken, const FDamageEvent& DamageEvent, APawn* PawnInstigator, AActor* DamageCauser)
+{
+	const UDamageType* DmgTypeCDO = DamageEvent.DamageTypeClass->GetDefaultObject<UDamageType>();
+	const float ImpulseScale = DmgTypeCDO->DamageImpulse;
+
+	UCustomCharacterMovementComponent* CharacterMovement = CustomCharacterMovement;
+	if (ImpulseScale > 3.0f && CharacterMovement != NULL)
+	{
+		FHitResult HitInfo;
+		FVector ImpulseDir;
+		DamageEvent.GetBestHitInfo(this, PawnInstigator, HitInfo, ImpulseDir);
+
+		FVector Impulse = ImpulseDir * ImpulseScale;
+		const bool bMassIndependentImpulse = !DmgTypeCDO->bScaleMomentumByMass;
+
+		// Limit Z momentum added if already going up faster than jump (to avoid blowing character way up into the sky).
+		{
+			FVector MassScaledImpulse = Impulse;
+			if (!bMassIndependentImpulse && CharacterMovement->Mass > SMALL_NUMBER)
+			{
+				MassScaledImpulse = MassScaledImpulse / CharacterMovement->Mass;
+			}
+
+			const FVector AxisZ = GetActorQuat().GetAxisZ();
+			if ((CharacterMovement->Velocity | AxisZ) > GetDefault<UCharacterMovementComponent>(CharacterMovement->GetClass())->JumpZVelocity && (MassScaledImpulse | AxisZ) > 0.0f)
+			{
+				Impulse = FVector::VectorPlaneProject(Impulse, AxisZ) + AxisZ * ((Impulse | AxisZ) * 0.5f);
+			}
+		}
+
+		CharacterMovement->AddImpulse(Impulse, bMassIndependentImpulse);
+	}
+}
+
+FVector AGravityCharacter::GetPawnViewLocation() const
+{
+	return GetActorLocation() + GetActorQuat().GetAxisZ() * BaseEyeHeight;
+}
+
+void AGravityCharacter::PostNetReceiveLocationAndRotation()
+{
+	// Always consider Location as changed if we were spawned this tick as in that case our replicated Location was set as part of spawning, before PreNetReceive().
+	if (ReplicatedMovement.Location == GetActorLocation() && ReplicatedMovement.Rotation == GetActorRotation() && CreationTime != GetWorld()->TimeSeconds)
+	{
+		return;
+	}
+
+	if (Role == ROLE_SimulatedProxy)
+	{
+		const FVector OldLocation = GetActorLocation();
+		const FQuat OldRotation = GetActorQuat();
+		const FQuat NewRotation = ReplicatedMovement.Rotation.Quaternion();
+
+		// Correction to make sure pawn doesn't penetrate floor after replication rounding.
+		ReplicatedMovement.Location += NewRotation.GetAxisZ() * 0.01f;
+
+		SetActorLocationAndRotation(ReplicatedMovement.Location, ReplicatedMovement.Rotation, /*bSweep=*/ false);
+
+		if (CustomCharacterMovement)
+		{
+			CustomCharacterMovement->SmoothCorrection(OldLocation, OldRotation, ReplicatedMovement.Location, NewRotation);
+		}
+	}
+}
+
+void AGravityCharacter::LaunchCharacterRotated(FVector LaunchVelocity, bool bHorizontalOverride, bool bVerticalOverride)
+{
+	UCustomCharacterMovementComponent* CharacterMovement = CustomCharacterMovement;
+	if (CharacterMovement)
+	{
+		if (!bHorizontalOverride && !bVerticalOverride)
+		{
+			CharacterMovement->Launch(GetVelocity() + LaunchVelocity);
+		}
+		else if (bHorizontalOverride && bVerticalOverride)
+		{
+			CharacterMovement->Launch(LaunchVelocity);
+		}
+		else
+		{
+			FVector FinalVel;
+			const FVector Velocity = GetVelocity();
+			const FVector AxisZ = GetActorQuat().GetAxisZ();
+
+			if (bHorizontalOverride)
+			{
+				FinalVel = FVector::VectorPlaneProject(LaunchVelocity, AxisZ) + AxisZ * (Velocity | AxisZ);
+			}
+			else // if (bVerticalOverride)
+			{
+				FinalVel = FVector::VectorPlaneProject(Velocity, AxisZ) + AxisZ * (LaunchVelocity | AxisZ);
+			}
+
+			CharacterMovement->Launch(FinalVel);
+		}
+
+		OnLaunched(LaunchVelocity, bHorizontalOverride, bVerticalOverride);
+	}
+}
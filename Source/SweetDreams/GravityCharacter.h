@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "GameFramework/Character.h"
+#include "GravityCharacter.generated.h"
+
+/**
+ * Base class for characters driven by UCustomCharacterMovementComponent.
+ * Holds the gravity-aware overrides shared by all such characters and a typed pointer to the movement component.
+ */
+UCLASS(abstract)
+class SWEETDREAMS_API AGravityCharacter : public ACharacter
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	* Default UObject constructor; replaces the movement component with UCustomCharacterMovementComponent.
+	*/
+	AGravityCharacter(const FObjectInitializer& ObjectInitializer);
+
+public:
+	/**
+	* Set a pending launch velocity on the Character, relative to its current "up" axis.
+	* @see ACharacter::LaunchCharacter
+	*
+	* @param LaunchVelocity - Velocity to impart to the Character.
+	* @param bHorizontalOverride - If true, replace the velocity perpendicular to "up" instead of adding to it.
+	* @param bVerticalOverride - If true, replace the velocity along "up" instead of adding to it.
+	*/
+	UFUNCTION(Category = "Pawn|CustomCharacter", BlueprintCallable)
+		virtual void LaunchCharacterRotated(FVector LaunchVelocity, bool bHorizontalOverride, bool bVerticalOverride);
+
+	virtual void ApplyDamageMomentum(float DamageTaken, const FDamageEvent& DamageEvent, APawn* PawnInstigator, AActor* DamageCauser) override;
+	virtual FVector GetPawnViewLocation() const override final;
+	virtual void PostNetReceiveLocationAndRotation() override final;
+
+public:
+	/**
+	* Return the custom movement component, without casting.
+	*
+	* @return Custom movement component; null only if a subclass replaced the movement component class.
+	*/
+	FORCEINLINE class UCustomCharacterMovementComponent* GetCustomCharacterMovement() const { return CustomCharacterMovement; }
+
+private:
+	/** Typed copy of the movement component pointer, set once in the constructor. */
+	UPROPERTY(Transient)
+		class UCustomCharacterMovementComponent* CustomCharacterMovement;
+};
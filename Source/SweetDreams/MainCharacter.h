@@ -2,11 +2,11 @@
 
 #pragma once
 
-#include "GameFramework/Character.h"
+#include "GravityCharacter.h"
 #include "MainCharacter.generated.h"
 
 UCLASS()
-class SWEETDREAMS_API AMainCharacter : public ACharacter
+class SWEETDREAMS_API AMainCharacter : public AGravityCharacter
 {
 	GENERATED_BODY()
 
@@ -19,21 +19,10 @@ protected:
 	virtual void BeginPlay() override;
 
 public:	
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
-
 	// Called to bind functionality to input
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 
 	void MoveForward(float Value);
 
 	void MoveRight(float Value);
-
-	UFUNCTION(Category = "Pawn|CustomCharacter", BlueprintCallable)
-		virtual void LaunchCharacterRotated(FVector LaunchVelocity, bool bHorizontalOverride, bool bVerticalOverride);
-
-	virtual void ApplyDamageMomentum(float DamageTaken, const FDamageEvent& DamageEvent, APawn* PawnInstigator, AActor* DamageCauser) override;
-	virtual FVector GetPawnViewLocation() const override;
-	virtual void PostNetReceiveLocationAndRotation() override;
-	FORCEINLINE class UCustomCharacterMovementComponent* GetCustomCharacterMovement() const;
 };
@@ -7,139 +7,56 @@
 
 // Sets default values
 AOgro::AOgro(const FObjectInitializer& ObjectInitializer)
-	: Super(ObjectInitializer.SetDefaultSubobjectClass<UCustomCharacterMovementComponent>(ACharacter::CharacterMovementComponentName))
+	: Super(ObjectInitializer)
 {
- 	// Set this character to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+	// Skip animation frames on distant Ogros, interpolating the skipped ones.
+	AnimUpdateRateScreenSizeThresholds.Add(0.4f);
+	AnimUpdateRateScreenSizeThresholds.Add(0.2f);
+	AnimUpdateRateScreenSizeThresholds.Add(0.1f);
+	bInterpolateSkippedAnimFrames = true;
+	MaxAnimEvalRateForInterpolation = 4;
 
-}
-
-// Called when the game starts or when spawned
-void AOgro::BeginPlay()
-{
-	Super::BeginPlay();
-	
-}
-
-// Called every frame
-void AOgro::Tick(float DeltaTime)
-{
-	Super::Tick(DeltaTime);
-
-}
-
-// Called to bind functionality to input
-void AOgro::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
-{
-	Super::SetupPlayerInputComponent(PlayerInputComponent);
+	GetMesh()->bEnableUpdateRateOptimizations = true;
 
+	// Steer around other Ogros instead of bumping into them.
+	if (GetCustomCharacterMovement())
+	{
+		GetCustomCharacterMovement()->bUseGravityAvoidance = true;
+	}
 }
 
-
-void AOgro::ApplyDamageMomentum(float DamageTaken, const FDamageEvent& DamageEvent, APawn* PawnInstigator, AActor* DamageCauser)
+// Called after all components have been initialized
+void AOgro::PostInitializeComponents()
 {
-	const UDamageType* DmgTypeCDO = DamageEvent.DamageTypeClass->GetDefaultObject<UDamageType>();
-	const float ImpulseScale = DmgTypeCDO->DamageImpulse;
+	Super::PostInitializeComponents();
 
-	UCharacterMovementComponent* CharacterMovement = GetCharacterMovement();
-	if (ImpulseScale > 3.0f && CharacterMovement != NULL)
+	if (GetMesh()->AnimUpdateRateParams != nullptr)
 	{
-		FHitResult HitInfo;
-		FVector ImpulseDir;
-		DamageEvent.GetBestHitInfo(this, PawnInstigator, HitInfo, ImpulseDir);
-
-		FVector Impulse = ImpulseDir * ImpulseScale;
-		const bool bMassIndependentImpulse = !DmgTypeCDO->bScaleMomentumByMass;
-
-		// Limit Z momentum added if already going up faster than jump (to avoid blowing character way up into the sky).
-		{
-			FVector MassScaledImpulse = Impulse;
-			if (!bMassIndependentImpulse && CharacterMovement->Mass > SMALL_NUMBER)
-			{
-				MassScaledImpulse = MassScaledImpulse / CharacterMovement->Mass;
-			}
-
-			const FVector AxisZ = GetActorQuat().GetAxisZ();
-			if ((CharacterMovement->Velocity | AxisZ) > GetDefault<UCharacterMovementComponent>(CharacterMovement->GetClass())->JumpZVelocity && (MassScaledImpulse | AxisZ) > 0.0f)
-			{
-				Impulse = FVector::VectorPlaneProject(Impulse, AxisZ) + AxisZ * ((Impulse | AxisZ) * 0.5f);
-			}
-		}
-
-		CharacterMovement->AddImpulse(Impulse, bMassIndependentImpulse);
+		ConfigureAnimUpdateRate(GetMesh()->AnimUpdateRateParams);
 	}
 }
 
-FVector AOgro::GetPawnViewLocation() const
+void AOgro::ConfigureAnimUpdateRate(FAnimUpdateRateParameters* Params)
 {
-	return GetActorLocation() + GetActorQuat().GetAxisZ() * BaseEyeHeight;
-}
-
-void AOgro::PostNetReceiveLocationAndRotation()
-{
-	// Always consider Location as changed if we were spawned this tick as in that case our replicated Location was set as part of spawning, before PreNetReceive().
-	if (ReplicatedMovement.Location == GetActorLocation() && ReplicatedMovement.Rotation == GetActorRotation() && CreationTime != GetWorld()->TimeSeconds)
+	if (AnimUpdateRateScreenSizeThresholds.Num() > 0)
 	{
-		return;
+		Params->BaseVisibleDistanceFactorThesholds = AnimUpdateRateScreenSizeThresholds;
 	}
 
-	if (Role == ROLE_SimulatedProxy)
-	{
-		const FVector OldLocation = GetActorLocation();
-		const FQuat OldRotation = GetActorQuat();
-		const FQuat NewRotation = ReplicatedMovement.Rotation.Quaternion();
-
-		// Correction to make sure pawn doesn't penetrate floor after replication rounding.
-		ReplicatedMovement.Location += NewRotation.GetAxisZ() * 0.01f;
-
-		SetActorLocationAndRotation(ReplicatedMovement.Location, ReplicatedMovement.Rotation, /*bSweep=*/ false);
-
-		INetworkPredictionInterface* PredictionInterface = Cast<INetworkPredictionInterface>(GetMovementComponent());
-		if (PredictionInterface)
-		{
-			PredictionInterface->SmoothCorrection(OldLocation, OldRotation, ReplicatedMovement.Location, NewRotation);
-		}
-	}
+	Params->bInterpolateSkippedFrames = bInterpolateSkippedAnimFrames;
+	Params->MaxEvalRateForInterpolation = MaxAnimEvalRateForInterpolation;
 }
 
-void AOgro::LaunchCharacterRotated(FVector LaunchVelocity, bool bHorizontalOverride, bool bVerticalOverride)
+// Called when the game starts or when spawned
+void AOgro::BeginPlay()
 {
-
-	UCharacterMovementComponent* CharacterMovement = GetCharacterMovement();
-	if (CharacterMovement)
-	{
-		if (!bHorizontalOverride && !bVerticalOverride)
-		{
-			CharacterMovement->Launch(GetVelocity() + LaunchVelocity);
-		}
-		else if (bHorizontalOverride && bVerticalOverride)
-		{
-			CharacterMovement->Launch(LaunchVelocity);
-		}
-		else
-		{
-			FVector FinalVel;
-			const FVector Velocity = GetVelocity();
-			const FVector AxisZ = GetActorQuat().GetAxisZ();
-
-			if (bHorizontalOverride)
-			{
-				FinalVel = FVector::VectorPlaneProject(LaunchVelocity, AxisZ) + AxisZ * (Velocity | AxisZ);
-			}
-			else // if (bVerticalOverride)
-			{
-				FinalVel = FVector::VectorPlaneProject(Velocity, AxisZ) + AxisZ * (LaunchVelocity | AxisZ);
-			}
-
-			CharacterMovement->Launch(FinalVel);
-		}
-
-		OnLaunched(LaunchVelocity, bHorizontalOverride, bVerticalOverride);
-	}
+	Super::BeginPlay();
+	
 }
 
-FORCEINLINE class UCustomCharacterMovementComponent* AOgro::GetCustomCharacterMovement() const
+// Called to bind functionality to input
+void AOgro::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
 {
-	return Cast<UCustomCharacterMovementComponent>(GetMovementComponent());
-}
+	Super::SetupPlayerInputComponent(PlayerInputComponent);
 
+}
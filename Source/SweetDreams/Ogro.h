@@ -2,11 +2,11 @@
 
 #pragma once
 
-#include "GameFramework/Character.h"
+#include "GravityCharacter.h"
 #include "Ogro.generated.h"
 
 UCLASS()
-class SWEETDREAMS_API AOgro : public ACharacter
+class SWEETDREAMS_API AOgro : public AGravityCharacter
 {
 	GENERATED_BODY()
 
@@ -19,17 +19,29 @@ protected:
 	virtual void BeginPlay() override;
 
 public:	
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
+	// Called after all components have been initialized
+	virtual void PostInitializeComponents() override;
 
 	// Called to bind functionality to input
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 
+public:
+	/**
+	* Screen size thresholds used by the mesh's update rate optimization; the further down the list the
+	* visible distance factor falls, the more animation frames are skipped.
+	*/
+	UPROPERTY(Category = "Animation", EditAnywhere, BlueprintReadOnly)
+		TArray<float> AnimUpdateRateScreenSizeThresholds;
+
+	/** If true, skipped animation frames are interpolated instead of holding the last pose. */
+	UPROPERTY(Category = "Animation", EditAnywhere, BlueprintReadOnly)
+		uint32 bInterpolateSkippedAnimFrames : 1;
 
-	UFUNCTION(Category = "Pawn|CustomCharacter", BlueprintCallable)
-		virtual void LaunchCharacterRotated(FVector LaunchVelocity, bool bHorizontalOverride, bool bVerticalOverride);
-	virtual void ApplyDamageMomentum(float DamageTaken, const FDamageEvent& DamageEvent, APawn* PawnInstigator, AActor* DamageCauser) override;
-	virtual FVector GetPawnViewLocation() const override;
-	virtual void PostNetReceiveLocationAndRotation() override;
-	FORCEINLINE class UCustomCharacterMovementComponent* GetCustomCharacterMovement() const;
+	/** Highest frame skip that is still interpolated; beyond this the pose is held. */
+	UPROPERTY(Category = "Animation", EditAnywhere, BlueprintReadOnly)
+		int32 MaxAnimEvalRateForInterpolation;
+
+protected:
+	/** Applies the update rate settings above to the mesh's shared update rate parameters. */
+	virtual void ConfigureAnimUpdateRate(struct FAnimUpdateRateParameters* Params);
 };
@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SweetDreams.h"
+#include "CustomCharacterMovementComponent.h"
+#include "OgroAnimInstance.h"
+
+
+void FOgroAnimInstanceProxy::PreUpdate(UAnimInstance* InAnimInstance, float DeltaSeconds)
+{
+	Super::PreUpdate(InAnimInstance, DeltaSeconds);
+
+	const APawn* PawnOwner = InAnimInstance->TryGetPawnOwner();
+	if (PawnOwner == nullptr)
+	{
+		return;
+	}
+
+	Velocity = PawnOwner->GetVelocity();
+	ActorRotation = PawnOwner->GetActorQuat();
+
+	const UCustomCharacterMovementComponent* CharacterMovement = Cast<UCustomCharacterMovementComponent>(PawnOwner->GetMovementComponent());
+	if (CharacterMovement != nullptr)
+	{
+		GravityDirection = CharacterMovement->GetGravityDirection(true);
+		bFalling = CharacterMovement->IsFalling() || CharacterMovement->IsFlying();
+	}
+	else
+	{
+		// Fall back to the actor's "down" axis.
+		GravityDirection = -ActorRotation.GetAxisZ();
+		bFalling = false;
+	}
+}
+
+void FOgroAnimInstanceProxy::Update(float DeltaSeconds)
+{
+	Super::Update(DeltaSeconds);
+
+	const FVector SurfaceVelocity = FVector::VectorPlaneProject(Velocity, GravityDirection);
+
+	Speed = SurfaceVelocity.Size();
+	VerticalSpeed = -(Velocity | GravityDirection);
+	bIsInAir = bFalling;
+	bIsMoving = Speed > MovingSpeedThreshold;
+
+	if (Speed > KINDA_SMALL_NUMBER)
+	{
+		// Measure the angle in the actor's local frame so it stays valid on walls and ceilings.
+		const FVector LocalVelocity = ActorRotation.UnrotateVector(SurfaceVelocity);
+		Direction = FMath::RadiansToDegrees(FMath::Atan2(LocalVelocity.Y, LocalVelocity.X));
+	}
+	else
+	{
+		Direction = 0.0f;
+	}
+}
@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Animation/AnimInstance.h"
+#include "Animation/AnimInstanceProxy.h"
+#include "OgroAnimInstance.generated.h"
+
+/**
+ * Locomotion state for the ogre skeleton, computed off the game thread.
+ * Only PreUpdate touches the owning pawn; Update runs on an animation worker thread.
+ */
+USTRUCT(meta = (DisplayName = "Ogro Native Variables"))
+struct SWEETDREAMS_API FOgroAnimInstanceProxy : public FAnimInstanceProxy
+{
+	GENERATED_BODY()
+
+public:
+	FOgroAnimInstanceProxy()
+		: FAnimInstanceProxy()
+	{
+	}
+
+	FOgroAnimInstanceProxy(UAnimInstance* Instance)
+		: FAnimInstanceProxy(Instance)
+	{
+	}
+
+protected:
+	/** Copies the movement state needed by Update. Runs on the game thread. */
+	virtual void PreUpdate(UAnimInstance* InAnimInstance, float DeltaSeconds) override;
+
+	/** Derives the locomotion variables read by the anim graph. Runs on a worker thread. */
+	virtual void Update(float DeltaSeconds) override;
+
+public:
+	/** Speed along the surface, i.e. velocity projected onto the plane normal to gravity. */
+	UPROPERTY(Transient, BlueprintReadOnly, Category = "Ogro Animation")
+		float Speed;
+
+	/** Signed angle in degrees between the facing direction and the surface velocity, in [-180, 180]. */
+	UPROPERTY(Transient, BlueprintReadOnly, Category = "Ogro Animation")
+		float Direction;
+
+	/** Speed along the "up" axis (opposite to gravity); positive while rising. */
+	UPROPERTY(Transient, BlueprintReadOnly, Category = "Ogro Animation")
+		float VerticalSpeed;
+
+	/** True if the character is falling or flying. */
+	UPROPERTY(Transient, BlueprintReadOnly, Category = "Ogro Animation")
+		bool bIsInAir;
+
+	/** True if the surface speed is above MovingSpeedThreshold. */
+	UPROPERTY(Transient, BlueprintReadOnly, Category = "Ogro Animation")
+		bool bIsMoving;
+
+	/** Minimum surface speed for the character to be considered moving. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Ogro Animation")
+		float MovingSpeedThreshold = 10.0f;
+
+private:
+	/** Movement state copied in PreUpdate. */
+	FVector Velocity = FVector::ZeroVector;
+	FVector GravityDirection = FVector(0.0f, 0.0f, -1.0f);
+	FQuat ActorRotation = FQuat::Identity;
+	bool bFalling = false;
+};
+
+/**
+ * Native animation instance for ogre_Skeleton.
+ * Locomotion variables are computed in C++ relative to the character's gravity, so the anim graph only
+ * reads plain member variables (fast path) and can be evaluated on worker threads.
+ */
+UCLASS(Transient, Blueprintable)
+class SWEETDREAMS_API UOgroAnimInstance : public UAnimInstance
+{
+	GENERATED_BODY()
+
+private:
+	/** Proxy holding the locomotion variables; exposed so the anim graph can read them directly. */
+	UPROPERTY(Transient, BlueprintReadOnly, Category = "Ogro Animation", meta = (AllowPrivateAccess = "true"))
+		FOgroAnimInstanceProxy Proxy;
+
+	virtual FAnimInstanceProxy* CreateAnimInstanceProxy() override
+	{
+		// Proxy is owned by this instance so the graph can read it without copies.
+		return &Proxy;
+	}
+
+	virtual void DestroyAnimInstanceProxy(FAnimInstanceProxy* InProxy) override
+	{
+	}
+
+	friend struct FOgroAnimInstanceProxy;
+};
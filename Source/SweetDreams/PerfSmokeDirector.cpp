@@ -0,0 +1,357 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SweetDreams.h"
+#include "PerfSmokeDirector.h"
+#include "GravityAvoidanceManager.h"
+
+#include "EngineUtils.h"
+#include "RenderCore.h"
+#include "NeoFurAsset.h"
+#include "NeoFurComponent.h"
+#include "FMODEvent.h"
+#include "FMODBlueprintStatics.h"
+#include "FMODStudioModule.h"
+#include "FMOD/fmod_studio.hpp"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPerfSmoke, Log, All);
+
+namespace PerfSmokeStatics
+{
+	static const TCHAR* CsvHeader = TEXT("Frame,TimeSeconds,FrameMs,GameThreadMs,RenderThreadMs,GPUMs,AvoidanceMs,AvoidanceAgents,FurComponents,FurActiveShells,FurSimMs,FMODStudioCpu,FMODMixerCpu,UsedPhysicalMB,PeakUsedPhysicalMB");
+
+	/** Uniformly distributed random point in a disc. */
+	static FVector2D RandPointInDisc(const FRandomStream& Stream, float Radius)
+	{
+		const float Angle = Stream.GetFraction() * 2.0f * PI;
+		const float Distance = FMath::Sqrt(Stream.GetFraction()) * Radius;
+		return FVector2D(FMath::Cos(Angle) * Distance, FMath::Sin(Angle) * Distance);
+	}
+
+	static void RunPerfSmoke(const TArray<FString>& Args, UWorld* World)
+	{
+		const float DurationOverride = (Args.Num() > 0) ? FCString::Atof(*Args[0]) : 0.0f;
+		APerfSmokeDirector::Run(World, DurationOverride);
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs PerfSmokeCommand(
+		TEXT("SweetDreams.PerfSmoke"),
+		TEXT("Runs the performance smoke scenario and writes a per-frame CSV to Saved/Profiling/PerfSmoke.\n")
+		TEXT("Optional argument: duration in seconds."),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunPerfSmoke));
+}
+
+
+// Sets default values
+APerfSmokeDirector::APerfSmokeDirector()
+{
+ 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PostUpdateWork;
+
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
+
+	Duration = 60.0f;
+	WarmUpFrames = 60;
+	bExitWhenDone = true;
+	bCaptureStatsFile = false;
+	CharacterClass = FStringClassReference(TEXT("/Game/ThirdPersonBP/Blueprints/ThirdPersonCharacter.ThirdPersonCharacter_C"));
+	NumCharacters = 8;
+	OgroClass = FStringClassReference(TEXT("/Game/ThirdPersonBP/Blueprints/AI/BP_Ogro.BP_Ogro_C"));
+	NumHordes = 4;
+	OgrosPerHorde = 25;
+	NumAmbientSounds = 16;
+	ScenarioRadius = 2000.0f;
+	FlythroughHeight = 800.0f;
+
+	ScenarioCenter = FVector::ZeroVector;
+	ElapsedTime = 0.0f;
+	FrameCount = 0;
+	NumFurComponents = 0;
+	LastFurSimulationSeconds = 0.0;
+	bFinished = false;
+}
+
+APerfSmokeDirector* APerfSmokeDirector::Run(UWorld* World, float DurationOverride)
+{
+	if (World == nullptr || !World->IsGameWorld())
+	{
+		UE_LOG(LogPerfSmoke, Error, TEXT("Perf smoke needs a game world."));
+		return nullptr;
+	}
+
+	// Center the scenario on the first player start, or the world origin.
+	FTransform SpawnTransform = FTransform::Identity;
+	for (TActorIterator<APlayerStart> It(World); It; ++It)
+	{
+		SpawnTransform = It->GetActorTransform();
+		break;
+	}
+
+	APerfSmokeDirector* Director = World->SpawnActorDeferred<APerfSmokeDirector>(APerfSmokeDirector::StaticClass(), SpawnTransform);
+	if (Director != nullptr)
+	{
+		if (DurationOverride > 0.0f)
+		{
+			Director->Duration = DurationOverride;
+		}
+		Director->FinishSpawning(SpawnTransform);
+	}
+
+	return Director;
+}
+
+// Called when the game starts or when spawned
+void APerfSmokeDirector::BeginPlay()
+{
+	Super::BeginPlay();
+
+	ScenarioCenter = GetActorLocation();
+	SpawnScenario();
+
+	// Make the director the view target so the flythrough drives LOD and culling.
+	APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	if (PlayerController != nullptr)
+	{
+		PlayerController->SetViewTarget(this);
+	}
+
+	Rows.Reserve(FMath::CeilToInt(Duration * 120.0f));
+
+	UE_LOG(LogPerfSmoke, Log, TEXT("Perf smoke started: %d characters, %d Ogros, %d fur components, %.1f seconds."),
+		NumCharacters, NumHordes * OgrosPerHorde, NumFurComponents, Duration);
+}
+
+// Called when the actor is being removed
+void APerfSmokeDirector::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (!bFinished && Rows.Num() > 0)
+	{
+		FinishCapture();
+	}
+
+	for (AActor* Actor : SpawnedActors)
+	{
+		if (Actor != nullptr && !Actor->IsPendingKill())
+		{
+			Actor->Destroy();
+		}
+	}
+	SpawnedActors.Empty();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+// Called every frame
+void APerfSmokeDirector::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (bFinished)
+	{
+		return;
+	}
+
+	++FrameCount;
+	if (FrameCount <= WarmUpFrames)
+	{
+		LastFurSimulationSeconds = UNeoFurComponent::GetTotalSimulationSeconds();
+		UpdateFlythrough(0.0f);
+		return;
+	}
+
+	if (FrameCount == WarmUpFrames + 1 && bCaptureStatsFile)
+	{
+		GEngine->Exec(GetWorld(), TEXT("stat startfile"));
+	}
+
+	ElapsedTime += DeltaTime;
+	UpdateFlythrough(FMath::Clamp(ElapsedTime / FMath::Max(Duration, KINDA_SMALL_NUMBER), 0.0f, 1.0f));
+	CaptureFrame(DeltaTime);
+
+	if (ElapsedTime >= Duration)
+	{
+		FinishCapture();
+	}
+}
+
+APawn* APerfSmokeDirector::SpawnPawn(UClass* PawnClass, const FVector& Location)
+{
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	const FRotator Rotation(0.0f, LayoutStream.FRandRange(-180.0f, 180.0f), 0.0f);
+	APawn* Pawn = GetWorld()->SpawnActor<APawn>(PawnClass, Location, Rotation, SpawnParams);
+	if (Pawn != nullptr)
+	{
+		if (Pawn->Controller == nullptr)
+		{
+			Pawn->SpawnDefaultController();
+		}
+		SpawnedActors.Add(Pawn);
+	}
+
+	return Pawn;
+}
+
+void APerfSmokeDirector::SpawnScenario()
+{
+	using namespace PerfSmokeStatics;
+
+	// Fixed seed so every run spawns the same layout. This has its own stream so the
+	// global one everything else uses is left alone.
+	LayoutStream.Initialize(0x5D);
+
+	UClass* LoadedCharacterClass = CharacterClass.TryLoadClass<APawn>();
+	UClass* LoadedOgroClass = OgroClass.TryLoadClass<APawn>();
+	UNeoFurAsset* LoadedFurAsset = Cast<UNeoFurAsset>(FurAsset.TryLoad());
+	UFMODEvent* LoadedAmbientEvent = Cast<UFMODEvent>(AmbientEvent.TryLoad());
+
+	if (LoadedCharacterClass != nullptr)
+	{
+		for (int32 Index = 0; Index < NumCharacters; ++Index)
+		{
+			const FVector2D Offset = RandPointInDisc(LayoutStream, ScenarioRadius);
+			SpawnPawn(LoadedCharacterClass, ScenarioCenter + FVector(Offset, 0.0f));
+		}
+	}
+	else if (NumCharacters > 0)
+	{
+		UE_LOG(LogPerfSmoke, Warning, TEXT("Character class '%s' not found."), *CharacterClass.ToString());
+	}
+
+	if (LoadedOgroClass != nullptr)
+	{
+		for (int32 HordeIndex = 0; HordeIndex < NumHordes; ++HordeIndex)
+		{
+			// Hordes start around the rim and close in on the characters.
+			const float Angle = 2.0f * PI * HordeIndex / FMath::Max(NumHordes, 1);
+			const FVector HordeCenter = ScenarioCenter + FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.0f) * ScenarioRadius;
+
+			for (int32 OgroIndex = 0; OgroIndex < OgrosPerHorde; ++OgroIndex)
+			{
+				const FVector2D Offset = RandPointInDisc(LayoutStream, ScenarioRadius * 0.25f);
+				APawn* Ogro = SpawnPawn(LoadedOgroClass, HordeCenter + FVector(Offset, 0.0f));
+				ACharacter* OgroCharacter = Cast<ACharacter>(Ogro);
+
+				if (OgroCharacter != nullptr && LoadedFurAsset != nullptr)
+				{
+					UNeoFurComponent* Fur = NewObject<UNeoFurComponent>(OgroCharacter);
+					Fur->FurAsset = LoadedFurAsset;
+					Fur->bForceCPUSimulation = true;
+					Fur->SetupAttachment(OgroCharacter->GetMesh());
+					Fur->RegisterComponent();
+					++NumFurComponents;
+				}
+			}
+		}
+	}
+	else if (NumHordes * OgrosPerHorde > 0)
+	{
+		UE_LOG(LogPerfSmoke, Warning, TEXT("Ogro class '%s' not found."), *OgroClass.ToString());
+	}
+
+	if (LoadedAmbientEvent != nullptr)
+	{
+		for (int32 Index = 0; Index < NumAmbientSounds; ++Index)
+		{
+			const FVector2D Offset = RandPointInDisc(LayoutStream, ScenarioRadius);
+			UFMODBlueprintStatics::PlayEventAtLocation(this, LoadedAmbientEvent, FTransform(ScenarioCenter + FVector(Offset, 0.0f)), true);
+		}
+	}
+}
+
+void APerfSmokeDirector::UpdateFlythrough(float Alpha)
+{
+	// One full orbit around the scenario, descending towards the crowd halfway through.
+	const float Angle = 2.0f * PI * Alpha;
+	const float Height = FlythroughHeight * (0.5f + 0.5f * FMath::Abs(FMath::Cos(Angle)));
+	const FVector Location = ScenarioCenter + FVector(FMath::Cos(Angle) * ScenarioRadius, FMath::Sin(Angle) * ScenarioRadius, Height);
+	const FRotator Rotation = (ScenarioCenter - Location).Rotation();
+
+	SetActorLocationAndRotation(Location, Rotation);
+}
+
+void APerfSmokeDirector::CaptureFrame(float DeltaTime)
+{
+	UWorld* World = GetWorld();
+
+	double AvoidanceMs = 0.0;
+	int32 AvoidanceAgents = 0;
+	FGravityAvoidanceManager* AvoidanceManager = FGravityAvoidanceManager::Find(World);
+	if (AvoidanceManager != nullptr)
+	{
+		AvoidanceMs = AvoidanceManager->GetLastTickSeconds() * 1000.0;
+		AvoidanceAgents = AvoidanceManager->GetNumAgents();
+	}
+
+	// Fur simulation time is only available as a running total, across the render thread and the
+	// simulation tasks.
+	const double FurSimulationSeconds = UNeoFurComponent::GetTotalSimulationSeconds();
+	const double FurSimMs = (FurSimulationSeconds - LastFurSimulationSeconds) * 1000.0;
+	LastFurSimulationSeconds = FurSimulationSeconds;
+
+	FMOD_STUDIO_CPU_USAGE FMODUsage = {};
+	if (IFMODStudioModule::IsAvailable())
+	{
+		FMOD::Studio::System* StudioSystem = IFMODStudioModule::Get().GetStudioSystem(EFMODSystemContext::Runtime);
+		if (StudioSystem != nullptr)
+		{
+			StudioSystem->getCPUUsage(&FMODUsage);
+		}
+	}
+
+	const FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
+
+	Rows.Add(FString::Printf(TEXT("%d,%.4f,%.3f,%.3f,%.3f,%.3f,%.3f,%d,%d,%d,%.3f,%.2f,%.2f,%.1f,%.1f"),
+		FrameCount - WarmUpFrames,
+		ElapsedTime,
+		DeltaTime * 1000.0f,
+		FPlatformTime::ToMilliseconds(GGameThreadTime),
+		FPlatformTime::ToMilliseconds(GRenderThreadTime),
+		FPlatformTime::ToMilliseconds(GGPUFrameTime),
+		AvoidanceMs,
+		AvoidanceAgents,
+		NumFurComponents,
+		UNeoFurComponent::GetTotalActiveShellCount(World),
+		FurSimMs,
+		FMODUsage.studiousage,
+		FMODUsage.dspusage,
+		MemoryStats.UsedPhysical / (1024.0 * 1024.0),
+		MemoryStats.PeakUsedPhysical / (1024.0 * 1024.0)));
+}
+
+void APerfSmokeDirector::FinishCapture()
+{
+	bFinished = true;
+
+	if (bCaptureStatsFile)
+	{
+		GEngine->Exec(GetWorld(), TEXT("stat stopfile"));
+	}
+
+	const FString Directory = FPaths::ProfilingDir() / TEXT("PerfSmoke");
+	const FString FileName = Directory / FString::Printf(TEXT("PerfSmoke-%s.csv"), *FDateTime::Now().ToString());
+
+	FString Csv = PerfSmokeStatics::CsvHeader;
+	Csv += LINE_TERMINATOR;
+	for (const FString& Row : Rows)
+	{
+		Csv += Row;
+		Csv += LINE_TERMINATOR;
+	}
+
+	IFileManager::Get().MakeDirectory(*Directory, true);
+	if (FFileHelper::SaveStringToFile(Csv, *FileName))
+	{
+		UE_LOG(LogPerfSmoke, Log, TEXT("Perf smoke wrote %d frames to %s"), Rows.Num(), *FileName);
+	}
+	else
+	{
+		UE_LOG(LogPerfSmoke, Error, TEXT("Perf smoke failed to write %s"), *FileName);
+	}
+
+	if (bExitWhenDone)
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
@@ -0,0 +1,144 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "GameFramework/Actor.h"
+#include "PerfSmokeDirector.generated.h"
+
+/**
+ * Repeatable performance scenario.
+ * Spawns a scripted mix of characters, Ogro hordes, fur and ambient sounds, flies the view around them for a
+ * fixed duration and writes one CSV row per frame to Saved/Profiling/PerfSmoke.
+ *
+ * Typical headless run:
+ *   UE4Editor SweetDreams.uproject /Game/ThirdPersonBP/Maps/ThirdPersonExampleMap -game -nullrhi -fmodnrt
+ *     -unattended -ExecCmds="SweetDreams.PerfSmoke"
+ *
+ * Scenario contents are read from the [/Script/SweetDreams.PerfSmokeDirector] section of DefaultGame.ini.
+ */
+UCLASS(config = Game, notplaceable)
+class SWEETDREAMS_API APerfSmokeDirector : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	// Sets default values for this actor's properties
+	APerfSmokeDirector();
+
+protected:
+	// Called when the game starts or when spawned
+	virtual void BeginPlay() override;
+
+	// Called when the actor is being removed
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+public:
+	// Called every frame
+	virtual void Tick(float DeltaTime) override;
+
+public:
+	/** Length of the capture, in seconds. */
+	UPROPERTY(config, EditAnywhere, Category = "Perf Smoke")
+		float Duration;
+
+	/** Frames skipped before capturing, so loading hitches don't pollute the results. */
+	UPROPERTY(config, EditAnywhere, Category = "Perf Smoke")
+		int32 WarmUpFrames;
+
+	/** If true, the game exits once the capture is written. */
+	UPROPERTY(config, EditAnywhere, Category = "Perf Smoke")
+		uint32 bExitWhenDone : 1;
+
+	/** If true, an engine stats capture (stat startfile) runs alongside the CSV for per-subsystem detail. */
+	UPROPERTY(config, EditAnywhere, Category = "Perf Smoke")
+		uint32 bCaptureStatsFile : 1;
+
+	/** Playable character class and number of instances. */
+	UPROPERTY(config, EditAnywhere, Category = "Perf Smoke", meta = (MetaClass = "Pawn"))
+		FStringClassReference CharacterClass;
+
+	UPROPERTY(config, EditAnywhere, Category = "Perf Smoke")
+		int32 NumCharacters;
+
+	/** Ogro class, number of hordes and Ogros per horde. */
+	UPROPERTY(config, EditAnywhere, Category = "Perf Smoke", meta = (MetaClass = "Pawn"))
+		FStringClassReference OgroClass;
+
+	UPROPERTY(config, EditAnywhere, Category = "Perf Smoke")
+		int32 NumHordes;
+
+	UPROPERTY(config, EditAnywhere, Category = "Perf Smoke")
+		int32 OgrosPerHorde;
+
+	/** Fur asset attached to every Ogro, simulated on the CPU. No fur is spawned if empty. */
+	UPROPERTY(config, EditAnywhere, Category = "Perf Smoke", meta = (AllowedClasses = "NeoFurAsset"))
+		FStringAssetReference FurAsset;
+
+	/** FMOD event played at a number of locations around the scene. No sound is played if empty. */
+	UPROPERTY(config, EditAnywhere, Category = "Perf Smoke", meta = (AllowedClasses = "FMODEvent"))
+		FStringAssetReference AmbientEvent;
+
+	UPROPERTY(config, EditAnywhere, Category = "Perf Smoke")
+		int32 NumAmbientSounds;
+
+	/** Radius of the area everything is spawned in, and of the flythrough orbit. */
+	UPROPERTY(config, EditAnywhere, Category = "Perf Smoke")
+		float ScenarioRadius;
+
+	/** Height of the flythrough above the scenario center. */
+	UPROPERTY(config, EditAnywhere, Category = "Perf Smoke")
+		float FlythroughHeight;
+
+	/**
+	* Spawn a director in the given world, which starts the capture immediately.
+	*
+	* @param World - World to run the scenario in.
+	* @param DurationOverride - If positive, overrides the configured duration.
+	*/
+	static APerfSmokeDirector* Run(UWorld* World, float DurationOverride = 0.0f);
+
+protected:
+	/** Spawn all actors of the scenario around the director. */
+	virtual void SpawnScenario();
+
+	/** Move the view along the flythrough path. */
+	virtual void UpdateFlythrough(float Alpha);
+
+	/** Append a CSV row for the current frame. */
+	virtual void CaptureFrame(float DeltaTime);
+
+	/** Write the CSV file and optionally exit. */
+	virtual void FinishCapture();
+
+	/** Spawn a pawn of the given class near Location, with its default controller. */
+	APawn* SpawnPawn(UClass* PawnClass, const FVector& Location);
+
+protected:
+	/** Actors spawned by the scenario, destroyed when the director ends. */
+	UPROPERTY(Transient)
+		TArray<AActor*> SpawnedActors;
+
+	/** Center of the scenario, where the director was spawned. */
+	FVector ScenarioCenter;
+
+	/** Captured rows, without header. */
+	TArray<FString> Rows;
+
+	/** Time since the capture started. */
+	float ElapsedTime;
+
+	/** Frames ticked so far, including warm up. */
+	int32 FrameCount;
+
+	/** Number of fur components spawned. */
+	int32 NumFurComponents;
+
+	/** Random stream the scenario layout is spawned from, seeded the same way every run. */
+	FRandomStream LayoutStream;
+
+	/** Total fur simulation time at the previous frame, to turn the running total into a per-frame time. */
+	double LastFurSimulationSeconds;
+
+	/** True once the CSV has been written. */
+	uint32 bFinished : 1;
+};